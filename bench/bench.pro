@@ -0,0 +1,5 @@
+TEMPLATE = subdirs
+
+SUBDIRS += decode
+SUBDIRS += envelope
+SUBDIRS += tui
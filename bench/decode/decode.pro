@@ -0,0 +1,8 @@
+QT -= gui
+CONFIG += console
+
+TARGET = decodebench.x
+
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += decodebench.cpp
@@ -0,0 +1,148 @@
+#include "../../src/decodepool.h"
+#include "../../src/zclock.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEventLoop>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+
+#include <algorithm>
+
+/* \brief Builds the JSON text of a `pinpad.cardInfo` event whose data holds an array of line items,
+ *        so that it is at least the given size, like the large events that DecodePool is for.
+ *
+ * \param <size> Smallest size of the text, in bytes.
+ *
+ * \returns JSON text of the event, in UTF-8.
+ */
+static QByteArray make_frame(int size)
+{
+    QByteArray text = "{\"event\":\"pinpad.cardInfo\",\"requestId\":\"0\",\"data\":{\"items\":[";
+    for (int i = 0; text.size() < size; i++)
+    {
+        text += (i > 0 ? "," : "");
+        text += "{\"sku\":\"" + QByteArray::number(100000 + i) +
+                "\",\"description\":\"item " + QByteArray::number(i) +
+                "\",\"quantity\":1,\"price\":" + QByteArray::number(i % 500) + ".99}";
+    }
+    return text + "]}}";
+}
+
+/* \brief Submits every frame to a DecodePool with the given number of workers, as if they arrived
+ *        in one burst, and waits for all of them to be emitted.
+ *
+ * \param <frame> JSON text of the frame submitted.
+ * \param <count> Number of times the frame is submitted.
+ * \param <threads> Number of workers of the pool.
+ *
+ * \returns Time from the first frame being submitted to the last event being emitted, in ns.
+ */
+static qint64 measure(const QByteArray &frame, int count, int threads)
+{
+    DecodePool pool(threads);
+    QEventLoop loop;
+    int decoded = 0;
+    QObject::connect(&pool, &DecodePool::decoded,
+                     [&decoded, &loop, count]
+                     {
+                         if (++decoded == count)
+                         {
+                             loop.quit();
+                         }
+                     });
+
+    qint64 start = ZClock::now();
+    for (int i = 0; i < count; i++)
+    {
+        pool.submit(frame, frame.size(), start);
+    }
+    if (decoded < count)
+    {
+        loop.exec();
+    }
+    return ZClock::now() - start;
+}
+
+/* \brief Measures how many frames per second DecodePool decodes with each number of workers, and
+ *        prints a row for each.
+ *
+ * \param <argc> Number of arguments provided to the command line (including the program name!).
+ * \param <argv> Array of arguments provided to the command line.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Measures how quickly DecodePool decodes frames, by number of "
+                                   "threads.");
+  parser.addHelpOption();
+  parser.addOption({"threads",
+                    QCoreApplication::translate("main", "comma-separated numbers of threads "
+                                                        "(default 1, 2, 4, ... up to the number of "
+                                                        "cores)"),
+                    QCoreApplication::translate("main", "counts")});
+  parser.addOption({"size",
+                    QCoreApplication::translate("main", "size of each frame, in bytes (default "
+                                                        "65536)"),
+                    QCoreApplication::translate("main", "bytes"),
+                    "65536"});
+  parser.addOption({"frames",
+                    QCoreApplication::translate("main", "frames decoded per step (default 2000)"),
+                    QCoreApplication::translate("main", "count"),
+                    "2000"});
+  parser.process(app);
+
+  QVector<int> threads;
+  if (parser.isSet("threads"))
+  {
+      foreach (const QString &count, parser.value("threads").split(',', QString::SkipEmptyParts))
+      {
+          threads.append(count.toInt());
+      }
+  }
+  else
+  {
+      for (int count = 1; count < QThread::idealThreadCount(); count *= 2)
+      {
+          threads.append(count);
+      }
+      threads.append(qMax(QThread::idealThreadCount(), 1));
+  }
+
+  int size = parser.value("size").toInt();
+  int count = parser.value("frames").toInt();
+  if (threads.isEmpty() || *std::min_element(threads.begin(), threads.end()) < 1 || size < 1 ||
+      count < 1)
+  {
+      qWarning() << "The provided --threads, --size, or --frames is invalid.";
+      return 1;
+  }
+
+  QByteArray frame = make_frame(size);
+  QTextStream out(stdout);
+  out << "frames of " << frame.size() << " bytes\n";
+  out << qSetFieldWidth(8) << "threads" << qSetFieldWidth(12) << "frames/s" << "MB/s"
+      << "speedup" << qSetFieldWidth(0) << "\n";
+
+  // warm up the allocator and the first worker, so the first step is not penalized
+  measure(frame, qMin(count, 100), 1);
+
+  double baseline = 0;
+  foreach (int workers, threads)
+  {
+      double seconds = measure(frame, count, workers) / 1e9;
+      double rate = count / seconds;
+      baseline = baseline > 0 ? baseline : rate;
+      out << qSetFieldWidth(8) << workers << qSetFieldWidth(12)
+          << QString::number(rate, 'f', 0)
+          << QString::number(rate * frame.size() / 1e6, 'f', 1)
+          << QString::number(rate / baseline, 'f', 2) << qSetFieldWidth(0) << "\n";
+      out.flush();
+  }
+
+  return 0;
+}
@@ -0,0 +1,8 @@
+QT -= gui
+CONFIG += console
+
+TARGET = envelopebench.x
+
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += envelopebench.cpp
@@ -0,0 +1,119 @@
+#include "../../src/envelopescanner.h"
+#include "../../src/zclock.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+/* \brief Finds the name and request ID of the frame the given number of times with
+ *        EnvelopeScanner, as the websocket does to route a frame.
+ *
+ * \param <frame> JSON text of the frame.
+ * \param <iterations> Number of times the frame is scanned.
+ *
+ * \returns Time each scan took on average, in ns.
+ */
+static double measure_scan(const QByteArray &frame, int iterations)
+{
+    qint64 start = ZClock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        ZBusEnvelope envelope;
+        EnvelopeScanner::scan(frame, envelope);
+        EnvelopeScanner::string(frame, envelope.event);
+        EnvelopeScanner::string(frame, envelope.requestId);
+    }
+    return double(ZClock::now() - start) / iterations;
+}
+
+/* \brief Finds the name and request ID of the frame the given number of times by parsing it with
+ *        QJsonDocument, as was done before EnvelopeScanner.
+ *
+ * \param <frame> JSON text of the frame.
+ * \param <iterations> Number of times the frame is parsed.
+ *
+ * \returns Time each parse took on average, in ns.
+ */
+static double measure_parse(const QByteArray &frame, int iterations)
+{
+    qint64 start = ZClock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        QJsonObject json = QJsonDocument::fromJson(frame).object();
+        json.value("event").toString();
+        json.value("requestId").toString();
+    }
+    return double(ZClock::now() - start) / iterations;
+}
+
+/* \brief Measures how long EnvelopeScanner and QJsonDocument take to find the envelope of each
+ *        frame of a file of captured frames, one per line, and prints a row for each.
+ *
+ * \param <argc> Number of arguments provided to the command line (including the program name!).
+ * \param <argv> Array of arguments provided to the command line.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Measures how quickly EnvelopeScanner finds the envelope of "
+                                   "captured frames, against QJsonDocument.");
+  parser.addHelpOption();
+  parser.addOption({"frames",
+                    QCoreApplication::translate("main", "file of frames captured from zBus, one "
+                                                        "per line (default frames.jsonl)"),
+                    QCoreApplication::translate("main", "file"),
+                    "frames.jsonl"});
+  parser.addOption({"iterations",
+                    QCoreApplication::translate("main", "times each frame is scanned and parsed "
+                                                        "(default 20000)"),
+                    QCoreApplication::translate("main", "count"),
+                    "20000"});
+  parser.process(app);
+
+  QFile file(parser.value("frames"));
+  int iterations = parser.value("iterations").toInt();
+  if (!file.open(QIODevice::ReadOnly) || iterations < 1)
+  {
+      qWarning() << "The provided --frames cannot be read, or --iterations is invalid.";
+      return 1;
+  }
+
+  QTextStream out(stdout);
+  out << qSetFieldWidth(32) << left << "event" << qSetFieldWidth(10) << right << "bytes"
+      << qSetFieldWidth(12) << "scan ns" << "parse ns" << "speedup" << qSetFieldWidth(0) << "\n";
+
+  while (!file.atEnd())
+  {
+      QByteArray frame = file.readLine().trimmed();
+      if (frame.isEmpty())
+      {
+          continue;
+      }
+
+      // a frame the scanner gets wrong is not worth timing
+      ZBusEnvelope envelope;
+      QJsonObject json = QJsonDocument::fromJson(frame).object();
+      QString name = json.value("event").toString();
+      if (!EnvelopeScanner::scan(frame, envelope) ||
+          EnvelopeScanner::string(frame, envelope.event) != name ||
+          EnvelopeScanner::string(frame, envelope.requestId) != json.value("requestId").toString())
+      {
+          qWarning() << "The scanner does not find the envelope the parser does in:" << frame;
+          return 1;
+      }
+
+      double scan = measure_scan(frame, iterations);
+      double parse = measure_parse(frame, iterations);
+      out << qSetFieldWidth(32) << left << name << qSetFieldWidth(10) << right << frame.size()
+          << qSetFieldWidth(12) << QString::number(scan, 'f', 0) << QString::number(parse, 'f', 0)
+          << QString::number(parse / scan, 'f', 1) << qSetFieldWidth(0) << "\n";
+      out.flush();
+  }
+
+  return 0;
+}
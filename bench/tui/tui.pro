@@ -0,0 +1,10 @@
+QT += websockets
+QT -= gui
+CONFIG += console
+
+TARGET = tuibench.x
+
+LIBS += ../../libzbusclient.a -lrt
+LIBS += -lutil
+
+SOURCES += tuibench.cpp
@@ -0,0 +1,559 @@
+#include "../../src/broadcastserver.h"
+#include "../../src/zwebsocket.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// How long the terminal must be quiet, with no bytes written to it, before a step is finished, in
+// ms.
+static const int IDLE_MS = 250;
+
+// Longest a step is given to go quiet, in ms, before it is finished regardless.
+static const int STEP_TIMEOUT_MS = 10000;
+
+// Time between repeated key presses, in ms, like a held key.
+static const int KEY_INTERVAL_MS = 20;
+
+// Script run when none is given: events arrive in bursts of increasing size, then the history is
+// perused, stats are displayed, the terminal is resized, and an event is typed.
+static const char *DEFAULT_SCRIPT =
+    "events 1 {\"event\":\"scanner.read\",\"data\":{\"barcode\":\"0123456789\"}}\n"
+    "events 100 {\"event\":\"pinpad.cardInfo\",\"data\":{\"amount\":\"{{amount}}\"},"
+    "\"requestId\":\"{{uuid}}\"}\n"
+    "events 1000 {\"event\":\"printer.status\",\"data\":{\"online\":true,\"paper\":\"low\"}}\n"
+    "key p\n"
+    "key up x50\n"
+    "key pgup x10\n"
+    "key pgdn x10\n"
+    "key esc\n"
+    "key t\n"
+    "wait 2000\n"
+    "key esc\n"
+    "resize 24 80\n"
+    "resize 50 200\n"
+    "key s\n"
+    "type scanner.read\n"
+    "key esc\n";
+
+// Bytes sent by the terminal for each named key.
+static const QHash<QString, QByteArray> KEYS = {
+    { "up", "\033[A" },
+    { "down", "\033[B" },
+    { "right", "\033[C" },
+    { "left", "\033[D" },
+    { "home", "\033[H" },
+    { "end", "\033[F" },
+    { "pgup", "\033[5~" },
+    { "pgdn", "\033[6~" },
+    { "enter", "\r" },
+    { "esc", "\033" },
+    { "tab", "\t" },
+    { "backspace", "\177" }
+};
+
+/* One line of a script. Each step is measured on its own, and labelled with its line in the report.
+ *
+ * key <name> [x<count>] - presses a named key (or a single character) <count> times
+ * type <text>           - types the text, one character at a time
+ * events <count> <json> - has zBus broadcast the event <count> times, all at once
+ * wait <ms>             - waits, e.g. for timed updates to be drawn
+ * resize <rows> <cols>  - resizes the terminal
+ */
+struct Step
+{
+    QString line;           // line of the script
+    QString command;        // key, type, events, wait, or resize
+    QList<QByteArray> keys; // bytes of each key press (key, type)
+    QString event;          // event broadcast (events)
+    int count = 0;          // number of events (events), ms (wait), or rows (resize)
+    int columns = 0;        // columns (resize)
+};
+
+/* What was drawn during one step: the latency of each frame, from its trigger to the last of its
+ * windows being refreshed, and the bytes written to the terminal.
+ */
+struct StepResult
+{
+    QString label;                 // line of the script, or "startup"
+    QVector<qint64> latencies;     // latency of each frame drawn, in ns
+    QHash<QString, int> triggers;  // number of frames drawn for each trigger
+    qint64 bytes = 0;              // bytes written to the terminal
+};
+
+/* \param <latencies> Sorted latencies, in ns.
+ * \param <share> Share of the latencies at or below the percentile, e.g. 0.99.
+ *
+ * \returns Latency at the percentile, or -1 if there are no latencies.
+ */
+static qint64 percentile(const QVector<qint64> &latencies, double share)
+{
+    if (latencies.isEmpty())
+    {
+        return -1;
+    }
+    int index = qMin(int(latencies.size() * share), latencies.size() - 1);
+    return latencies.at(index);
+}
+
+/* \param <ns> Time, in ns.
+ *
+ * \returns Time in ms, e.g. "1.234", or "-" if there is none.
+ */
+static QString milliseconds(qint64 ns)
+{
+    return ns < 0 ? QString("-") : QString::number(ns / 1e6, 'f', 3);
+}
+
+/* \brief Parses a script, one step per line. Blank lines, and lines starting with `#`, are skipped.
+ *
+ * \param <script> Text of the script.
+ * \param <steps> Steps of the script.
+ *
+ * \returns Description of the first line that is not a valid step, or an empty string.
+ */
+static QString parse_script(const QString &script, QVector<Step> &steps)
+{
+    foreach (const QString &text, script.split('\n'))
+    {
+        QString line = text.trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        Step step;
+        step.line = line;
+        step.command = line.section(' ', 0, 0);
+        QString argument = line.section(' ', 1).trimmed();
+        bool valid = !argument.isEmpty();
+
+        if (step.command == "key")
+        {
+            QString name = argument.section(' ', 0, 0);
+            QString repeat = argument.section(' ', 1);
+            int count = repeat.isEmpty() ? 1 : repeat.mid(1).toInt(&valid);
+            QByteArray key = KEYS.value(name, name.size() == 1 ? name.toUtf8() : QByteArray());
+            valid = valid && !key.isEmpty() && count > 0 && (repeat.isEmpty() ||
+                                                             repeat.startsWith('x'));
+            for (int i = 0; i < count; i++)
+            {
+                step.keys.append(key);
+            }
+        }
+        else if (step.command == "type")
+        {
+            foreach (QChar c, argument)
+            {
+                step.keys.append(QString(c).toUtf8());
+            }
+        }
+        else if (step.command == "events")
+        {
+            step.count = argument.section(' ', 0, 0).toInt(&valid);
+            step.event = argument.section(' ', 1);
+            valid = valid && step.count > 0 && !step.event.isEmpty();
+        }
+        else if (step.command == "wait")
+        {
+            step.count = argument.toInt(&valid);
+        }
+        else if (step.command == "resize")
+        {
+            bool columns = false;
+            step.count = argument.section(' ', 0, 0).toInt(&valid);
+            step.columns = argument.section(' ', 1).toInt(&columns);
+            valid = valid && columns && step.count > 0 && step.columns > 0;
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            return QString("invalid step \"%1\"").arg(line);
+        }
+        steps.append(step);
+    }
+
+    return QString();
+}
+
+/* A benchmark of how quickly the interactive UI draws, and how much it writes to the terminal. It
+ * runs `zbus-cli-ent.x` in a pseudo-terminal, connected to a local stand-in for zBus, and runs a
+ * script against it: keys are typed into the terminal, and events are broadcast by the stand-in.
+ *
+ * The UI logs each frame it draws (see `--frame-log`), with the latency from its trigger (input,
+ * the arrival of events, or a resize) to its last window being refreshed. Each step of the script
+ * is finished once the terminal is quiet, and the frames logged and bytes written since the step
+ * before are attributed to it.
+ */
+class TuiBench : public QObject
+{
+    Q_OBJECT
+
+public:
+    TuiBench(const QString &app, int rows, int columns, const QVector<Step> &steps)
+        : app(app), rows(rows), columns(columns), steps(steps)
+    {
+        idle.setSingleShot(true);
+        idle.setInterval(IDLE_MS);
+        connect(&idle, &QTimer::timeout, this, &TuiBench::finishStep);
+        stepTimeout.setSingleShot(true);
+        stepTimeout.setInterval(STEP_TIMEOUT_MS);
+        connect(&stepTimeout, &QTimer::timeout, this, &TuiBench::finishStep);
+        connect(&publisher, &ZWebSocket::connected, this, &TuiBench::beginStep);
+    }
+
+    ~TuiBench()
+    {
+        if (child > 0)
+        {
+            kill(child, SIGTERM);
+            waitpid(child, nullptr, 0);
+        }
+        if (master >= 0)
+        {
+            close(master);
+        }
+    }
+
+    /* \brief Starts the stand-in for zBus, and the UI in a pseudo-terminal connected to it, then
+     *        runs the script once the UI has drawn its first screen.
+     *
+     * \returns An empty string, or a description of why the benchmark could not start.
+     */
+    QString start()
+    {
+        if (!server.listen())
+        {
+            return "unable to start the stand-in for zBus: " + server.errorString();
+        }
+        if (frameLogFile.open())
+        {
+            frameLog.setFileName(frameLogFile.fileName());
+        }
+        if (!frameLog.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        {
+            return "unable to create the frame log";
+        }
+
+        // everything the child needs is prepared before the fork
+        QByteArray path = app.toLocal8Bit();
+        QByteArray url = server.url().toString().toLocal8Bit();
+        QByteArray log = frameLogFile.fileName().toLocal8Bit();
+        struct winsize size = {};
+        size.ws_row = rows;
+        size.ws_col = columns;
+
+        child = forkpty(&master, nullptr, nullptr, &size);
+        if (child < 0)
+        {
+            return QString("unable to open a pseudo-terminal: %1").arg(strerror(errno));
+        }
+        if (child == 0)
+        {
+            setenv("TERM", "xterm-256color", 1);
+            execl(path.constData(), path.constData(), "--websocket", url.constData(),
+                  "--frame-log", log.constData(), static_cast<char *>(nullptr));
+            _exit(127);
+        }
+
+        fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+        output = new QSocketNotifier(master, QSocketNotifier::Read, this);
+        connect(output, &QSocketNotifier::activated, this, &TuiBench::readOutput);
+
+        publisher.open(server.url());
+        return QString();
+    }
+
+signals:
+    void finished(bool completed);
+
+private slots:
+    /* \brief Counts the bytes the UI wrote to the terminal, and holds off finishing the step until
+     *        the terminal is quiet.
+     */
+    void readOutput()
+    {
+        char buffer[65536];
+        ssize_t bytes;
+        while ((bytes = read(master, buffer, sizeof(buffer))) > 0)
+        {
+            result.bytes += bytes;
+        }
+
+        // the pseudo-terminal is hung up once the UI exits
+        if (bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EINTR))
+        {
+            output->setEnabled(false);
+            waitpid(child, nullptr, 0);
+            child = -1;
+            qWarning() << "The UI exited during step" << result.label;
+            emit finished(false);
+            return;
+        }
+
+        if (idle.isActive())
+        {
+            idle.start();
+        }
+    }
+
+    /* \brief Runs the next step of the script, or, before the first step, waits for the UI to draw
+     *        its first screen.
+     */
+    void beginStep()
+    {
+        result = StepResult();
+        result.label = next == 0 ? QString("startup") : steps.at(next - 1).line;
+        stepTimeout.start();
+        if (next == 0)
+        {
+            idle.start();
+            return;
+        }
+
+        const Step &step = steps.at(next - 1);
+        if (!step.keys.isEmpty())
+        {
+            pressKeys(0);
+        }
+        else if (step.command == "events")
+        {
+            publisher.sendZBusEvents({ step.event }, step.count);
+            idle.start();
+        }
+        else if (step.command == "wait")
+        {
+            QTimer::singleShot(step.count, this, [this] { idle.start(); });
+        }
+        else if (step.command == "resize")
+        {
+            // the UI is sent SIGWINCH, as the terminal's foreground process
+            struct winsize size = {};
+            size.ws_row = step.count;
+            size.ws_col = step.columns;
+            ioctl(master, TIOCSWINSZ, &size);
+            idle.start();
+        }
+    }
+
+    /* \brief Attributes the frames logged since the step before to the current step, then begins
+     *        the next, or prints the report after the last.
+     */
+    void finishStep()
+    {
+        idle.stop();
+        stepTimeout.stop();
+        readFrames();
+        std::sort(result.latencies.begin(), result.latencies.end());
+        results.append(result);
+
+        next++;
+        if (next <= steps.size())
+        {
+            beginStep();
+            return;
+        }
+
+        report();
+        emit finished(true);
+    }
+
+private:
+    /* \brief Presses the keys of the current step, from the given one, one every KEY_INTERVAL_MS.
+     *
+     * \param <index> Index of the key to press.
+     */
+    void pressKeys(int index)
+    {
+        const QList<QByteArray> &keys = steps.at(next - 1).keys;
+        if (write(master, keys.at(index).constData(), keys.at(index).size()) < 0)
+        {
+            qWarning() << "Unable to write to the terminal:" << strerror(errno);
+        }
+
+        if (index + 1 < keys.size())
+        {
+            QTimer::singleShot(KEY_INTERVAL_MS, this, [this, index] { pressKeys(index + 1); });
+        }
+        else
+        {
+            idle.start();
+        }
+    }
+
+    /* \brief Reads the frames logged by the UI since the last read into the current step.
+     */
+    void readFrames()
+    {
+        frames += frameLog.readAll();
+        int end;
+        while ((end = frames.indexOf('\n')) != -1)
+        {
+            QList<QByteArray> fields = frames.left(end).split(' ');
+            frames.remove(0, end + 1);
+            if (fields.size() == 3)
+            {
+                result.latencies.append(fields.at(1).toLongLong());
+                result.triggers[QString(fields.at(0))]++;
+            }
+        }
+    }
+
+    /* \brief Prints a table of the frames drawn, their latencies, and the bytes written, for each
+     *        step and in total.
+     */
+    void report()
+    {
+        StepResult total;
+        total.label = "total";
+        foreach (const StepResult &step, results)
+        {
+            total.latencies += step.latencies;
+            total.bytes += step.bytes;
+            for (auto i = step.triggers.constBegin(); i != step.triggers.constEnd(); ++i)
+            {
+                total.triggers[i.key()] += i.value();
+            }
+        }
+        std::sort(total.latencies.begin(), total.latencies.end());
+
+        QTextStream out(stdout);
+        out << QString("terminal %1x%2, frame latency in ms\n").arg(columns).arg(rows);
+        out << QString("%1 %2 %3 %4 %5 %6 %7  %8\n")
+                   .arg("step", -40).arg("frames", 7).arg("p50", 9).arg("p99", 9).arg("max", 9)
+                   .arg("bytes", 10).arg("bytes/frame", 11).arg("triggers");
+
+        QVector<StepResult> table = results;
+        table.append(total);
+        foreach (const StepResult &step, table)
+        {
+            QStringList triggers;
+            for (auto i = step.triggers.constBegin(); i != step.triggers.constEnd(); ++i)
+            {
+                triggers.append(QString("%1 %2").arg(i.key()).arg(i.value()));
+            }
+            triggers.sort();
+
+            int frames = step.latencies.size();
+            out << QString("%1 %2 %3 %4 %5 %6 %7  %8\n")
+                       .arg(step.label.left(40), -40)
+                       .arg(frames, 7)
+                       .arg(milliseconds(percentile(step.latencies, 0.5)), 9)
+                       .arg(milliseconds(percentile(step.latencies, 0.99)), 9)
+                       .arg(milliseconds(step.latencies.isEmpty() ? -1 : step.latencies.last()), 9)
+                       .arg(step.bytes, 10)
+                       .arg(frames > 0 ? QString::number(step.bytes / frames) : QString("-"), 11)
+                       .arg(triggers.join(", "));
+        }
+    }
+
+    QString app;                    // path of zbus-cli-ent.x
+    int rows;                       // initial size of the terminal
+    int columns;
+    QVector<Step> steps;            // steps of the script
+    BroadcastServer server;         // stand-in for zBus
+    ZWebSocket publisher;           // sends the events of the script to the stand-in
+    QTemporaryFile frameLogFile;    // frame log the UI writes to
+    QFile frameLog;                 // frame log, as it is read
+    QByteArray frames;              // frame log read, but not yet parsed
+    pid_t child = -1;               // process of the UI
+    int master = -1;                // controlling side of the pseudo-terminal
+    QSocketNotifier *output = nullptr;
+    QTimer idle;                    // finishes the step once the terminal is quiet
+    QTimer stepTimeout;             // finishes the step if the terminal is never quiet
+    int next = 0;                   // step being run, from 1 (0 == startup)
+    StepResult result;              // what was drawn in the current step
+    QVector<StepResult> results;    // what was drawn in each step finished so far
+};
+
+/* \brief Runs the UI in a pseudo-terminal of the given size, runs a script of key presses and
+ *        inbound events against it, and prints the latency of the frames drawn, and the bytes
+ *        written to the terminal, for each step of the script.
+ *
+ * \param <argc> Number of arguments provided to the command line (including the program name!).
+ * \param <argv> Array of arguments provided to the command line.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Measures how quickly zbus-cli-ent.x draws its UI.");
+  parser.addHelpOption();
+  parser.addOption({"app",
+                    QCoreApplication::translate("main", "path of zbus-cli-ent.x"),
+                    QCoreApplication::translate("main", "path"),
+                    "../../zbus-cli-ent.x"});
+  parser.addOption({"rows",
+                    QCoreApplication::translate("main", "rows of the terminal (default 40)"),
+                    QCoreApplication::translate("main", "rows"),
+                    "40"});
+  parser.addOption({"columns",
+                    QCoreApplication::translate("main", "columns of the terminal (default 120)"),
+                    QCoreApplication::translate("main", "columns"),
+                    "120"});
+  parser.addOption({"script",
+                    QCoreApplication::translate("main", "run the steps in <file>, rather than the "
+                                                        "default script"),
+                    QCoreApplication::translate("main", "file")});
+  parser.process(app);
+
+  QString script = DEFAULT_SCRIPT;
+  if (parser.isSet("script"))
+  {
+      QFile file(parser.value("script"));
+      if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+      {
+          qWarning() << "Unable to read the script:" << file.errorString();
+          return 1;
+      }
+      script = QString::fromUtf8(file.readAll());
+  }
+
+  QVector<Step> steps;
+  QString error = parse_script(script, steps);
+  if (!error.isEmpty())
+  {
+      qWarning() << "Unable to parse the script:" << error;
+      return 1;
+  }
+
+  TuiBench bench(parser.value("app"), parser.value("rows").toInt(),
+                 parser.value("columns").toInt(), steps);
+  QObject::connect(&bench, &TuiBench::finished,
+                   &app, [&app] (bool completed) { app.exit(completed ? 0 : 1); });
+  error = bench.start();
+  if (!error.isEmpty())
+  {
+      qWarning() << "Unable to start the benchmark:" << error;
+      return 1;
+  }
+
+  return app.exec();
+}
+
+#include "tuibench.moc"
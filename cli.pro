@@ -0,0 +1,38 @@
+TEMPLATE = app
+CONFIG += warn_all console
+QT += core network websockets
+QT -= gui
+LIBS += libzbusclient.a -lform -lncurses -lrt
+PRE_TARGETDEPS += libzbusclient.a
+
+TARGET = zbus-cli-ent.x
+
+HEADERS += src/eventawaiter.h
+HEADERS += src/eventpipeline.h
+HEADERS += src/eventrecord.h
+HEADERS += src/fanoutbench.h
+HEADERS += src/heightindex.h
+HEADERS += src/jsontree.h
+HEADERS += src/pinpadsimulator.h
+HEADERS += src/ratelimiter.h
+HEADERS += src/sendsession.h
+HEADERS += src/zbuscli.h
+HEADERS += src/zconnection.h
+HEADERS += src/zdaemon.h
+
+SOURCES += src/eventawaiter.cpp
+SOURCES += src/eventpipeline.cpp
+SOURCES += src/eventrecord.cpp
+SOURCES += src/fanoutbench.cpp
+SOURCES += src/heightindex.cpp
+SOURCES += src/jsontree.cpp
+SOURCES += src/main.cpp
+SOURCES += src/pinpadsimulator.cpp
+SOURCES += src/ratelimiter.cpp
+SOURCES += src/sendsession.cpp
+SOURCES += src/zbuscli.cpp
+SOURCES += src/zconnection.cpp
+SOURCES += src/zdaemon.cpp
+
+target.path = .
+INSTALLS += target
@@ -0,0 +1,85 @@
+#include "broadcastserver.h"
+
+#include <QWebSocket>
+
+/* \brief Constructs a BroadcastServer, which does not listen until `listen` is called.
+ *
+ * \param <parent> Parent of this instantiation of BroadcastServer.
+ */
+BroadcastServer::BroadcastServer(QObject *parent)
+    : QObject(parent), server("zbus", QWebSocketServer::NonSecureMode)
+{
+    connect(&server, &QWebSocketServer::newConnection, this, &BroadcastServer::acceptConnection);
+}
+
+/* \brief Listens for websocket connections. It only accepts clients on this machine, unless it is
+ *        bound to another address.
+ *
+ * \param <port> Port to listen on (0 == any free port).
+ * \param <address> Address to listen on (QHostAddress::Any == every interface).
+ *
+ * \returns True if the server is listening.
+ */
+bool BroadcastServer::listen(quint16 port, const QHostAddress &address)
+{
+    return server.listen(address, port);
+}
+
+/* \returns Why the server is not listening, if it is not.
+ */
+QString BroadcastServer::errorString() const
+{
+    return server.errorString();
+}
+
+/* \returns URL that clients on this machine can connect to, e.g. "ws://127.0.0.1:8180".
+ */
+QUrl BroadcastServer::url() const
+{
+    QHostAddress address = server.serverAddress();
+    bool any = address == QHostAddress::Any || address == QHostAddress::AnyIPv4 ||
+               address == QHostAddress::AnyIPv6;
+
+    QUrl url;
+    url.setScheme("ws");
+    url.setHost(any ? "127.0.0.1" : address.toString());
+    url.setPort(server.serverPort());
+    return url;
+}
+
+/* \returns Number of connected clients.
+ */
+int BroadcastServer::clientCount() const
+{
+    return clients.size();
+}
+
+/* \brief Accepts the pending client connections, and broadcasts the messages they send.
+ */
+void BroadcastServer::acceptConnection()
+{
+    while (server.hasPendingConnections())
+    {
+        QWebSocket *client = server.nextPendingConnection();
+        clients.append(client);
+        connect(client, &QWebSocket::textMessageReceived, this, &BroadcastServer::broadcast);
+        connect(client, &QWebSocket::disconnected, this,
+                [this, client]
+                {
+                    clients.removeOne(client);
+                    client->deleteLater();
+                });
+    }
+}
+
+/* \brief Sends a message to every connected client.
+ *
+ * \param <message> Text of the message.
+ */
+void BroadcastServer::broadcast(const QString &message)
+{
+    foreach (QWebSocket *client, clients)
+    {
+        client->sendTextMessage(message);
+    }
+}
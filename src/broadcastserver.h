@@ -0,0 +1,41 @@
+#ifndef BROADCAST_SERVER_H
+#define BROADCAST_SERVER_H
+
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QWebSocketServer>
+
+class QWebSocket;
+
+/* A local stand-in for zBus, for benchmarks and tests: a websocket server that broadcasts every
+ * text message it receives, as is, to every connected client, including the one that sent it.
+ *
+ * It runs on the thread it lives on, so its own fan-out cost is included in what is measured
+ * against it; unlike zBus, it does not check the origin of clients.
+ */
+class BroadcastServer : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(BroadcastServer)
+
+public:
+    BroadcastServer(QObject *parent = nullptr);
+
+    bool listen(quint16 port = 0, const QHostAddress &address = QHostAddress::LocalHost);
+    QString errorString() const;
+    QUrl url() const;
+    int clientCount() const;
+
+private slots:
+    void acceptConnection();
+    void broadcast(const QString &message);
+
+private:
+    QWebSocketServer server;
+    QList<QWebSocket *> clients;  // connected clients, owned by the server
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "decodepool.h"
+
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QVector>
+
+// Frames shorter than this, in bytes, are decoded inline rather than handed to a worker.
+static const int INLINE_DECODE_SIZE = 4096;
+
+/* Decodes a single frame on a worker thread, and hands the event back to the pool.
+ */
+class DecodeTask : public QRunnable
+{
+public:
+    DecodeTask(DecodePool *pool, quint64 sequence, const QByteArray &text, int size,
+               qint64 timestamp)
+        : pool(pool), sequence(sequence), text(text), size(size), timestamp(timestamp)
+    {
+    }
+
+    void run() override
+    {
+        ZBusEvent event(QJsonDocument::fromJson(text).object());
+        event.timestamp = timestamp;
+        pool->complete(sequence, event, size);
+    }
+
+private:
+    DecodePool *pool;
+    quint64 sequence;
+    QByteArray text;
+    int size;
+    qint64 timestamp;
+};
+
+/* \brief Constructs a DecodePool with the given number of worker threads, which are started as
+ *        frames are submitted.
+ *
+ * \param <threads> Maximum number of frames decoded at once.
+ * \param <parent> Parent of this instantiation of DecodePool.
+ */
+DecodePool::DecodePool(int threads, QObject *parent)
+    : QObject(parent), drainScheduled(false), submitted(0), next(1)
+{
+    pool.setMaxThreadCount(qMax(threads, 1));
+}
+
+/* \brief Waits for the workers to finish decoding the frames they were handed. Events that have not
+ *        been emitted yet are discarded.
+ */
+DecodePool::~DecodePool()
+{
+    pool.waitForDone();
+}
+
+/* \brief Numbers a frame, and decodes it, on a worker if it is large, or inline if it is small. The
+ *        event is emitted by `decoded` once every frame submitted before it has been emitted.
+ *
+ * \param <text> JSON text of the frame, in UTF-8.
+ * \param <size> Size of the text of the frame, in bytes.
+ * \param <timestamp> Time the frame arrived, in ns on ZClock.
+ */
+void DecodePool::submit(const QByteArray &text, int size, qint64 timestamp)
+{
+    quint64 sequence = ++submitted;
+    if (text.size() >= INLINE_DECODE_SIZE)
+    {
+        pool.start(new DecodeTask(this, sequence, text, size, timestamp));
+        return;
+    }
+
+    ZBusEvent event(QJsonDocument::fromJson(text).object());
+    event.timestamp = timestamp;
+
+    QMutexLocker locker(&mutex);
+    if (sequence != next)
+    {
+        results.insert(sequence, { event, size });
+        return;
+    }
+
+    // nothing is ahead of the frame, so it skips the reorder buffer, and then releases any events
+    // the workers finished while waiting for it
+    next++;
+    locker.unlock();
+    emit decoded(event, size);
+    drain();
+}
+
+/* \brief Stores an event decoded by a worker until the events before it have been emitted, and
+ *        schedules a drain on the owning thread. Called on the worker thread.
+ *
+ * \param <sequence> Sequence number of the frame.
+ * \param <event> Decoded event.
+ * \param <size> Size of the text of the frame, in bytes.
+ */
+void DecodePool::complete(quint64 sequence, const ZBusEvent &event, int size)
+{
+    QMutexLocker locker(&mutex);
+    results.insert(sequence, { event, size });
+    if (sequence == next && !drainScheduled)
+    {
+        drainScheduled = true;
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+    }
+}
+
+/* \brief Emits every decoded event that is next in sequence, in order, on the owning thread.
+ */
+void DecodePool::drain()
+{
+    QVector<Decoded> ready;
+    {
+        QMutexLocker locker(&mutex);
+        drainScheduled = false;
+        for (auto result = results.find(next); result != results.end();
+             result = results.find(next))
+        {
+            ready.append(*result);
+            results.erase(result);
+            next++;
+        }
+    }
+
+    for (const Decoded &result : ready)
+    {
+        emit decoded(result.event, result.size);
+    }
+}
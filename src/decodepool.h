@@ -0,0 +1,54 @@
+#ifndef DECODE_POOL_H
+#define DECODE_POOL_H
+
+#include "zbusevent.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+
+/* A pool of worker threads that parse the JSON text of events received from zBus in parallel, so
+ * that decoding a burst of large events is not limited to the speed of the thread receiving them.
+ *
+ * Each frame is numbered as it is submitted, and decoded events are emitted on the thread that owns
+ * the pool strictly in that order, however the workers finish, so consumers see the same sequence
+ * of events as with inline decoding. Small frames are decoded inline, since handing them to a
+ * worker costs more than parsing them, but still wait their turn behind any larger frame that is
+ * being decoded.
+ */
+class DecodePool : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DecodePool)
+
+public:
+    DecodePool(int threads, QObject *parent = nullptr);
+    ~DecodePool();
+
+    void submit(const QByteArray &text, int size, qint64 timestamp);
+    void complete(quint64 sequence, const ZBusEvent &event, int size);
+
+signals:
+    void decoded(const ZBusEvent &event, int size);
+
+private slots:
+    void drain();
+
+private:
+    struct Decoded
+    {
+        ZBusEvent event;  // decoded event, timestamped with when it arrived
+        int size;         // size of the text of the event, in bytes
+    };
+
+    QThreadPool pool;                 // workers
+    QMutex mutex;                     // guards the members below, which workers complete into
+    QHash<quint64, Decoded> results;  // decoded events waiting for earlier events to be decoded
+    bool drainScheduled;              // whether a drain has been queued on the owning thread
+    quint64 submitted;                // sequence number of the last frame submitted
+    quint64 next;                     // sequence number of the next event to be emitted
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "duplicatefilter.h"
+
+#include <QHash>
+
+// How long a frame waits for the other websocket to receive it too, in ns.
+static const qint64 MAX_AGE_NS = 1000000000;
+
+// Most frames that wait for the other websocket to receive them too, per websocket.
+static const int MAX_UNMATCHED = 4096;
+
+/* \brief Constructs a DuplicateFilter for two websockets (sources 0 and 1), neither of which is
+ *        active yet.
+ */
+DuplicateFilter::DuplicateFilter() : dropped(0)
+{
+    active[0] = active[1] = false;
+}
+
+/* \brief Decides whether a frame received by one of the websockets is let through, or dropped as
+ *        a duplicate of a frame the other websocket let through.
+ *
+ * \param <source> Websocket that received the frame (0 or 1).
+ * \param <frame> Text of the frame.
+ * \param <timestamp> Time the frame was received, in ns on ZClock.
+ *
+ * \returns True if the frame is let through.
+ */
+bool DuplicateFilter::accept(int source, const QByteArray &frame, qint64 timestamp)
+{
+    uint hash = qHash(frame);
+
+    // the other websocket may be ahead of this one, if it let the frame through already
+    QQueue<Frame> &other = unmatched[1 - source];
+    for (int i = 0; i < other.size(); i++)
+    {
+        if (other.at(i).hash == hash && other.at(i).text == frame)
+        {
+            other.erase(other.begin(), other.begin() + i + 1);
+            dropped.fetchAndAddRelaxed(1);
+            return false;
+        }
+    }
+
+    // otherwise, this websocket is ahead, and the other one should receive the frame shortly
+    if (active[1 - source])
+    {
+        QQueue<Frame> &own = unmatched[source];
+        while (!own.isEmpty()
+               && (own.size() >= MAX_UNMATCHED || timestamp - own.head().timestamp > MAX_AGE_NS))
+        {
+            own.dequeue();
+        }
+        own.enqueue({ frame, hash, timestamp });
+    }
+    return true;
+}
+
+/* \brief Records whether one of the websockets is connected. While a websocket is not connected,
+ *        the frames the other one lets through are not queued, since it will not receive them.
+ *
+ * \param <source> Websocket (0 or 1).
+ * \param <active> Whether the websocket is connected.
+ */
+void DuplicateFilter::setActive(int source, bool active)
+{
+    this->active[source] = active;
+    if (!active)
+    {
+        unmatched[1 - source].clear();
+    }
+}
+
+/* \returns Number of frames dropped as duplicates. May be called from any thread.
+ */
+qint64 DuplicateFilter::duplicates() const
+{
+    return dropped.load();
+}
@@ -0,0 +1,47 @@
+#ifndef DUPLICATE_FILTER_H
+#define DUPLICATE_FILTER_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QQueue>
+
+/* Drops the frames that a pair of websockets, connected to the same zBus server, both receive, so
+ * that each event broadcast by the server is let through once, by whichever websocket receives it
+ * first.
+ *
+ * The server broadcasts events to every websocket in the same order, so each websocket keeps a
+ * queue of the frames it let through that the other has not received yet. A frame that is in the
+ * other websocket's queue is a duplicate, and is dropped, along with the frames queued before it,
+ * which this websocket never received (e.g. because it connected after they were broadcast).
+ * Otherwise, the frame is let through, and queued until the other websocket receives it too. An
+ * event that is broadcast twice is let through twice, since each copy is matched once.
+ *
+ * Frames are only queued while the other websocket is active, and for at most MAX_AGE_NS, so a
+ * websocket that lags behind the other by more than that lets its duplicates through.
+ *
+ * Not thread-safe: both websockets must live on the same thread. Only `duplicates` may be called
+ * from other threads.
+ */
+class DuplicateFilter
+{
+public:
+    DuplicateFilter();
+
+    bool accept(int source, const QByteArray &frame, qint64 timestamp);
+    void setActive(int source, bool active);
+    qint64 duplicates() const;
+
+private:
+    struct Frame
+    {
+        QByteArray text;    // text of the frame, shared with whoever else holds it
+        uint hash;          // hash of the text, compared before the text itself
+        qint64 timestamp;   // time the frame was received, in ns on ZClock
+    };
+
+    QQueue<Frame> unmatched[2];      // frames let through by each source, not seen by the other
+    bool active[2];                  // whether each source is connected
+    QAtomicInteger<qint64> dropped;  // number of frames dropped as duplicates
+};
+
+#endif
@@ -0,0 +1,342 @@
+#include "envelopescanner.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* \brief Finds the next quote or backslash, i.e. the end of a string, or an escape sequence in it.
+ *
+ * \param <text> JSON text.
+ * \param <pos> Offset to start searching from.
+ * \param <size> Size of the text, in bytes.
+ *
+ * \returns Offset of the quote or backslash, or the size of the text if there is none.
+ */
+static int find_quote(const char *text, int pos, int size)
+{
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; pos + 16 <= size; pos += 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + pos));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                                  _mm_cmpeq_epi8(block, backslash)));
+        if (mask != 0)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    while (pos < size && text[pos] != '"' && text[pos] != '\\')
+    {
+        pos++;
+    }
+    return pos;
+}
+
+/* \brief Finds the next character that changes the nesting of JSON text: a quote, or a bracket or
+ *        brace. Setting bit 0x20 maps '[' and ']' onto '{' and '}', so only three comparisons are
+ *        needed per block.
+ *
+ * \param <text> JSON text.
+ * \param <pos> Offset to start searching from.
+ * \param <size> Size of the text, in bytes.
+ *
+ * \returns Offset of the character, or the size of the text if there is none.
+ */
+static int find_structural(const char *text, int pos, int size)
+{
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    for (; pos + 16 <= size; pos += 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + pos));
+        __m128i folded = _mm_or_si128(block, lower);
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                       _mm_or_si128(_mm_cmpeq_epi8(folded, open),
+                                                    _mm_cmpeq_epi8(folded, close)));
+        int mask = _mm_movemask_epi8(matches);
+        if (mask != 0)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    while (pos < size && text[pos] != '"' && (text[pos] | 0x20) != '{' && (text[pos] | 0x20) != '}')
+    {
+        pos++;
+    }
+    return pos;
+}
+
+/* The state of a single scan of JSON text.
+ */
+class Scanner
+{
+public:
+    Scanner(const char *text, int size) : text(text), size(size), pos(0)
+    {
+    }
+
+    /* \brief Scans the text, which must be a single JSON object, for the envelope fields.
+     *
+     * \returns True if the structure of the text is valid.
+     */
+    bool envelope(ZBusEnvelope &envelope)
+    {
+        skip_space();
+        if (peek() != '{' || !object(0, envelope))
+        {
+            return false;
+        }
+
+        skip_space();
+        return pos == size;
+    }
+
+private:
+    char peek() const
+    {
+        return pos < size ? text[pos] : '\0';
+    }
+
+    void skip_space()
+    {
+        while (pos < size && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' ||
+                              text[pos] == '\r'))
+        {
+            pos++;
+        }
+    }
+
+    /* \brief Scans the members of the object at the current position. At depth 0, the envelope
+     *        fields are recorded; at depth 1 (the data), the authAttemptId is. Values at any other
+     *        depth are skipped.
+     */
+    bool object(int depth, ZBusEnvelope &envelope)
+    {
+        pos++;
+        skip_space();
+        if (peek() == '}')
+        {
+            pos++;
+            return true;
+        }
+
+        while (true)
+        {
+            ZBusEnvelope::Field key;
+            skip_space();
+            if (peek() != '"' || !string(&key))
+            {
+                return false;
+            }
+
+            skip_space();
+            if (peek() != ':')
+            {
+                return false;
+            }
+            pos++;
+            skip_space();
+
+            ZBusEnvelope::Field *field = nullptr;
+            if (depth == 0 && is(key, "event"))
+            {
+                field = &envelope.event;
+            }
+            else if (depth == 0 && is(key, "requestId"))
+            {
+                field = &envelope.requestId;
+            }
+            else if (depth == 1 && is(key, "authAttemptId"))
+            {
+                field = &envelope.authAttemptId;
+            }
+
+            bool valid;
+            if (depth == 0 && is(key, "data"))
+            {
+                int start = pos;
+                valid = peek() == '{' ? object(1, envelope) : value();
+                envelope.data.offset = start;
+                envelope.data.size = pos - start;
+            }
+            else if (field != nullptr && peek() == '"')
+            {
+                valid = string(field);
+            }
+            else
+            {
+                valid = value();
+            }
+            if (!valid)
+            {
+                return false;
+            }
+
+            skip_space();
+            if (peek() == ',')
+            {
+                pos++;
+            }
+            else if (peek() == '}')
+            {
+                pos++;
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+    }
+
+    /* \brief Skips the string at the current position, recording where its contents are.
+     */
+    bool string(ZBusEnvelope::Field *field)
+    {
+        int start = ++pos;
+        bool escaped = false;
+        while (true)
+        {
+            pos = find_quote(text, pos, size);
+            if (pos >= size)
+            {
+                return false;
+            }
+            if (text[pos] == '"')
+            {
+                break;
+            }
+
+            escaped = true;
+            pos += 2;
+        }
+
+        field->offset = start;
+        field->size = pos - start;
+        field->escaped = escaped;
+        pos++;
+        return true;
+    }
+
+    /* \brief Skips the value at the current position: a string, an object or array (and everything
+     *        nested in it), or a number or literal.
+     */
+    bool value()
+    {
+        char c = peek();
+        if (c == '"')
+        {
+            ZBusEnvelope::Field ignored;
+            return string(&ignored);
+        }
+
+        if (c == '{' || c == '[')
+        {
+            int depth = 0;
+            while (pos < size)
+            {
+                c = text[pos];
+                if (c == '"')
+                {
+                    ZBusEnvelope::Field ignored;
+                    if (!string(&ignored))
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    depth += (c | 0x20) == '{' ? 1 : -1;
+                    pos++;
+                    if (depth == 0)
+                    {
+                        return true;
+                    }
+                }
+                pos = find_structural(text, pos, size);
+            }
+            return false;
+        }
+
+        int start = pos;
+        while (pos < size && strchr(",}] \t\r\n", text[pos]) == nullptr)
+        {
+            pos++;
+        }
+        return pos > start;
+    }
+
+    bool is(const ZBusEnvelope::Field &key, const char *name) const
+    {
+        return !key.escaped && key.size == int(strlen(name)) &&
+               memcmp(text + key.offset, name, key.size) == 0;
+    }
+
+    const char *text;
+    int size;
+    int pos;
+};
+
+/* \brief Finds the envelope fields of a zBus event in its JSON text.
+ *
+ * \param <text> JSON text of the event, in UTF-8.
+ * \param <size> Size of the text, in bytes.
+ * \param <envelope> Envelope to be filled in; fields that are not found are left absent.
+ *
+ * \returns True if the text is a JSON object with a valid structure.
+ */
+bool EnvelopeScanner::scan(const char *text, int size, ZBusEnvelope &envelope)
+{
+    envelope = ZBusEnvelope();
+    return Scanner(text, size).envelope(envelope);
+}
+
+/* \brief Finds the envelope fields of a zBus event in its JSON text.
+ *
+ * \param <text> JSON text of the event, in UTF-8.
+ * \param <envelope> Envelope to be filled in; fields that are not found are left absent.
+ *
+ * \returns True if the text is a JSON object with a valid structure.
+ */
+bool EnvelopeScanner::scan(const QByteArray &text, ZBusEnvelope &envelope)
+{
+    return scan(text.constData(), text.size(), envelope);
+}
+
+/* \brief Decodes a field found by `scan`. Strings without escape sequences are converted directly;
+ *        others are decoded by the full JSON parser.
+ *
+ * \param <text> JSON text that was scanned.
+ * \param <field> Field of the envelope.
+ *
+ * \returns The value of the field, or an empty string if the field is not present.
+ */
+QString EnvelopeScanner::string(const QByteArray &text, const ZBusEnvelope::Field &field)
+{
+    if (!field.isPresent())
+    {
+        return QString();
+    }
+
+    if (!field.escaped)
+    {
+        return QString::fromUtf8(text.constData() + field.offset, field.size);
+    }
+
+    QByteArray array = "[\"" + text.mid(field.offset, field.size) + "\"]";
+    return QJsonDocument::fromJson(array).array().at(0).toString();
+}
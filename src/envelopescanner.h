@@ -0,0 +1,48 @@
+#ifndef ENVELOPE_SCANNER_H
+#define ENVELOPE_SCANNER_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QString>
+
+/* The location of the envelope fields of a zBus event in its JSON text: the fields needed to route
+ * or filter the event, without parsing its data.
+ */
+struct ZBusEnvelope
+{
+    // A string value (without its quotes), or the raw JSON text of any other value.
+    struct Field
+    {
+        int offset = -1;       // offset of the value in the text (-1 == not present)
+        int size = 0;          // size of the value, in bytes
+        bool escaped = false;  // whether the string contains escape sequences
+
+        bool isPresent() const { return offset >= 0; }
+    };
+
+    Field event;          // "event", e.g. "pinpad.cardInfo"
+    Field requestId;      // "requestId"
+    Field authAttemptId;  // "data"."authAttemptId"
+    Field data;           // "data", as raw JSON text
+};
+
+Q_DECLARE_METATYPE(ZBusEnvelope)
+
+/* A structural scanner that finds the envelope fields of a zBus event in its UTF-8 JSON text in a
+ * single pass, without allocating, and without building a QJsonDocument. Strings, and nested
+ * values that are skipped over, are searched 16 bytes at a time with SSE2, where available.
+ *
+ * The scanner checks the structure of the text (quotes, brackets, and braces) rather than
+ * validating every value, so text that it accepts may still be rejected by a full JSON parser.
+ * Fields are decoded with `string`, which only falls back to the full parser for strings that
+ * contain escape sequences.
+ */
+class EnvelopeScanner
+{
+public:
+    static bool scan(const char *text, int size, ZBusEnvelope &envelope);
+    static bool scan(const QByteArray &text, ZBusEnvelope &envelope);
+    static QString string(const QByteArray &text, const ZBusEnvelope::Field &field);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "eventawaiter.h"
+
+#include "zbusevent.h"
+
+/* \brief Constructs an EventAwaiter for events whose names match the given wildcard pattern.
+ *
+ * \param <pattern> Wildcard pattern, e.g. "pinpad.*", matched against the entire event name.
+ * \param <now> Time waiting starts, in ns on a monotonic clock.
+ */
+EventAwaiter::EventAwaiter(const QString &pattern, qint64 now)
+    : pattern(pattern, Qt::CaseSensitive, QRegExp::Wildcard), lastSent(now)
+{
+}
+
+/* \returns True if the pattern is a valid wildcard pattern.
+ */
+bool EventAwaiter::isValid() const
+{
+    return pattern.isValid() && !pattern.isEmpty();
+}
+
+/* \brief Records an event that was sent, so that latency is measured from it, a matching event
+ *        must have its `requestId` (if it has one), and its echo is not mistaken for a match.
+ *
+ * \param <event> Event that was sent to zBus.
+ * \param <now> Time the event was sent, in ns on a monotonic clock.
+ */
+void EventAwaiter::recordSent(const ZBusEvent &event, qint64 now)
+{
+    recordSent(event.name(), event.requestId, now);
+}
+
+/* \brief Records an event that was sent by its name and `requestId`, so that events can be
+ *        recorded by their envelope, without being decoded.
+ *
+ * \param <name> Name of the event that was sent to zBus.
+ * \param <requestId> `requestId` of the event (empty == none).
+ * \param <now> Time the event was sent, in ns on a monotonic clock.
+ */
+void EventAwaiter::recordSent(const QString &name, const QString &requestId, qint64 now)
+{
+    if (!requestId.isEmpty())
+    {
+        requestIds.insert(requestId);
+    }
+    echoes[name + '\n' + requestId]++;
+    lastSent = now;
+}
+
+/* \brief Determines whether the given event is the awaited event. See the other overload.
+ *
+ * \param <event> Event received from zBus.
+ *
+ * \returns True if the event matches the pattern, and the `requestId` of a sent event, if any.
+ */
+bool EventAwaiter::matches(const ZBusEvent &event)
+{
+    return matches(event.name(), event.requestId);
+}
+
+/* \brief Determines whether an event with the given name and `requestId` is the awaited event, so
+ *        that events can be matched by their envelope, without being decoded. Every event received
+ *        must be passed in, in order, since the first copy of each sent event is taken to be its
+ *        echo, and skipped.
+ *
+ * \param <name> Name of the event received from zBus.
+ * \param <requestId> `requestId` of the event (empty == none).
+ *
+ * \returns True if the name matches the pattern, the `requestId` is that of a sent event, if any,
+ *          and the event is not the echo of a sent event.
+ */
+bool EventAwaiter::matches(const QString &name, const QString &requestId)
+{
+    QHash<QString, int>::iterator echo = echoes.find(name + '\n' + requestId);
+    if (echo != echoes.end())
+    {
+        if (--echo.value() == 0)
+        {
+            echoes.erase(echo);
+        }
+        return false;
+    }
+
+    return pattern.exactMatch(name) && (requestIds.isEmpty() || requestIds.contains(requestId));
+}
+
+/* \param <now> Time the awaited event was received, in ns on a monotonic clock.
+ *
+ * \returns Time between the most recently sent event (or the start of waiting) and now, in ns.
+ */
+qint64 EventAwaiter::latency(qint64 now) const
+{
+    return now - lastSent;
+}
@@ -0,0 +1,37 @@
+#ifndef EVENT_AWAITER_H
+#define EVENT_AWAITER_H
+
+#include <QHash>
+#include <QRegExp>
+#include <QSet>
+#include <QString>
+
+class ZBusEvent;
+
+/* Matches received events against the event awaited by `--await`, and measures the latency of the
+ * match. An event matches if its name matches the wildcard pattern (e.g. "pinpad.card*") and, if
+ * any event that was sent had a `requestId`, its `requestId` is one of those. zBus echoes every
+ * event back to its sender, so the first copy received of each event that was sent is skipped.
+ * Latency is measured from the most recently sent event, or from the start of waiting if no event
+ * has been sent.
+ */
+class EventAwaiter
+{
+public:
+    EventAwaiter(const QString &pattern, qint64 now);
+
+    bool isValid() const;
+    void recordSent(const ZBusEvent &event, qint64 now);
+    void recordSent(const QString &name, const QString &requestId, qint64 now);
+    bool matches(const ZBusEvent &event);
+    bool matches(const QString &name, const QString &requestId);
+    qint64 latency(qint64 now) const;
+
+private:
+    QRegExp pattern;             // wildcard pattern matched against the event name
+    QSet<QString> requestIds;    // requestIds of the events sent, which a match must have one of
+    QHash<QString, int> echoes;  // number of echoes still expected, by name and requestId
+    qint64 lastSent;             // time the last event was sent, or waiting started, in ns
+};
+
+#endif
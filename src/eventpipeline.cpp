@@ -0,0 +1,232 @@
+#include "eventpipeline.h"
+
+#include "zclock.h"
+
+#include <QJsonDocument>
+
+#include <algorithm>
+
+/* \returns Name of the event, e.g. "pinpad.cardInfo", from its envelope.
+ */
+QString InboundEvent::name() const
+{
+    return EnvelopeScanner::string(text, envelope.event);
+}
+
+/* \returns Domain of the event, e.g. "pinpad", from its envelope: the name up to its last dot, as
+ *          in ZBusEvent.
+ */
+QString InboundEvent::domain() const
+{
+    QString name = this->name().trimmed();
+    int dot = name.lastIndexOf('.');
+    return dot == -1 ? QString() : name.left(dot);
+}
+
+/* \returns `requestId` of the event, from its envelope (empty == none).
+ */
+QString InboundEvent::requestId() const
+{
+    return EnvelopeScanner::string(text, envelope.requestId);
+}
+
+/* \returns `authAttemptId` of the data of the event, from its envelope (empty == none).
+ */
+QString InboundEvent::authAttemptId() const
+{
+    return EnvelopeScanner::string(text, envelope.authAttemptId);
+}
+
+/* \brief Parses the full event, for a stage that needs its data. Parsing is the costly part of
+ *        receiving an event, so stages that only need its envelope should not call this.
+ *
+ * \returns The event, timestamped with when it arrived.
+ */
+ZBusEvent InboundEvent::event() const
+{
+    ZBusEvent event(QJsonDocument::fromJson(text).object());
+    event.timestamp = timestamp;
+    return event;
+}
+
+EventStage::~EventStage()
+{
+}
+
+/* \brief Constructs a sink that hands each event of a batch to the given function.
+ *
+ * \param <consume> Function that consumes, or changes, a single event.
+ */
+EventSink::EventSink(const std::function<void(InboundEvent &event)> &consume) : consume(consume)
+{
+}
+
+/* \brief Hands each event of the batch to the sink's function, in order.
+ *
+ * \param <events> Batch of events.
+ */
+void EventSink::process(QVector<InboundEvent> &events)
+{
+    for (InboundEvent &event : events)
+    {
+        consume(event);
+    }
+}
+
+/* \brief Constructs a filter that keeps the events that match the given predicate.
+ *
+ * \param <accept> Predicate that returns true for the events to be kept.
+ */
+EventFilter::EventFilter(const std::function<bool(const InboundEvent &event)> &accept)
+    : accept(accept)
+{
+}
+
+/* \brief Removes the events that do not match the predicate from the batch, keeping the order of the
+ *        rest, in a single pass.
+ *
+ * \param <events> Batch of events.
+ */
+void EventFilter::process(QVector<InboundEvent> &events)
+{
+    auto end = std::remove_if(events.begin(), events.end(),
+                              [this] (const InboundEvent &event) { return !accept(event); });
+    events.erase(end, events.end());
+}
+
+/* \brief Constructs a recorder that appends to the file with the given name, creating it if it does
+ *        not exist.
+ *
+ * \param <fileName> Name of the file events are recorded to.
+ */
+RecorderSink::RecorderSink(const QString &fileName) : file(fileName)
+{
+    file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
+
+/* \returns True if the file could be opened for recording.
+ */
+bool RecorderSink::isOpen() const
+{
+    return file.isOpen();
+}
+
+/* \returns Reason the file could not be opened, or written to, if any.
+ */
+QString RecorderSink::errorString() const
+{
+    return file.errorString();
+}
+
+/* \brief Appends each event of the batch to the file, then flushes the file once for the whole
+ *        batch. Line breaks, which can only be whitespace in JSON, are replaced, so that each event
+ *        is one line.
+ *
+ * \param <events> Batch of events.
+ */
+void RecorderSink::process(QVector<InboundEvent> &events)
+{
+    if (!file.isOpen())
+    {
+        return;
+    }
+
+    for (const InboundEvent &event : events)
+    {
+        if (event.text.contains('\n') || event.text.contains('\r'))
+        {
+            file.write(QByteArray(event.text).replace('\n', ' ').replace('\r', ' '));
+        }
+        else
+        {
+            file.write(event.text);
+        }
+        file.write("\n");
+    }
+    file.flush();
+}
+
+/* \brief Constructs an empty pipeline, which passes batches through unchanged.
+ */
+EventPipeline::EventPipeline()
+{
+}
+
+/* \brief Deletes the stages of the pipeline.
+ */
+EventPipeline::~EventPipeline()
+{
+    for (const Stage &stage : stages)
+    {
+        delete stage.stage;
+    }
+}
+
+/* \brief Adds a stage to the end of the pipeline, which takes ownership of it.
+ *
+ * \param <name> Name of the stage, as displayed with its cost.
+ * \param <stage> Stage to be added.
+ */
+void EventPipeline::append(const QString &name, EventStage *stage)
+{
+    insert(stages.size(), name, stage);
+}
+
+/* \brief Adds a stage to the pipeline before the stage at the given index, and takes ownership of
+ *        it.
+ *
+ * \param <index> Index of the stage to add the new stage before.
+ * \param <name> Name of the stage, as displayed with its cost.
+ * \param <stage> Stage to be added.
+ */
+void EventPipeline::insert(int index, const QString &name, EventStage *stage)
+{
+    stages.insert(qBound(0, index, stages.size()), { name, stage, 0, 0, 0, 0 });
+}
+
+/* \returns Number of stages in the pipeline.
+ */
+int EventPipeline::size() const
+{
+    return stages.size();
+}
+
+/* \brief Passes a batch of events through each stage in turn, timing each stage. Once a filter has
+ *        removed every event, the rest of the stages are skipped.
+ *
+ * \param <events> Batch of events, in the order they were received.
+ */
+void EventPipeline::process(QVector<InboundEvent> &events)
+{
+    for (Stage &stage : stages)
+    {
+        if (events.isEmpty())
+        {
+            return;
+        }
+
+        qint64 start = ZClock::now();
+        stage.events += events.size();
+        stage.stage->process(events);
+        qint64 elapsed = ZClock::now() - start;
+
+        stage.batches++;
+        stage.elapsed += elapsed;
+        stage.max_batch = qMax(stage.max_batch, elapsed);
+    }
+}
+
+/* \returns The cost of each stage, in the order the stages are run.
+ */
+QVector<EventPipeline::Row> EventPipeline::rows() const
+{
+    QVector<Row> rows;
+    for (const Stage &stage : stages)
+    {
+        rows.append({ stage.name, stage.events, stage.batches,
+                      stage.events > 0 ? stage.elapsed / 1000.0 / stage.events : 0,
+                      stage.max_batch / 1000.0 });
+    }
+
+    return rows;
+}
@@ -0,0 +1,130 @@
+#ifndef EVENT_PIPELINE_H
+#define EVENT_PIPELINE_H
+
+#include "envelopescanner.h"
+#include "zbusevent.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+/* An event received from zBus, as it moves through an EventPipeline: its JSON text, as received,
+ * and the location of its envelope fields in the text. Stages route and filter events by their
+ * envelope; the full event is only parsed, with `event`, by a stage that needs its data.
+ */
+struct InboundEvent
+{
+    int source;             // index of the zBus server the event was received from
+    QByteArray text;        // JSON text of the event, in UTF-8
+    ZBusEnvelope envelope;  // envelope fields of the event, in the text
+    qint64 timestamp;       // time the event arrived, in ns on ZClock
+
+    QString name() const;
+    QString domain() const;
+    QString requestId() const;
+    QString authAttemptId() const;
+    ZBusEvent event() const;
+};
+
+/* A stage of an EventPipeline. Each stage is handed a whole batch of events, by reference, and may
+ * consume them (a sink), change them (an enricher), or remove some of them from the batch, so that
+ * later stages do not see them (a filter).
+ */
+class EventStage
+{
+public:
+    virtual ~EventStage();
+
+    virtual void process(QVector<InboundEvent> &events) = 0;
+};
+
+/* A stage that consumes, or changes, each event in turn.
+ */
+class EventSink : public EventStage
+{
+public:
+    EventSink(const std::function<void(InboundEvent &event)> &consume);
+
+    void process(QVector<InboundEvent> &events) override;
+
+private:
+    std::function<void(InboundEvent &event)> consume;
+};
+
+/* A stage that removes the events that do not match a predicate from the batch, in place.
+ */
+class EventFilter : public EventStage
+{
+public:
+    EventFilter(const std::function<bool(const InboundEvent &event)> &accept);
+
+    void process(QVector<InboundEvent> &events) override;
+
+private:
+    std::function<bool(const InboundEvent &event)> accept;
+};
+
+/* A sink that appends the JSON text of each event to a file, as received, one event per line, in
+ * the format taken by `--send`, so a recording can be replayed.
+ */
+class RecorderSink : public EventStage
+{
+public:
+    RecorderSink(const QString &fileName);
+
+    bool isOpen() const;
+    QString errorString() const;
+
+    void process(QVector<InboundEvent> &events) override;
+
+private:
+    QFile file;
+};
+
+/* The stages that every batch of inbound events passes through, in order, from the decoded events
+ * to the sinks that store, display, or respond to them. Each stage is timed, so the cost it adds
+ * per event and per batch can be displayed.
+ */
+class EventPipeline
+{
+    Q_DISABLE_COPY(EventPipeline)
+
+public:
+    // Cost of a single stage.
+    struct Row
+    {
+        QString name;
+        qint64 events;          // number of events handed to the stage
+        qint64 batches;         // number of batches handed to the stage
+        double average_us;      // average time spent per event, in us
+        double max_batch_us;    // longest time spent on a single batch, in us
+    };
+
+    EventPipeline();
+    ~EventPipeline();
+
+    void append(const QString &name, EventStage *stage);
+    void insert(int index, const QString &name, EventStage *stage);
+    int size() const;
+
+    void process(QVector<InboundEvent> &events);
+    QVector<Row> rows() const;
+
+private:
+    struct Stage
+    {
+        QString name;
+        EventStage *stage;  // owned by the pipeline
+        qint64 events;      // number of events handed to the stage
+        qint64 batches;     // number of batches handed to the stage
+        qint64 elapsed;     // combined time spent in the stage, in ns
+        qint64 max_batch;   // longest time spent on a single batch, in ns
+    };
+
+    QVector<Stage> stages;
+};
+
+#endif
@@ -0,0 +1,394 @@
+#include "eventrecord.h"
+
+#include "envelopescanner.h"
+
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+/* A block of memory that records are allocated from, followed by the records themselves.
+ */
+struct EventSlab
+{
+    QAtomicInt live;  // records allocated from the slab and not freed yet, plus one for the arena
+    int size;         // size of the memory after the slab, in bytes
+};
+
+// Combined size of every slab that has not been freed, in bytes, and the number of such slabs.
+static QAtomicInteger<qint64> slab_bytes;
+static QAtomicInt slab_count;
+
+// Event names, indexed by name id, and the id of each name. Names are never removed.
+static QMutex name_mutex;
+static QVector<QString> names;
+static QHash<QString, quint32> name_ids;
+
+/* \returns The given size rounded up to a multiple of 8 bytes, so headers stay aligned.
+ */
+static int align(int size)
+{
+    return (size + 7) & ~7;
+}
+
+/* \brief Releases one reference to a slab, freeing it if it was the last one.
+ *
+ * \param <slab> Slab to be released.
+ */
+static void release(EventSlab *slab)
+{
+    if (!slab->live.deref())
+    {
+        slab_bytes.fetchAndAddRelaxed(-qint64(sizeof(EventSlab) + slab->size));
+        slab_count.fetchAndAddRelaxed(-1);
+        free(slab);
+    }
+}
+
+/* \returns The id of the given event name, adding it to the name table if it is new.
+ */
+static quint32 name_id(const QString &name)
+{
+    QMutexLocker locker(&name_mutex);
+    QHash<QString, quint32>::const_iterator id = name_ids.constFind(name);
+    if (id != name_ids.constEnd())
+    {
+        return id.value();
+    }
+
+    names.append(name);
+    return name_ids.insert(name, names.size() - 1).value();
+}
+
+/* \returns The number of UTF-16 characters the given UTF-8 text decodes to, without decoding it.
+ */
+static int utf16_length(const QByteArray &utf8)
+{
+    int length = 0;
+    for (char c : utf8)
+    {
+        // count every byte that starts a character, and one more for characters beyond the BMP
+        uchar byte = uchar(c);
+        length += ((byte & 0xc0) != 0x80) + (byte >= 0xf0);
+    }
+
+    return length;
+}
+
+/* \brief Constructs a null record.
+ */
+EventRecord::EventRecord() : header(nullptr)
+{
+}
+
+/* \brief Constructs a handle to the given record, adopting the reference it was created with.
+ */
+EventRecord::EventRecord(EventRecordHeader *header) : header(header)
+{
+}
+
+/* \brief Constructs another handle to the same record.
+ */
+EventRecord::EventRecord(const EventRecord &other) : header(other.header)
+{
+    if (header != nullptr)
+    {
+        header->ref.ref();
+    }
+}
+
+/* \brief Makes this a handle to the same record as the other handle.
+ */
+EventRecord &EventRecord::operator=(const EventRecord &other)
+{
+    EventRecord copy(other);
+    qSwap(header, copy.header);
+    return *this;
+}
+
+/* \brief Releases the record, freeing it if this was its last handle.
+ */
+EventRecord::~EventRecord()
+{
+    if (header != nullptr && !header->ref.deref())
+    {
+        release(header->slab);
+    }
+}
+
+/* \returns True if the handle does not refer to a record.
+ */
+bool EventRecord::isNull() const
+{
+    return header == nullptr;
+}
+
+/* \returns Direction of the event, relative to zBus.
+ */
+int EventRecord::direction() const
+{
+    return header->direction;
+}
+
+/* \returns zBus server the event was received from or sent to (-1 == all).
+ */
+int EventRecord::source() const
+{
+    return header->source;
+}
+
+/* \returns Name of the event.
+ */
+QString EventRecord::name() const
+{
+    QMutexLocker locker(&name_mutex);
+    return names.at(header->nameId);
+}
+
+/* \returns Hash of the name and data of the event.
+ */
+uint EventRecord::hash() const
+{
+    return header->hash;
+}
+
+/* \returns Time the event crossed the websocket, in ns on ZClock.
+ */
+qint64 EventRecord::timestamp() const
+{
+    return header->timestamp;
+}
+
+/* \returns Size of the JSON text of the event, in bytes.
+ */
+int EventRecord::size() const
+{
+    return header->size;
+}
+
+/* \returns Length of the JSON text of the event, in characters.
+ */
+int EventRecord::length() const
+{
+    return header->length;
+}
+
+/* \returns The JSON text of the event, in UTF-8, without copying it. The text is only valid while
+ *          the record is.
+ */
+QByteArray EventRecord::json() const
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(header + 1), header->size);
+}
+
+/* \returns The prefix of the JSON text that holds the data and name of the event, without copying
+ *          it. Two events are repeats of each other if their keys are equal.
+ */
+QByteArray EventRecord::key() const
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(header + 1), header->keySize);
+}
+
+/* \brief Decodes the JSON text of the event, or just enough of it to fill the given length.
+ *
+ * \param <length> Maximum number of characters to decode (-1 == all).
+ *
+ * \returns The JSON text of the event.
+ */
+QString EventRecord::text(int length) const
+{
+    const char *json = reinterpret_cast<const char *>(header + 1);
+    if (length < 0 || length >= int(header->length))
+    {
+        return QString::fromUtf8(json, header->size);
+    }
+
+    // a character takes at most 4 bytes of UTF-8
+    return QString::fromUtf8(json, qMin(int(header->size), length * 4)).left(length);
+}
+
+/* \returns The data of the event, parsed from its JSON text.
+ */
+QJsonValue EventRecord::data() const
+{
+    return QJsonDocument::fromJson(json()).object().value("data");
+}
+
+/* \brief Finds the prefix of the JSON text of an event that holds its data and name.
+ *
+ * \param <json> JSON text of an event, as produced by ZBusEvent::toJson.
+ *
+ * \returns Size of the prefix, in bytes.
+ */
+int EventRecord::keySize(const QByteArray &json)
+{
+    // the requestId key is last, and a quote inside a string is always escaped, so the last match
+    // is the key itself
+    int index = json.lastIndexOf(",\"requestId\":");
+    return index == -1 ? json.size() : index;
+}
+
+/* \brief Appends the JSON text of a value of an event to another JSON text, with its quotes if it
+ *        is a string, since the envelope locates a string without them.
+ *
+ * \param <json> JSON text to be appended to.
+ * \param <text> JSON text of the event.
+ * \param <field> Location of the value in the text.
+ */
+static void append_value(QByteArray &json, const QByteArray &text,
+                         const ZBusEnvelope::Field &field)
+{
+    if (!field.isPresent())
+    {
+        json.append("\"\"");
+    }
+    else if (field.offset > 0 && text.at(field.offset - 1) == '"')
+    {
+        json.append(text.constData() + field.offset - 1, field.size + 2);
+    }
+    else
+    {
+        json.append(text.constData() + field.offset, field.size);
+    }
+}
+
+/* \brief Lays out the JSON text of a received event as ZBusEvent::toJson does, from its envelope,
+ *        without parsing it: data, event, then requestId (empty if it has none). The data is copied
+ *        as received, so the keys inside it keep their order, but line breaks in it are replaced,
+ *        since a record is displayed on as few rows as it fits in.
+ *
+ * \param <text> JSON text of the event, as received.
+ * \param <envelope> Envelope of the event, in the text.
+ *
+ * \returns JSON text of the event, to be recorded.
+ */
+QByteArray EventRecord::envelopeJson(const QByteArray &text, const ZBusEnvelope &envelope)
+{
+    QByteArray json;
+    json.reserve(text.size() + 32);
+    json.append('{');
+    if (envelope.data.isPresent())
+    {
+        json.append("\"data\":");
+        append_value(json, text, envelope.data);
+        json.append(',');
+    }
+    json.append("\"event\":");
+    append_value(json, text, envelope.event);
+    json.append(",\"requestId\":");
+    append_value(json, text, envelope.requestId);
+    json.append('}');
+
+    if (json.contains('\n') || json.contains('\r'))
+    {
+        json.replace('\n', ' ').replace('\r', ' ');
+    }
+    return json;
+}
+
+/* \brief Constructs an arena that allocates slabs of the given size.
+ *
+ * \param <slabSize> Size of a slab, in bytes.
+ */
+EventArena::EventArena(int slabSize) : slabSize(slabSize), current(nullptr), used(0)
+{
+}
+
+/* \brief Lets go of the current slab, which is freed once every record in it is freed.
+ */
+EventArena::~EventArena()
+{
+    if (current != nullptr)
+    {
+        release(current);
+    }
+}
+
+/* \brief Creates a record of an event.
+ *
+ * \param <direction> Direction of the event, relative to zBus.
+ * \param <source> zBus server the event was received from or sent to (-1 == all).
+ * \param <name> Name of the event.
+ * \param <hash> Hash of the name and data of the event.
+ * \param <timestamp> Time the event crossed the websocket, in ns on ZClock.
+ * \param <json> Compact JSON text of the event, in UTF-8, as produced by ZBusEvent::toJson.
+ *
+ * \returns The record.
+ */
+EventRecord EventArena::create(int direction, int source, const QString &name, uint hash,
+                               qint64 timestamp, const QByteArray &json)
+{
+    EventSlab *slab;
+    char *memory = allocate(sizeof(EventRecordHeader) + json.size(), &slab);
+
+    EventRecordHeader *header = new (memory) EventRecordHeader;
+    header->ref.store(1);
+    header->nameId = name_id(name);
+    header->hash = hash;
+    header->size = json.size();
+    header->length = utf16_length(json);
+    header->keySize = EventRecord::keySize(json);
+    header->timestamp = timestamp;
+    header->slab = slab;
+    header->source = source;
+    header->direction = direction;
+    memcpy(reinterpret_cast<char *>(header + 1), json.constData(), json.size());
+
+    return EventRecord(header);
+}
+
+/* \returns Combined size of every slab, of every arena, that has not been freed, in bytes.
+ */
+qint64 EventArena::bytes()
+{
+    return slab_bytes.load();
+}
+
+/* \returns Number of slabs, of every arena, that have not been freed.
+ */
+int EventArena::slabs()
+{
+    return slab_count.load();
+}
+
+/* \brief Allocates memory for a record from the current slab, starting a new slab if the current
+ *        one is full. A record larger than a slab gets a slab of its own.
+ *
+ * \param <size> Size of the record, in bytes.
+ * \param <slab> Set to the slab the record is allocated from, which takes a reference for it.
+ *
+ * \returns The memory allocated.
+ */
+char *EventArena::allocate(int size, EventSlab **slab)
+{
+    size = align(size);
+    if (current == nullptr || used + size > current->size)
+    {
+        if (current != nullptr)
+        {
+            release(current);
+        }
+
+        int capacity = qMax(slabSize, size);
+        current = static_cast<EventSlab *>(malloc(sizeof(EventSlab) + capacity));
+        new (current) EventSlab;
+        current->live.store(1);
+        current->size = capacity;
+        used = 0;
+
+        slab_bytes.fetchAndAddRelaxed(sizeof(EventSlab) + capacity);
+        slab_count.fetchAndAddRelaxed(1);
+    }
+
+    char *memory = reinterpret_cast<char *>(current + 1) + used;
+    used += size;
+    current->live.ref();
+    *slab = current;
+    return memory;
+}
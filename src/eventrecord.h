@@ -0,0 +1,100 @@
+#ifndef EVENT_RECORD_H
+#define EVENT_RECORD_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QJsonValue>
+#include <QString>
+
+struct EventSlab;
+struct ZBusEnvelope;
+
+/* The fixed-size part of an EventRecord, which the compact JSON text of the event immediately
+ * follows in memory.
+ */
+struct EventRecordHeader
+{
+    QAtomicInt ref;     // number of EventRecord handles to the record
+    quint32 nameId;     // index of the event name in the name table
+    quint32 hash;       // hash of the name and data of the event
+    quint32 size;       // size of the JSON text, in bytes
+    quint32 length;     // length of the JSON text, in characters
+    quint32 keySize;    // size of the prefix of the JSON text holding the data and name, in bytes
+    qint64 timestamp;   // time the event crossed the websocket, in ns on ZClock
+    EventSlab *slab;    // slab the record was allocated from
+    qint16 source;      // zBus server the event was received from or sent to (-1 == all)
+    quint8 direction;   // direction of the event, relative to zBus
+};
+
+/* An immutable, reference-counted record of an event in the event history: a compact header,
+ * followed by the compact JSON text of the event, allocated together from an EventArena. Copying a
+ * record only copies a pointer; the record is freed (along with its slab, once every record in the
+ * slab is freed) when its last handle is destroyed.
+ *
+ * The JSON text is `{"data":<data>,"event":"<name>","requestId":"<requestId>"}`, as produced by
+ * ZBusEvent::toJson, so the prefix up to "requestId" identifies the name and data of the event, and
+ * the data is only parsed again when it is displayed in detail. Received events are laid out the
+ * same way from their envelope, with `envelopeJson`, so they need not be parsed to be recorded.
+ */
+class EventRecord
+{
+public:
+    EventRecord();
+    EventRecord(const EventRecord &other);
+    EventRecord &operator=(const EventRecord &other);
+    ~EventRecord();
+
+    bool isNull() const;
+    int direction() const;
+    int source() const;
+    QString name() const;
+    uint hash() const;
+    qint64 timestamp() const;
+    int size() const;
+    int length() const;
+
+    QByteArray json() const;
+    QByteArray key() const;
+    QString text(int length = -1) const;
+    QJsonValue data() const;
+
+    static int keySize(const QByteArray &json);
+    static QByteArray envelopeJson(const QByteArray &text, const ZBusEnvelope &envelope);
+
+private:
+    friend class EventArena;
+
+    EventRecord(EventRecordHeader *header);
+
+    EventRecordHeader *header;  // nullptr == null record
+};
+
+/* An allocator of EventRecords, which packs them into large slabs, so that recording an event costs
+ * one bump of a pointer instead of an allocation per string and JSON node. A slab is freed once the
+ * arena has moved on from it, and every record in it has been freed.
+ *
+ * Records may be copied and destroyed on any thread, but must be created on one thread at a time.
+ */
+class EventArena
+{
+    Q_DISABLE_COPY(EventArena)
+
+public:
+    EventArena(int slabSize = 64 * 1024);
+    ~EventArena();
+
+    EventRecord create(int direction, int source, const QString &name, uint hash,
+                       qint64 timestamp, const QByteArray &json);
+
+    static qint64 bytes();
+    static int slabs();
+
+private:
+    char *allocate(int size, EventSlab **slab);
+
+    int slabSize;        // size of a slab, in bytes, unless a record needs a larger one
+    EventSlab *current;  // slab records are being allocated from (nullptr == none)
+    int used;            // bytes of the current slab allocated so far
+};
+
+#endif
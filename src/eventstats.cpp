@@ -0,0 +1,109 @@
+#include "eventstats.h"
+
+#include <algorithm>
+
+/* \brief Counts an event in the current second's slot of the counter for its name, and in the
+ *        running totals, and updates the gap and jitter between events with its name.
+ *
+ * \param <name> Name of the event.
+ * \param <size> Size of the event, in bytes.
+ * \param <now> Time of the event, in ns on a monotonic clock (e.g. ZClock).
+ */
+void EventStats::record(const QString &name, int size, qint64 now)
+{
+    Counter &counter = counters[name];
+    qint64 second = now / 1000000000;
+    int slot = second % SLOTS;
+
+    // the slot last counted events for a second that is now out of the window; reuse it
+    if (counter.seconds[slot] != second)
+    {
+        counter.seconds[slot] = second;
+        counter.counts[slot] = 0;
+    }
+
+    counter.counts[slot]++;
+    counter.count++;
+    counter.bytes += size;
+    counter.max_size = qMax(counter.max_size, size);
+
+    if (counter.last != 0)
+    {
+        qint64 gap = now - counter.last;
+        if (counter.last_gap != -1)
+        {
+            counter.jitter += (qAbs(gap - counter.last_gap) - counter.jitter) / 16;
+        }
+        counter.gaps += gap;
+        counter.last_gap = gap;
+    }
+    counter.last = now;
+}
+
+/* \brief Calculates the statistics for each event name, ordered from the busiest event name over
+ *        the last 10 seconds to the quietest.
+ *
+ * \param <now> Current time, in ns on the clock the events were recorded with.
+ *
+ * \returns Statistics for each event name.
+ */
+QVector<EventStats::Row> EventStats::rows(qint64 now) const
+{
+    qint64 second = now / 1000000000;
+
+    qint64 total = 0;
+    for (QHash<QString, Counter>::const_iterator i = counters.constBegin();
+         i != counters.constEnd();
+         i++)
+    {
+        total += sum(*i, second, 60);
+    }
+
+    QVector<Row> rows;
+    for (QHash<QString, Counter>::const_iterator i = counters.constBegin();
+         i != counters.constEnd();
+         i++)
+    {
+        qint64 minute = sum(*i, second, 60);
+        rows.append({ i.key(),
+                      double(sum(*i, second, 1)),
+                      sum(*i, second, 10) / 10.0,
+                      minute / 60.0,
+                      total > 0 ? double(minute) / total : 0,
+                      i->count,
+                      double(i->bytes) / i->count,
+                      i->max_size,
+                      i->count > 1 ? i->gaps / 1e6 / (i->count - 1) : 0,
+                      i->jitter / 1e6 });
+    }
+
+    std::sort(rows.begin(), rows.end(), [] (const Row &a, const Row &b)
+    {
+        return a.rate_10s != b.rate_10s ? a.rate_10s > b.rate_10s : a.name < b.name;
+    });
+
+    return rows;
+}
+
+/* \brief Sums the events counted in the given number of complete seconds before the given second.
+ *
+ * \param <counter> Counter of the event name.
+ * \param <second> Current second. Events in the current second are not counted.
+ * \param <window> Number of complete seconds to sum.
+ *
+ * \returns Number of events counted in the window.
+ */
+qint64 EventStats::sum(const Counter &counter, qint64 second, int window) const
+{
+    qint64 sum = 0;
+    for (int slot = 0; slot < SLOTS; slot++)
+    {
+        qint64 age = second - counter.seconds[slot];
+        if (age >= 1 && age <= window)
+        {
+            sum += counter.counts[slot];
+        }
+    }
+
+    return sum;
+}
@@ -0,0 +1,59 @@
+#ifndef EVENT_STATS_H
+#define EVENT_STATS_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/* Traffic statistics for each event name, kept in fixed-size rolling counters: one slot per second
+ * for the last minute, plus running totals. Recording an event and reading the statistics cost the
+ * same regardless of how many events have been recorded.
+ *
+ * The time between consecutive events with the same name is tracked too, along with its jitter: a
+ * running estimate of how much consecutive gaps differ, computed like the interarrival jitter of
+ * RFC 3550 (J += (|D| - J) / 16, where D is the difference between consecutive gaps).
+ */
+class EventStats
+{
+public:
+    // Statistics for a single event name.
+    struct Row
+    {
+        QString name;
+        double rate_1s;      // events per second over the last complete second
+        double rate_10s;     // events per second over the last 10 complete seconds
+        double rate_60s;     // events per second over the last 60 complete seconds
+        double share;        // fraction of all events over the last 60 complete seconds
+        qint64 count;        // number of events since the statistics were started
+        double average_size; // average size of an event, in bytes
+        int max_size;        // size of the largest event, in bytes
+        double gap_ms;       // average time between consecutive events, in ms (0 == unknown)
+        double jitter_ms;    // jitter of the time between consecutive events, in ms
+    };
+
+    void record(const QString &name, int size, qint64 now);
+    QVector<Row> rows(qint64 now) const;
+
+private:
+    // one slot per second for the last 60 complete seconds, plus the current second
+    static const int SLOTS = 61;
+
+    struct Counter
+    {
+        qint64 counts[SLOTS] = {};  // number of events received in each second
+        qint64 seconds[SLOTS] = {}; // second that each slot is counting events for
+        qint64 count = 0;           // number of events since the statistics were started
+        qint64 bytes = 0;           // combined size of events since the statistics were started
+        int max_size = 0;           // size of the largest event
+        qint64 last = 0;            // time of the most recent event, in ns (0 == none)
+        qint64 last_gap = -1;       // time between the two most recent events, in ns (-1 == none)
+        qint64 gaps = 0;            // combined time between consecutive events, in ns
+        double jitter = 0;          // jitter of the time between consecutive events, in ns
+    };
+
+    qint64 sum(const Counter &counter, qint64 second, int window) const;
+
+    QHash<QString, Counter> counters;
+};
+
+#endif
@@ -0,0 +1,303 @@
+#include "eventtemplate.h"
+
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QDateTime>
+
+QHash<QString, QByteArray> EventTemplate::variables;
+
+/* \brief Escapes text to be placed inside a JSON string, so that a value containing quotes,
+ *        backslashes, or control characters does not end the string, or break the event.
+ *
+ * \param <text> Text to be escaped, in UTF-8.
+ *
+ * \returns Escaped text, without surrounding quotes.
+ */
+static QByteArray json_escape(const QByteArray &text)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    QByteArray escaped;
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+            case '"':
+                escaped.append("\\\"");
+                break;
+            case '\\':
+                escaped.append("\\\\");
+                break;
+            case '\n':
+                escaped.append("\\n");
+                break;
+            case '\r':
+                escaped.append("\\r");
+                break;
+            case '\t':
+                escaped.append("\\t");
+                break;
+            default:
+                if (quint8(c) < 0x20)
+                {
+                    escaped.append("\\u00").append(hex[c >> 4]).append(hex[c & 0x0f]);
+                }
+                else
+                {
+                    escaped.append(c);
+                }
+                break;
+        }
+    }
+
+    return escaped;
+}
+
+/* \brief Seeds the random number generator of a new template, so that no two templates share a
+ *        seed: templates are often built in the same millisecond, and at the same address, as
+ *        temporaries in a loop, and processes sending at once are told apart by their PID.
+ *
+ * \returns Seed, which is never 0 (which xorshift would never leave).
+ */
+static quint64 next_seed()
+{
+    static QAtomicInteger<quint64> count(0);
+
+    // splitmix64 of the time, PID, and count, so that consecutive seeds are unrelated
+    quint64 seed = quint64(QDateTime::currentMSecsSinceEpoch()) ^
+                   (quint64(QCoreApplication::applicationPid()) << 40);
+    seed += (count.fetchAndAddRelaxed(1) + 1) * Q_UINT64_C(0x9e3779b97f4a7c15);
+    seed = (seed ^ (seed >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+    seed = (seed ^ (seed >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+    seed ^= seed >> 31;
+    return seed != 0 ? seed : 1;
+}
+
+/* \brief Compiles the given text into a template. Placeholders that are not recognized are left in
+ *        the text as-is, and variables are substituted immediately, so variables must be set before
+ *        the templates that use them are constructed.
+ *
+ * \param <text> Text of the template.
+ */
+EventTemplate::EventTemplate(const QString &text)
+    : sequence(0), state(next_seed())
+{
+    QByteArray source = text.toUtf8();
+    QByteArray literal;
+    int literal_size = 0;
+    int position = 0;
+
+    while (position < source.size())
+    {
+        int start = source.indexOf("{{", position);
+        int end = (start == -1) ? -1 : source.indexOf("}}", start + 2);
+        if (end == -1)
+        {
+            literal.append(source.mid(position));
+            break;
+        }
+
+        literal.append(source.mid(position, start - position));
+        position = end + 2;
+
+        // split the placeholder into its name and (optional) argument
+        QByteArray placeholder = source.mid(start + 2, end - start - 2).trimmed();
+        int colon = placeholder.indexOf(':');
+        QByteArray name = placeholder.left(colon);
+        QByteArray argument = (colon == -1) ? QByteArray() : placeholder.mid(colon + 1).trimmed();
+
+        Segment segment = { Kind::Literal, QByteArray(), 0, 0 };
+        if (name == "seq" && colon == -1)
+        {
+            segment.kind = Kind::Sequence;
+        }
+        else if (name == "amount")
+        {
+            QList<QByteArray> range = argument.split('-');
+            bool min_ok = true;
+            bool max_ok = true;
+            double min = range.size() == 2 ? range.at(0).toDouble(&min_ok) : 1;
+            double max = range.size() == 2 ? range.at(1).toDouble(&max_ok) : 500;
+            if ((argument.isEmpty() || (range.size() == 2 && min_ok && max_ok)) && min <= max)
+            {
+                segment = { Kind::Amount, QByteArray(), qRound64(min * 100), qRound64(max * 100) };
+            }
+        }
+        else if (name == "digits" && argument.toInt() > 0)
+        {
+            segment = { Kind::Digits, QByteArray(), argument.toInt(), 0 };
+        }
+        else if (name == "uuid" && colon == -1)
+        {
+            segment.kind = Kind::Uuid;
+        }
+        else if (name == "timestamp" && colon == -1)
+        {
+            segment.kind = Kind::Timestamp;
+        }
+        else if (name == "var" && !argument.isEmpty())
+        {
+            literal.append(json_escape(variables.value(QString::fromUtf8(argument),
+                                                       "<" + argument + ">")));
+            continue;
+        }
+
+        if (segment.kind == Kind::Literal)
+        {
+            // not a placeholder
+            literal.append(source.mid(start, end + 2 - start));
+            continue;
+        }
+
+        if (!literal.isEmpty())
+        {
+            literal_size += literal.size();
+            segments.append({ Kind::Literal, literal, 0, 0 });
+            literal.clear();
+        }
+        segments.append(segment);
+    }
+
+    if (!literal.isEmpty())
+    {
+        literal_size += literal.size();
+        segments.append({ Kind::Literal, literal, 0, 0 });
+    }
+
+    // leave room for the placeholders, so that most expansions fit in the buffer from the start
+    buffer.reserve(literal_size + 64 * segments.size());
+    state = state ? state : 1;
+}
+
+/* \brief Sets the value substituted for `{{var:<name>}}` in templates constructed afterwards. The
+ *        value is JSON-escaped when it is substituted, so it is given as plain text.
+ *
+ * \param <name> Name of the variable.
+ * \param <value> Value of the variable.
+ */
+void EventTemplate::setVariable(const QString &name, const QString &value)
+{
+    variables.insert(name, value.toUtf8());
+}
+
+/* \returns True if the template has no placeholders, so every expansion is the same.
+ */
+bool EventTemplate::isStatic() const
+{
+    return segments.isEmpty() || (segments.size() == 1 && segments.at(0).kind == Kind::Literal);
+}
+
+/* \brief Fills in the placeholders of the template, writing the result into the buffer of the
+ *        template.
+ *
+ * \returns Expanded text of the template, in UTF-8. The returned buffer is overwritten by the next
+ *          expansion, so it must be copied to be kept.
+ */
+const QByteArray &EventTemplate::expand()
+{
+    // truncating keeps the capacity of the buffer, since it was reserved
+    buffer.resize(0);
+    sequence++;
+
+    for (const Segment &segment : segments)
+    {
+        switch (segment.kind)
+        {
+            case Kind::Literal:
+                buffer.append(segment.text);
+                break;
+            case Kind::Sequence:
+                appendNumber(sequence);
+                break;
+            case Kind::Amount:
+            {
+                quint64 cents = segment.min + random() % quint64(segment.max - segment.min + 1);
+                appendNumber(cents / 100);
+                buffer.append('.');
+                appendNumber(cents % 100, 2);
+                break;
+            }
+            case Kind::Digits:
+                for (qint64 i = 0; i < segment.min; i++)
+                {
+                    buffer.append(char('0' + random() % 10));
+                }
+                break;
+            case Kind::Uuid:
+                appendUuid();
+                break;
+            case Kind::Timestamp:
+                appendNumber(quint64(QDateTime::currentMSecsSinceEpoch()));
+                break;
+        }
+    }
+
+    return buffer;
+}
+
+/* \brief Appends a number to the buffer in decimal, without allocating a temporary string.
+ *
+ * \param <number> Number to be appended.
+ * \param <min_digits> Minimum number of digits, padded with leading zeros.
+ */
+void EventTemplate::appendNumber(quint64 number, int min_digits)
+{
+    char digits[20];
+    int start = sizeof(digits);
+    do
+    {
+        digits[--start] = char('0' + number % 10);
+        number /= 10;
+    }
+    while (number > 0 || int(sizeof(digits)) - start < qMin(min_digits, int(sizeof(digits))));
+
+    buffer.append(digits + start, sizeof(digits) - start);
+}
+
+/* \brief Appends a random (version 4) UUID to the buffer, formatted like
+ *        "xxxxxxxx-xxxx-4xxx-yxxx-xxxxxxxxxxxx".
+ */
+void EventTemplate::appendUuid()
+{
+    static const char hex[] = "0123456789abcdef";
+
+    quint8 bytes[16];
+    for (int i = 0; i < 16; i += 8)
+    {
+        quint64 bits = random();
+        for (int j = 0; j < 8; j++)
+        {
+            bytes[i + j] = quint8(bits >> (j * 8));
+        }
+    }
+    bytes[6] = (bytes[6] & 0x0f) | 0x40;  // version 4
+    bytes[8] = (bytes[8] & 0x3f) | 0x80;  // variant 1
+
+    char text[36];
+    int position = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (i == 4 || i == 6 || i == 8 || i == 10)
+        {
+            text[position++] = '-';
+        }
+        text[position++] = hex[bytes[i] >> 4];
+        text[position++] = hex[bytes[i] & 0x0f];
+    }
+
+    buffer.append(text, sizeof(text));
+}
+
+/* \brief Generates a pseudorandom number with xorshift64*, which is fast and more than random
+ *        enough for mock data.
+ *
+ * \returns Pseudorandom 64-bit number.
+ */
+quint64 EventTemplate::random()
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * Q_UINT64_C(2685821657736338717);
+}
@@ -0,0 +1,57 @@
+#ifndef EVENT_TEMPLATE_H
+#define EVENT_TEMPLATE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/* A template for the text of an event (or event data), containing placeholders that are filled in
+ * anew each time the template is expanded. The supported placeholders are:
+ *  - `{{seq}}`: number of times the template has been expanded, starting at 1
+ *  - `{{amount}}`, `{{amount:<min>-<max>}}`: random dollar amount (default 1-500), e.g. "319.20"
+ *  - `{{digits:<n>}}`: `n` random decimal digits
+ *  - `{{uuid}}`: random (version 4) UUID, e.g. for a `requestId`
+ *  - `{{timestamp}}`: current time, in ms since the epoch
+ *  - `{{var:<name>}}`: value of the variable `name`, set with `setVariable` (e.g. from the command
+ *                      line), escaped to be placed inside a JSON string. If the variable is not
+ *                      set, it expands to "<name>".
+ *
+ * A template is compiled once, when it is constructed, into a list of segments, and each expansion
+ * writes the segments into a buffer owned by the template, which is reused across expansions. Once
+ * the buffer has grown to fit an expansion, expanding the template does not allocate.
+ */
+class EventTemplate
+{
+public:
+    EventTemplate(const QString &text = QString());
+
+    static void setVariable(const QString &name, const QString &value);
+
+    bool isStatic() const;
+    const QByteArray &expand();
+
+private:
+    enum class Kind { Literal, Sequence, Amount, Digits, Uuid, Timestamp };
+
+    struct Segment
+    {
+        Kind kind;
+        QByteArray text;  // text of a literal segment
+        qint64 min;       // smallest value of an amount, in cents, or number of digits
+        qint64 max;       // largest value of an amount, in cents
+    };
+
+    void appendNumber(quint64 number, int min_digits = 1);
+    void appendUuid();
+    quint64 random();
+
+    static QHash<QString, QByteArray> variables;
+
+    QVector<Segment> segments;  // compiled template, in order
+    QByteArray buffer;          // text of the most recent expansion
+    quint64 sequence;           // number of times the template has been expanded
+    quint64 state;              // state of the random number generator
+};
+
+#endif
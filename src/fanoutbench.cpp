@@ -0,0 +1,391 @@
+#include "fanoutbench.h"
+
+#include "envelopescanner.h"
+#include "zbusevent.h"
+#include "zclock.h"
+#include "zwebsocket.h"
+
+#include <QAtomicInt>
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+
+// Name of the probe events sent by the publisher.
+static const QByteArray PROBE_EVENT = "bench.probe";
+
+// How long every subscriber, and the publisher, have to connect before a step, in ms, by default.
+static const int CONNECT_TIMEOUT_MS = 10000;
+
+// How long subscribers have to receive the last probes of a step, once they are sent, in ms.
+static const int DRAIN_MS = 1000;
+
+// How often the publisher sends the probes that are due, in ms.
+static const int PACE_INTERVAL_MS = 1;
+
+/* A subscriber's websocket, which lives on one of the I/O threads, and the latencies of the probes
+ * it received in the current step.
+ */
+struct Subscriber
+{
+    ZWebSocket *socket = nullptr;
+    bool connected = false;     // whether the websocket is connected, as seen by the main thread
+    QMutex mutex;               // guards `latencies`, which the I/O thread appends to
+    QVector<qint64> latencies;  // latency of each probe received in the current step, in ns
+};
+
+class FanoutBenchPrivate
+{
+public:
+    QUrl zBusUrl;
+    TlsOptions tls;                     // how the server of a wss:// URL is verified
+    QVector<QThread *> threads;         // I/O threads the subscribers are spread over
+    QVector<Subscriber *> subscribers;
+    ZWebSocket publisher;
+    QVector<QPair<int, int>> steps;     // number of subscribers and rate of each step
+    int step = -1;                      // index of the current step
+    QAtomicInt current;                 // step the probes being counted belong to (-1 == none)
+    int duration = 0;                   // time probes are sent for in each step, in ms
+    int connected = 0;                  // number of subscribers connected
+    bool waiting = false;               // whether the step waits for websockets to connect
+    QTimer pacer;                       // sends the probes that are due
+    QTimer connectTimeout;              // gives up on the websockets connecting
+    qint64 started = 0;                 // time the probes of the current step started, in ns
+    qint64 sent = 0;                    // probes sent in the current step
+    QVector<FanoutResult> results;      // results of the steps finished so far
+};
+
+/* \param <latencies> Sorted latencies, in ns.
+ * \param <share> Share of the latencies at or below the percentile, e.g. 0.99.
+ *
+ * \returns Latency at the percentile, or -1 if there are no latencies.
+ */
+static qint64 percentile(const QVector<qint64> &latencies, double share)
+{
+    if (latencies.isEmpty())
+    {
+        return -1;
+    }
+    int index = qMin(int(latencies.size() * share), latencies.size() - 1);
+    return latencies.at(index);
+}
+
+/* \param <ns> Time, in ns.
+ *
+ * \returns Time in ms, e.g. "1.234 ms", or "-" if there is none.
+ */
+static QString milliseconds(qint64 ns)
+{
+    return ns < 0 ? QString("-") : QString::number(ns / 1e6, 'f', 3) + " ms";
+}
+
+/* \brief Constructs a FanoutBench, and starts its I/O threads.
+ *
+ * \param <zBusUrl> URL of zBus, or of a stand-in.
+ * \param <threads> Number of I/O threads the subscribers are spread over.
+ * \param <parent> Parent of this instantiation of FanoutBench.
+ */
+FanoutBench::FanoutBench(const QUrl &zBusUrl, int threads, QObject *parent)
+    : QObject(parent), p(new FanoutBenchPrivate())
+{
+    qRegisterMetaType<FanoutResult>();
+
+    p->zBusUrl = zBusUrl;
+    p->current.store(-1);
+    for (int i = 0; i < qMax(threads, 1); i++)
+    {
+        p->threads.append(new QThread());
+        p->threads.last()->start();
+    }
+
+    p->pacer.setTimerType(Qt::PreciseTimer);
+    p->pacer.setInterval(PACE_INTERVAL_MS);
+    connect(&p->pacer, &QTimer::timeout, this, &FanoutBench::sendProbes);
+
+    p->connectTimeout.setSingleShot(true);
+    p->connectTimeout.setInterval(CONNECT_TIMEOUT_MS);
+    connect(&p->connectTimeout, &QTimer::timeout, this,
+            [this]
+            {
+                qWarning() << "Only" << p->connected << "of" << p->steps.at(p->step).first
+                           << "subscribers connected to" << p->zBusUrl.toString();
+                p->waiting = false;
+                emit finished(false);
+            });
+
+    connect(&p->publisher, &ZWebSocket::connected, this, [this] { beginStep(); });
+}
+
+/* \brief Stops the I/O threads, which closes and deletes the subscribers' websockets.
+ */
+FanoutBench::~FanoutBench()
+{
+    foreach (QThread *thread, p->threads)
+    {
+        thread->quit();
+        thread->wait();
+    }
+    qDeleteAll(p->threads);
+    qDeleteAll(p->subscribers);
+    delete p;
+}
+
+/* \brief Sets the CAs and public key pins that the server of a wss:// URL is verified against.
+ *        Must be called before `start`.
+ *
+ * \param <options> CAs and pins to trust.
+ */
+void FanoutBench::setTlsOptions(const TlsOptions &options)
+{
+    p->tls = options;
+    p->publisher.setTlsOptions(options);
+}
+
+/* \brief Sets how long every subscriber, and the publisher, have to connect before a step, after
+ *        which the benchmark gives up (CONNECT_TIMEOUT_MS by default).
+ *
+ * \param <timeout> Time to connect, in ms.
+ */
+void FanoutBench::setConnectTimeout(int timeout)
+{
+    p->connectTimeout.setInterval(timeout);
+}
+
+/* \brief Connects the publisher, and runs a step for each number of subscribers and each rate.
+ *        `stepFinished` is emitted after each step, and `finished` after the last one.
+ *
+ * \param <clients> Numbers of subscribers.
+ * \param <rates> Numbers of probes sent per second.
+ * \param <duration> Time probes are sent for in each step, in ms.
+ */
+void FanoutBench::start(const QVector<int> &clients, const QVector<int> &rates, int duration)
+{
+    QVector<int> sortedClients = clients;
+    QVector<int> sortedRates = rates;
+    std::sort(sortedClients.begin(), sortedClients.end());
+    std::sort(sortedRates.begin(), sortedRates.end());
+    foreach (int count, sortedClients)
+    {
+        foreach (int rate, sortedRates)
+        {
+            p->steps.append(qMakePair(qMax(count, 1), qMax(rate, 1)));
+        }
+    }
+    p->duration = duration;
+
+    p->publisher.open(p->zBusUrl);
+    nextStep();
+}
+
+/* \returns Results of the steps finished so far.
+ */
+QVector<FanoutResult> FanoutBench::results() const
+{
+    return p->results;
+}
+
+/* \param <result> Result of a step.
+ *
+ * \returns One-line summary of the result, e.g. "clients 10, rate 100/s: sent 500, received 5000
+ *          (loss 0.00%, worst 0.00%), latency p50 0.412 ms, p99 1.301 ms, max 3.020 ms,
+ *          worst p99 1.870 ms".
+ */
+QString FanoutBench::format(const FanoutResult &result)
+{
+    QString text = QString("clients %1, rate %2/s: sent %3, received %4 (loss %5%, worst %6%)")
+                       .arg(result.clients)
+                       .arg(result.rate)
+                       .arg(result.sent)
+                       .arg(result.received)
+                       .arg(result.loss * 100, 0, 'f', 2)
+                       .arg(result.worstLoss * 100, 0, 'f', 2);
+    text += QString(", latency p50 %1, p99 %2, max %3, worst p99 %4")
+                .arg(milliseconds(result.p50), milliseconds(result.p99),
+                     milliseconds(result.max), milliseconds(result.worstP99));
+    if (result.connected < result.clients)
+    {
+        text += QString(", %1 disconnected").arg(result.clients - result.connected);
+    }
+    return text;
+}
+
+/* \brief Starts the next step, once its subscribers are connected, or emits `finished` after the
+ *        last step.
+ */
+void FanoutBench::nextStep()
+{
+    p->step++;
+    if (p->step == p->steps.size())
+    {
+        emit finished(true);
+        return;
+    }
+
+    while (p->subscribers.size() < p->steps.at(p->step).first)
+    {
+        addSubscriber();
+    }
+    p->waiting = true;
+    p->connectTimeout.start();
+    beginStep();
+}
+
+/* \brief Starts sending the probes of the current step, if it is waiting, and every websocket it
+ *        needs is connected.
+ */
+void FanoutBench::beginStep()
+{
+    if (!p->waiting || p->connected < p->steps.at(p->step).first ||
+        p->publisher.state() != QAbstractSocket::ConnectedState)
+    {
+        return;
+    }
+
+    p->waiting = false;
+    p->connectTimeout.stop();
+    foreach (Subscriber *subscriber, p->subscribers)
+    {
+        QMutexLocker locker(&subscriber->mutex);
+        subscriber->latencies.clear();
+    }
+    p->current.store(p->step);
+    p->sent = 0;
+    p->started = ZClock::now();
+    p->pacer.start();
+}
+
+/* \brief Sends the probes that are due, at the rate of the current step, and finishes the step
+ *        once every probe is sent and the subscribers had time to receive them.
+ */
+void FanoutBench::sendProbes()
+{
+    int rate = p->steps.at(p->step).second;
+    qint64 total = qint64(rate) * p->duration / 1000;
+    qint64 due = qMin(qint64((ZClock::now() - p->started) / 1e9 * rate), total);
+
+    // the probe is tagged with its step, and the time it was sent
+    for (; p->sent < due; p->sent++)
+    {
+        QString requestId = QString("%1/%2").arg(p->step).arg(ZClock::now());
+        p->publisher.sendZBusEvent(ZBusEvent(QString(PROBE_EVENT), QJsonValue(), requestId));
+    }
+
+    if (p->sent >= total)
+    {
+        p->pacer.stop();
+        QTimer::singleShot(DRAIN_MS, this, &FanoutBench::finishStep);
+    }
+}
+
+/* \brief Collects the latencies the subscribers of the current step measured, emits the result of
+ *        the step, and moves on to the next one.
+ */
+void FanoutBench::finishStep()
+{
+    p->current.store(-1);
+
+    FanoutResult result;
+    result.clients = p->steps.at(p->step).first;
+    result.rate = p->steps.at(p->step).second;
+    result.connected = qMin(p->connected, result.clients);
+    result.sent = p->sent;
+
+    QVector<qint64> latencies;
+    for (int i = 0; i < result.clients; i++)
+    {
+        Subscriber *subscriber = p->subscribers.at(i);
+        QVector<qint64> received;
+        {
+            QMutexLocker locker(&subscriber->mutex);
+            received.swap(subscriber->latencies);
+        }
+
+        std::sort(received.begin(), received.end());
+        result.received += received.size();
+        result.worstP99 = qMax(result.worstP99, percentile(received, 0.99));
+        if (result.sent > 0)
+        {
+            result.worstLoss = qMax(result.worstLoss,
+                                    1 - double(qMin(qint64(received.size()), result.sent))
+                                            / result.sent);
+        }
+        latencies += received;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    qint64 expected = result.sent * result.clients;
+    result.loss = expected > 0 ? 1 - double(qMin(result.received, expected)) / expected : 0;
+    result.p50 = percentile(latencies, 0.5);
+    result.p99 = percentile(latencies, 0.99);
+    result.max = latencies.isEmpty() ? -1 : latencies.last();
+
+    p->results.append(result);
+    emit stepFinished(result);
+    nextStep();
+}
+
+/* \brief Opens the websocket of another subscriber, on the next I/O thread. Its probes are timed on
+ *        the I/O thread, as they arrive.
+ */
+void FanoutBench::addSubscriber()
+{
+    Subscriber *subscriber = new Subscriber();
+    subscriber->socket = new ZWebSocket();
+    subscriber->socket->setTlsOptions(p->tls);
+    QThread *thread = p->threads.at(p->subscribers.size() % p->threads.size());
+    subscriber->socket->moveToThread(thread);
+    connect(thread, &QThread::finished, subscriber->socket, &QObject::deleteLater);
+    p->subscribers.append(subscriber);
+
+    connect(subscriber->socket, &ZWebSocket::zBusEnvelopeReceived, subscriber->socket,
+            [this, subscriber] (const QByteArray &text, const ZBusEnvelope &envelope,
+                                qint64 timestamp)
+            {
+                const ZBusEnvelope::Field &event = envelope.event;
+                const ZBusEnvelope::Field &requestId = envelope.requestId;
+                if (!requestId.isPresent() ||
+                    QByteArray::fromRawData(text.constData() + event.offset, event.size)
+                        != PROBE_EVENT)
+                {
+                    return;
+                }
+
+                // probes that arrive after their step finished are not counted
+                QByteArray id = QByteArray::fromRawData(text.constData() + requestId.offset,
+                                                        requestId.size);
+                int slash = id.indexOf('/');
+                if (slash < 0 || id.left(slash).toInt() != p->current.load())
+                {
+                    return;
+                }
+
+                qint64 sent = id.mid(slash + 1).toLongLong();
+                QMutexLocker locker(&subscriber->mutex);
+                subscriber->latencies.append(timestamp - sent);
+            });
+
+    connect(subscriber->socket, &ZWebSocket::connected, this,
+            [this, subscriber]
+            {
+                subscriber->connected = true;
+                p->connected++;
+                beginStep();
+            });
+    connect(subscriber->socket, &ZWebSocket::disconnected, this,
+            [this, subscriber]
+            {
+                // `disconnected` is also emitted when an attempt to connect fails
+                if (subscriber->connected)
+                {
+                    subscriber->connected = false;
+                    p->connected--;
+                }
+            });
+
+    QMetaObject::invokeMethod(subscriber->socket, "open", Qt::QueuedConnection,
+                              Q_ARG(QUrl, p->zBusUrl));
+}
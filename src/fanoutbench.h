@@ -0,0 +1,76 @@
+#ifndef FANOUT_BENCH_H
+#define FANOUT_BENCH_H
+
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QVector>
+
+class FanoutBenchPrivate;
+struct TlsOptions;
+
+/* The outcome of one step of a FanoutBench: how the probes sent at one rate were delivered to one
+ * number of subscribers.
+ */
+struct FanoutResult
+{
+    int clients = 0;       // number of subscribers
+    int rate = 0;          // probes sent per second
+    int connected = 0;     // subscribers still connected at the end of the step
+    qint64 sent = 0;       // probes sent
+    qint64 received = 0;   // probes received, summed over the subscribers
+    double loss = 0;       // share of the probes the subscribers did not receive
+    double worstLoss = 0;  // share of the probes missed by the subscriber that missed the most
+    qint64 p50 = -1;       // median delivery latency, over every subscriber, in ns (-1 == none)
+    qint64 p99 = -1;       // 99th percentile delivery latency, in ns (-1 == none)
+    qint64 max = -1;       // highest delivery latency, in ns (-1 == none)
+    qint64 worstP99 = -1;  // 99th percentile latency of the slowest subscriber (-1 == none)
+};
+
+Q_DECLARE_METATYPE(FanoutResult)
+
+/* A benchmark of how zBus broadcasts events to many clients. A pool of I/O threads holds the
+ * websockets of N subscribers, and one publisher sends probe events at a fixed rate; each
+ * subscriber measures the latency from the probe being sent to it being received, and counts the
+ * probes it missed.
+ *
+ * The benchmark runs in steps, one for each number of subscribers and each rate, in increasing
+ * order, so the cost of fan-out shows as both grow. Subscribers are kept open from one step to the
+ * next. A probe is tagged with its step and the time it was sent, in its `requestId`, so it is
+ * matched by its envelope, without being parsed; the publisher and subscribers share ZClock, so the
+ * latency includes the publisher's and subscriber's websockets, and the round trip through zBus.
+ */
+class FanoutBench : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FanoutBench)
+
+public:
+    FanoutBench(const QUrl &zBusUrl, int threads, QObject *parent = nullptr);
+    ~FanoutBench();
+
+    void setTlsOptions(const TlsOptions &options);
+    void setConnectTimeout(int timeout);
+    void start(const QVector<int> &clients, const QVector<int> &rates, int duration);
+    QVector<FanoutResult> results() const;
+
+    static QString format(const FanoutResult &result);
+
+signals:
+    void stepFinished(const FanoutResult &result);
+    void finished(bool completed);
+
+private slots:
+    void nextStep();
+    void sendProbes();
+    void finishStep();
+
+private:
+    void addSubscriber();
+    void beginStep();
+
+    FanoutBenchPrivate *p;
+};
+
+#endif
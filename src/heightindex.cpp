@@ -0,0 +1,308 @@
+#include "heightindex.h"
+
+#include <QtGlobal>
+
+/* \brief Constructs an empty HeightIndex for events wrapped to the given width.
+ *
+ * \param <columns> Width, in characters, that events are wrapped to.
+ */
+HeightIndex::HeightIndex(int columns)
+    : columns(qMax(columns, 1)), maxHeight(0), padding(0), expanded(-1), tree(1, 0), built(0)
+{
+}
+
+/* \brief Adds an event to the end of the index. If the tree is up to date, the event is added to
+ *        the tree immediately, in O(log n). Otherwise, it is added by a subsequent `rebuild`.
+ *
+ * \param <length> Printed length of the event, in characters.
+ */
+void HeightIndex::append(int length)
+{
+    lengths.append(qMax(length, 1));
+
+    if (built == lengths.size() - 1)
+    {
+        appendToTree();
+    }
+}
+
+/* \brief Changes the printed length of an event that has already been added to the index, in
+ *        O(log n).
+ *
+ * \param <index> Index of the event in the event history.
+ * \param <length> New printed length of the event, in characters.
+ */
+void HeightIndex::update(int index, int length)
+{
+    if (!contains(index))
+    {
+        return;
+    }
+
+    int previous_height = height(index);
+    lengths[index] = qMax(length, 1);
+    addToTree(index, height(index) - previous_height);
+}
+
+/* \brief Removes all events from the index.
+ */
+void HeightIndex::clear()
+{
+    lengths.clear();
+    tree.resize(1);
+    built = 0;
+}
+
+/* \brief Changes the width that events are wrapped to. If the width differs from the current
+ *        width, the tree is emptied, and must be refilled with `rebuild`.
+ *
+ * \param <columns> Width, in characters, that events are wrapped to.
+ */
+void HeightIndex::setColumns(int columns)
+{
+    columns = qMax(columns, 1);
+    if (columns == this->columns)
+    {
+        return;
+    }
+
+    this->columns = columns;
+    tree.resize(1);
+    built = 0;
+}
+
+/* \brief Caps the height of every event that is not expanded. If the cap differs from the current
+ *        cap, the tree is emptied, and must be refilled with `rebuild`.
+ *
+ * \param <rows> Maximum height of an event, in rows (0 == no maximum).
+ */
+void HeightIndex::setMaxHeight(int rows)
+{
+    rows = qMax(rows, 0);
+    if (rows == maxHeight)
+    {
+        return;
+    }
+
+    maxHeight = rows;
+    tree.resize(1);
+    built = 0;
+}
+
+/* \brief Adds the given number of characters to the printed length of every event, e.g. for a
+ *        column printed before each event. If the padding differs from the current padding, the
+ *        tree is emptied, and must be refilled with `rebuild`.
+ *
+ * \param <length> Number of characters printed before every event.
+ */
+void HeightIndex::setPadding(int length)
+{
+    length = qMax(length, 0);
+    if (length == padding)
+    {
+        return;
+    }
+
+    padding = length;
+    tree.resize(1);
+    built = 0;
+}
+
+/* \brief Displays the given event at its full height, and caps the height of the event that was
+ *        previously expanded, in O(log n).
+ *
+ * \param <index> Index of the event to be expanded (-1 == none).
+ */
+void HeightIndex::setExpanded(int index)
+{
+    if (index == expanded)
+    {
+        return;
+    }
+
+    int collapsed = expanded;
+    int collapsed_height = contains(collapsed) ? height(collapsed) : 0;
+    int expanded_height = contains(index) ? height(index) : 0;
+    expanded = index;
+
+    if (contains(collapsed))
+    {
+        addToTree(collapsed, height(collapsed) - collapsed_height);
+    }
+    if (contains(index))
+    {
+        addToTree(index, height(index) - expanded_height);
+    }
+}
+
+/* \brief Adds up to `budget` events that are not yet in the tree to the tree.
+ *
+ * \param <budget> Maximum number of events to add to the tree.
+ *
+ * \returns True if every event is in the tree.
+ */
+bool HeightIndex::rebuild(int budget)
+{
+    for (int i = 0; i < budget && built < lengths.size(); i++)
+    {
+        appendToTree();
+    }
+
+    return !isRebuilding();
+}
+
+/* \returns Number of events in the index.
+ */
+int HeightIndex::size() const
+{
+    return lengths.size();
+}
+
+/* \returns True if some events have not been added to the tree yet.
+ */
+bool HeightIndex::isRebuilding() const
+{
+    return built < lengths.size();
+}
+
+/* \brief Determines the number of rows an event occupies in the history window when wrapped to the
+ *        current width, accounting for the maximum height.
+ *
+ * \param <index> Index of the event in the event history.
+ *
+ * \returns Height of the event, in rows.
+ */
+int HeightIndex::height(int index) const
+{
+    int rows = fullHeight(index);
+    return (maxHeight > 0 && index != expanded) ? qMin(rows, maxHeight) : rows;
+}
+
+/* \brief Determines the number of rows an event occupies when wrapped to the current width, without
+ *        eliding it.
+ *
+ * \param <index> Index of the event in the event history.
+ *
+ * \returns Height of the event, in rows.
+ */
+int HeightIndex::fullHeight(int index) const
+{
+    return ((lengths.at(index) + padding - 1) / columns) + 1;
+}
+
+/* \brief Determines the combined height of every event older than the given event, in O(log n)
+ *        when the tree is up to date.
+ *
+ * \param <index> Index of the event in the event history.
+ *
+ * \returns Combined height of the events at indices [0, index), in rows.
+ */
+qint64 HeightIndex::rowsBefore(int index) const
+{
+    index = qBound(0, index, lengths.size());
+
+    qint64 rows = 0;
+    for (int i = qMin(index, built); i > 0; i -= i & -i)
+    {
+        rows += tree.at(i);
+    }
+
+    // sum the heights of any events that have not been added to the tree yet
+    for (int i = built; i < index; i++)
+    {
+        rows += height(i);
+    }
+
+    return rows;
+}
+
+/* \brief Finds the event that occupies the given row, where rows are counted from the oldest event,
+ *        in O(log n) when the tree is up to date.
+ *
+ * \param <row> Row, counted from the first row of the oldest event.
+ *
+ * \returns Index of the event occupying the row, or the number of events if the row is past the
+ *          newest event.
+ */
+int HeightIndex::indexAtRow(qint64 row) const
+{
+    if (row < 0)
+    {
+        return 0;
+    }
+
+    // descend the tree, skipping every subtree that ends at or before the given row
+    int index = 0;
+    int step = 1;
+    while ((step << 1) <= built)
+    {
+        step <<= 1;
+    }
+    for (; step > 0; step >>= 1)
+    {
+        if (index + step <= built && tree.at(index + step) <= row)
+        {
+            index += step;
+            row -= tree.at(index);
+        }
+    }
+
+    // if the row is past the events in the tree, walk the events that have not been added yet
+    if (index < built)
+    {
+        return index;
+    }
+    for (; index < lengths.size(); index++)
+    {
+        row -= height(index);
+        if (row < 0)
+        {
+            return index;
+        }
+    }
+
+    return lengths.size();
+}
+
+/* \returns True if the given index refers to an event in the index.
+ */
+bool HeightIndex::contains(int index) const
+{
+    return index >= 0 && index < lengths.size();
+}
+
+/* \brief Adds the given change in height of an event to every node of the tree that covers it, in
+ *        O(log n). Events that are not in the tree yet are measured when they are added to it.
+ *
+ * \param <index> Index of the event in the event history.
+ * \param <delta> Change in height of the event, in rows.
+ */
+void HeightIndex::addToTree(int index, qint64 delta)
+{
+    if (delta == 0 || index >= built)
+    {
+        return;
+    }
+
+    for (int i = index + 1; i <= built; i += i & -i)
+    {
+        tree[i] += delta;
+    }
+}
+
+/* \brief Adds the next event that is not yet in the tree to the tree, in O(log n). Each node of a
+ *        Fenwick tree covers the range (i - lowbit(i), i], which is the event at i plus the nodes
+ *        i - 1, i - 2, i - 4, ... that are smaller than lowbit(i).
+ */
+void HeightIndex::appendToTree()
+{
+    int i = built + 1;
+    qint64 rows = height(built);
+    for (int step = 1; step < (i & -i); step <<= 1)
+    {
+        rows += tree.at(i - step);
+    }
+
+    tree.append(rows);
+    built++;
+}
@@ -0,0 +1,53 @@
+#ifndef HEIGHT_INDEX_H
+#define HEIGHT_INDEX_H
+
+#include <QVector>
+
+/* A prefix-sum index (Fenwick tree) over the number of rows each event in the event history
+ * occupies when line-wrapped to a given width. The index stores the printed length of each event,
+ * so a change in width only requires the tree to be rebuilt, not the events to be re-measured.
+ *
+ * The height of each event can be capped at a maximum number of rows, so that oversized events are
+ * elided in the history window. A single event, typically the selected one, can be expanded to its
+ * full height.
+ *
+ * The tree is rebuilt incrementally: after the width changes, `rebuild` adds a bounded number of
+ * events to the tree per call. Queries remain correct while the tree is incomplete, falling back to
+ * summing the heights of the events that have not yet been added to the tree.
+ */
+class HeightIndex
+{
+public:
+    HeightIndex(int columns = 1);
+
+    void append(int length);
+    void update(int index, int length);
+    void clear();
+    void setColumns(int columns);
+    void setMaxHeight(int rows);
+    void setPadding(int length);
+    void setExpanded(int index);
+    bool rebuild(int budget);
+
+    int size() const;
+    bool isRebuilding() const;
+    int height(int index) const;
+    int fullHeight(int index) const;
+    qint64 rowsBefore(int index) const;
+    int indexAtRow(qint64 row) const;
+
+private:
+    bool contains(int index) const;
+    void addToTree(int index, qint64 delta);
+    void appendToTree();
+
+    int columns;           // width, in characters, that events are wrapped to
+    int maxHeight;         // maximum height of an event that is not expanded (0 == no maximum)
+    int padding;           // characters printed before every event, e.g. a time column
+    int expanded;          // index of the event that is displayed at full height (-1 == none)
+    QVector<int> lengths;  // printed length of each event, in characters
+    QVector<qint64> tree;  // 1-indexed Fenwick tree over the heights of the first `built` events
+    int built;             // number of events that have been added to the tree
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include "jsontree.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+
+/* \brief Constructs a JsonTree with the given value as its root. If the root is an object or an
+ *        array, it is expanded, so the first level of its contents is displayed.
+ *
+ * \param <value> JSON value to be displayed by the tree.
+ */
+JsonTree::JsonTree(const QJsonValue &value) : cursorLine(0), scrollLine(0)
+{
+    nodes.append({ "data", value, 0, false, -1, 0, QString() });
+    visible.append(0);
+    expand(0);
+}
+
+/* \returns Number of lines displayed by the tree.
+ */
+int JsonTree::lineCount() const
+{
+    return visible.size();
+}
+
+/* \brief Returns the text displayed on the given line, formatting it if it has not been displayed
+ *        before.
+ *
+ * \param <index> Line of the tree.
+ *
+ * \returns Text displayed on the line.
+ */
+QString JsonTree::line(int index)
+{
+    Node &node = nodes[visible.at(index)];
+    if (node.text.isEmpty())
+    {
+        node.text = format(node);
+    }
+
+    return node.text;
+}
+
+/* \returns Line the cursor is on.
+ */
+int JsonTree::cursor() const
+{
+    return cursorLine;
+}
+
+/* \brief Moves the cursor up or down by the given number of lines, stopping at the first and last
+ *        lines.
+ *
+ * \param <lines> Number of lines to move the cursor by. Positive values move the cursor down.
+ */
+void JsonTree::moveCursor(int lines)
+{
+    cursorLine = qBound(0, cursorLine + lines, visible.size() - 1);
+}
+
+/* \brief Scrolls the tree as little as possible to keep the cursor visible in a pane of the given
+ *        height.
+ *
+ * \param <rows> Height of the pane the tree is displayed in, in rows.
+ *
+ * \returns Line to be displayed at the top of the pane.
+ */
+int JsonTree::scrollTo(int rows)
+{
+    if (cursorLine < scrollLine)
+    {
+        scrollLine = cursorLine;
+    }
+    else if (rows > 0 && cursorLine >= scrollLine + rows)
+    {
+        scrollLine = cursorLine - rows + 1;
+    }
+
+    return scrollLine;
+}
+
+/* \brief Displays the children of the node on the given line, creating them if the node has never
+ *        been expanded. Children that were expanded when the node was collapsed are displayed
+ *        expanded again.
+ *
+ * \param <index> Line of the tree.
+ */
+void JsonTree::expand(int index)
+{
+    int node = visible.at(index);
+    if (nodes.at(node).expanded || !(nodes.at(node).value.isObject() ||
+                                     nodes.at(node).value.isArray()))
+    {
+        return;
+    }
+
+    if (nodes.at(node).firstChild == -1)
+    {
+        createChildren(node);
+    }
+    nodes[node].expanded = true;
+    nodes[node].text.clear();
+
+    QVector<int> lines;
+    appendVisible(node, lines);
+    lines.removeFirst();
+    visible.insert(index + 1, lines.size(), 0);
+    for (int i = 0; i < lines.size(); i++)
+    {
+        visible[index + 1 + i] = lines.at(i);
+    }
+}
+
+/* \brief Hides the descendants of the node on the given line. If the cursor was on one of the
+ *        descendants, it is moved to the node.
+ *
+ * \param <index> Line of the tree.
+ */
+void JsonTree::collapse(int index)
+{
+    int node = visible.at(index);
+    if (!nodes.at(node).expanded)
+    {
+        return;
+    }
+
+    nodes[node].expanded = false;
+    nodes[node].text.clear();
+
+    int end = index + 1;
+    while (end < visible.size() && nodes.at(visible.at(end)).depth > nodes.at(node).depth)
+    {
+        end++;
+    }
+    visible.remove(index + 1, end - index - 1);
+
+    if (cursorLine > index)
+    {
+        cursorLine = qMax(cursorLine - (end - index - 1), index);
+    }
+}
+
+/* \brief Expands the node on the given line if it is collapsed, and collapses it if it is expanded.
+ *
+ * \param <index> Line of the tree.
+ */
+void JsonTree::toggle(int index)
+{
+    if (nodes.at(visible.at(index)).expanded)
+    {
+        collapse(index);
+    }
+    else
+    {
+        expand(index);
+    }
+}
+
+/* \brief Creates a node for each key of an object, or each element of an array, contiguously at the
+ *        end of the list of nodes.
+ *
+ * \param <node> Index in nodes of the object or array.
+ */
+void JsonTree::createChildren(int node)
+{
+    QJsonValue value = nodes.at(node).value;
+    int depth = nodes.at(node).depth + 1;
+    nodes[node].firstChild = nodes.size();
+
+    if (value.isObject())
+    {
+        QJsonObject object = value.toObject();
+        for (QJsonObject::const_iterator i = object.constBegin(); i != object.constEnd(); i++)
+        {
+            nodes.append({ i.key(), i.value(), depth, false, -1, 0, QString() });
+        }
+    }
+    else
+    {
+        QJsonArray array = value.toArray();
+        for (int i = 0; i < array.size(); i++)
+        {
+            nodes.append({ QString("[%1]").arg(i), array.at(i), depth, false, -1, 0, QString() });
+        }
+    }
+
+    nodes[node].childCount = nodes.size() - nodes.at(node).firstChild;
+}
+
+/* \brief Appends the given node, and every descendant of it that is displayed, in the order they
+ *        are displayed.
+ *
+ * \param <node> Index in nodes of the node.
+ * \param <lines> List the nodes are appended to.
+ */
+void JsonTree::appendVisible(int node, QVector<int> &lines) const
+{
+    lines.append(node);
+    if (!nodes.at(node).expanded)
+    {
+        return;
+    }
+
+    for (int i = 0; i < nodes.at(node).childCount; i++)
+    {
+        appendVisible(nodes.at(node).firstChild + i, lines);
+    }
+}
+
+/* \brief Formats the line of text displayed for a node: its key, indented by its depth, followed
+ *        by its value. Objects and arrays are summarized by their size, and marked with "+" when
+ *        collapsed, or "-" when expanded.
+ *
+ * \param <node> The node to be formatted.
+ *
+ * \returns The line of text displayed for the node.
+ */
+QString JsonTree::format(const Node &node) const
+{
+    QString indent(node.depth * 2, ' ');
+    QString marker = node.expanded ? "- " : "+ ";
+
+    switch (node.value.type())
+    {
+        case QJsonValue::Object:
+            return indent + marker + node.key + ": {} "
+                + QString::number(node.value.toObject().size()) + " keys";
+        case QJsonValue::Array:
+            return indent + marker + node.key + ": [] "
+                + QString::number(node.value.toArray().size()) + " items";
+        case QJsonValue::String:
+            return indent + "  " + node.key + ": \"" + node.value.toString() + "\"";
+        case QJsonValue::Double:
+            return indent + "  " + node.key + ": "
+                + QString::number(node.value.toDouble(), 'g', 15);
+        case QJsonValue::Bool:
+            return indent + "  " + node.key + ": " + (node.value.toBool() ? "true" : "false");
+        case QJsonValue::Null:
+            return indent + "  " + node.key + ": null";
+        default:
+            return indent + "  " + node.key + ": (none)";
+    }
+}
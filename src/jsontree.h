@@ -0,0 +1,51 @@
+#ifndef JSON_TREE_H
+#define JSON_TREE_H
+
+#include <QJsonValue>
+#include <QString>
+#include <QVector>
+
+/* A collapsible tree of the keys and values in a JSON value, as displayed in the detail pane, one
+ * node per line. The tree is built and formatted lazily: the children of a node are only created
+ * when the node is first expanded, and the line of text for a node is only formatted when it is
+ * first displayed. Both are kept afterwards, so collapsing and re-expanding a node is cheap.
+ */
+class JsonTree
+{
+public:
+    JsonTree(const QJsonValue &value = QJsonValue());
+
+    int lineCount() const;
+    QString line(int index);
+
+    int cursor() const;
+    void moveCursor(int lines);
+    int scrollTo(int rows);
+
+    void expand(int index);
+    void collapse(int index);
+    void toggle(int index);
+
+private:
+    struct Node
+    {
+        QString key;          // key (or array index) of the value in its parent
+        QJsonValue value;     // value displayed by the node
+        int depth;            // number of ancestors of the node
+        bool expanded;        // whether the children of the node are displayed
+        int firstChild;       // index in nodes of the first child (-1 == children not created)
+        int childCount;       // number of children of the node
+        QString text;         // line of text displayed for the node (empty == not formatted yet)
+    };
+
+    void createChildren(int node);
+    void appendVisible(int node, QVector<int> &lines) const;
+    QString format(const Node &node) const;
+
+    QVector<Node> nodes;    // every node created so far, children stored contiguously
+    QVector<int> visible;   // index in nodes of the node displayed on each line
+    int cursorLine;         // line the cursor is on
+    int scrollLine;         // line displayed at the top of the detail pane
+};
+
+#endif
@@ -1,26 +1,76 @@
+#include "broadcastserver.h"
+#include "envelopescanner.h"
+#include "eventawaiter.h"
+#include "eventpipeline.h"
+#include "eventtemplate.h"
+#include "fanoutbench.h"
+#include "outbox.h"
+#include "sendsession.h"
+#include "shmring.h"
 #include "zbuscli.h"
 #include "zbusevent.h"
+#include "zclock.h"
+#include "zdaemon.h"
 #include "zwebsocket.h"
 
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QList>
 #include <QObject>
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
 #include <QUrl>
+#include <QVector>
+#include <errno.h>
+#include <fcntl.h>
+#include <functional>
 #include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+// Exit code when the event awaited with --await is not received before the --timeout.
+static const int EXIT_TIMEOUT = 2;
+
+// Exit code when the --send events could not all be written to zBus before the websocket closed.
+static const int EXIT_UNDELIVERED = 3;
+
+// Default for --timeout, in ms.
+static const int DEFAULT_TIMEOUT_MS = 10000;
+
+// How long --send keeps flushing events after SIGINT or SIGTERM before giving up, in ms.
+static const int DRAIN_TIMEOUT_MS = 2000;
+
+// Default for --bench-duration, in seconds.
+static const int DEFAULT_BENCH_DURATION_S = 5;
+
+// Size of the frame area of the --shm ring, in bytes.
+static const quint64 SHM_RING_CAPACITY = 4 << 20;
+
+// Pipe that handleSignal writes the signals it catches to, so they are handled on the event loop.
+static int signalPipe[2] = { -1, -1 };
 
 void handleSignal(int signum);
+void watchSignals(const std::function<void (int)> &handler);
+QVector<int> parseCounts(const QString &list);
 
 /* \brief If one or more "send" parameters are provided, the application sends them to the provided
- *        "websocket" URL and exits. If zero "send" parameters are provided, the application
- *        launches an interactive text-based UI that displays events received from zBus and sends
- *        submitted events to zBus.
+ *        "websocket" URL, waits until they are written and the websocket is closed, and exits
+ *        (with EXIT_UNDELIVERED if that fails). If zero "send" parameters are provided, the
+ *        application launches an interactive text-based UI that displays events received from zBus
+ *        and sends submitted events to zBus. The other modes and options are described by the
+ *        command line parser.
  *
  * \param <argc> Number of arguments provided to the command line (including the program name!).>
  * \param <argv> Array of arguments provided to the command line.
  */
 int main(int argc, char **argv)
 {
+  qint64 started = ZClock::now();
   QCoreApplication app(argc, argv);
   QCoreApplication::setApplicationName("zbus-cli-ent");
   QCoreApplication::setApplicationVersion("1.0");
@@ -30,64 +80,491 @@ int main(int argc, char **argv)
   parser.addHelpOption();
   parser.addVersionOption();
   parser.addOption({{"w", "websocket"},
-                    QCoreApplication::translate("main", "connect to zBus at websocket <url>"),
+                    QCoreApplication::translate("main", "connect to zBus at websocket <url> (may "
+                                                        "be given more than once)"),
                     QCoreApplication::translate("main", "url")});
+  parser.addOption({"ca-file",
+                    QCoreApplication::translate("main", "trust the CA certificates in PEM "
+                                                        "<file>, rather than the system's, for "
+                                                        "wss:// URLs"),
+                    QCoreApplication::translate("main", "file")});
+  parser.addOption({"pin",
+                    QCoreApplication::translate("main", "only trust a wss:// server whose public "
+                                                        "key hashes to <pin>, as sha256//<base64> "
+                                                        "(may be given more than once)"),
+                    QCoreApplication::translate("main", "pin")});
   parser.addOption({{"s", "send"},
                     QCoreApplication::translate("main", "send json-formatted zBus <event>"),
                     QCoreApplication::translate("main", "event")});
+  parser.addOption({"await",
+                    QCoreApplication::translate("main", "after sending, wait for an event whose "
+                                                        "name matches wildcard <pattern>"),
+                    QCoreApplication::translate("main", "pattern")});
+  parser.addOption({"timeout",
+                    QCoreApplication::translate("main", "give up waiting for --await after <ms> ms "
+                                                        "(default 10000)"),
+                    QCoreApplication::translate("main", "ms")});
+  parser.addOption({"timings",
+                    QCoreApplication::translate("main", "after sending, print the time spent "
+                                                        "starting up, connecting, handshaking, "
+                                                        "sending, and flushing to stderr")});
+  parser.addOption({"daemon",
+                    QCoreApplication::translate("main", "hold a connection to zBus open, and send "
+                                                        "events from --send invocations over it")});
+  parser.addOption({"bench-fanout",
+                    QCoreApplication::translate("main", "benchmark broadcasting to each of the "
+                                                        "comma-separated numbers of <clients>"),
+                    QCoreApplication::translate("main", "clients")});
+  parser.addOption({"bench-rate",
+                    QCoreApplication::translate("main", "send --bench-fanout probes at each of the "
+                                                        "comma-separated <rates> per second "
+                                                        "(default 100)"),
+                    QCoreApplication::translate("main", "rates")});
+  parser.addOption({"bench-duration",
+                    QCoreApplication::translate("main", "send --bench-fanout probes for <seconds> "
+                                                        "at each step (default 5)"),
+                    QCoreApplication::translate("main", "seconds")});
+  parser.addOption({"bench-threads",
+                    QCoreApplication::translate("main", "spread the --bench-fanout clients over "
+                                                        "<count> threads (default: one per core)"),
+                    QCoreApplication::translate("main", "count")});
+  parser.addOption({"serve",
+                    QCoreApplication::translate("main", "run a stand-in for zBus on <port>, which "
+                                                        "broadcasts every event to every client"),
+                    QCoreApplication::translate("main", "port")});
+  parser.addOption({"serve-address",
+                    QCoreApplication::translate("main", "bind --serve to <address> rather than "
+                                                        "localhost, e.g. 0.0.0.0 for every "
+                                                        "interface"),
+                    QCoreApplication::translate("main", "address"),
+                    "127.0.0.1"});
+  parser.addOption({"shm",
+                    QCoreApplication::translate("main", "publish received events to shared-memory "
+                                                        "ring <name> (/dev/shm/<name>)"),
+                    QCoreApplication::translate("main", "name")});
+  parser.addOption({"outbox",
+                    QCoreApplication::translate("main", "write events sent by --send or --daemon "
+                                                        "ahead to <file>, and first resend those "
+                                                        "it holds that were never delivered; "
+                                                        "without --send or --daemon, only resend "
+                                                        "them, then exit"),
+                    QCoreApplication::translate("main", "file")});
+  parser.addOption({"standby",
+                    QCoreApplication::translate("main", "keep a standby connection to each zBus "
+                                                        "server, which takes over at once when "
+                                                        "the connection is lost")});
+  parser.addOption({"record",
+                    QCoreApplication::translate("main", "append events received by the interactive "
+                                                        "UI to <file>, one per line"),
+                    QCoreApplication::translate("main", "file")});
+  parser.addOption({"frame-log",
+                    QCoreApplication::translate("main", "log each frame drawn by the interactive "
+                                                        "UI, and how long it took, to <file>"),
+                    QCoreApplication::translate("main", "file")});
+  parser.addOption({"repeat",
+                    QCoreApplication::translate("main", "send the --send events <count> times"),
+                    QCoreApplication::translate("main", "count")});
+  parser.addOption({"var",
+                    QCoreApplication::translate("main", "set template variable <name> to <value>"),
+                    QCoreApplication::translate("main", "name=value")});
+  parser.addOption({"max-event-rows",
+                    QCoreApplication::translate("main", "elide events taller than <rows> rows in "
+                                                        "the event history (0 == never)"),
+                    QCoreApplication::translate("main", "rows")});
+  parser.addOption({"rate-limit",
+                    QCoreApplication::translate("main", "display at most <rate> events per second "
+                                                        "with the same name"),
+                    QCoreApplication::translate("main", "rate")});
+  parser.addOption({"rate-limit-domains",
+                    QCoreApplication::translate("main", "apply --rate-limit per domain, rather "
+                                                        "than per event name")});
 
   parser.process(app);
 
+  if (parser.isSet("serve"))
+  {
+      // quit application upon receiving signal to quit (e.g. Ctrl+C)
+      watchSignals([&app] (int) { app.quit(); });
+
+      QHostAddress address;
+      if (!address.setAddress(parser.value("serve-address")))
+      {
+          qWarning() << "The provided --serve-address is not an IP address.";
+          return 1;
+      }
+
+      BroadcastServer server;
+      if (!server.listen(parser.value("serve").toUShort(), address))
+      {
+          qWarning() << "Unable to listen on" << parser.value("serve-address") << "port"
+                     << parser.value("serve") << ":" << server.errorString();
+          return 1;
+      }
+
+      qInfo() << "serving on" << server.url().toString();
+      return app.exec();
+  }
+
   if (!parser.isSet("websocket"))
   {
       qWarning() << "URL to zBus websocket is required. See --help for more info.";
       return 1;
   }
 
-  QUrl zBusUrl = QUrl(parser.value("websocket"));
-  if (!zBusUrl.isValid())
+  QList<QUrl> zBusUrls;
+  foreach (const QString &url, parser.values("websocket"))
   {
-      qWarning() << "The provided zBus websocket URL is invalid.";
+      zBusUrls.append(QUrl(url));
+      if (!zBusUrls.last().isValid())
+      {
+          qWarning() << "The provided zBus websocket URL is invalid:" << url;
+          return 1;
+      }
+  }
+
+  // sending events, and the daemon, only use the first zBus server
+  QUrl zBusUrl = zBusUrls.first();
+
+  TlsOptions tls;
+  tls.caFile = parser.value("ca-file");
+  tls.pins = parser.values("pin");
+  QString tlsError = ZWebSocket::checkTlsOptions(tls);
+  if (!tlsError.isEmpty())
+  {
+      qWarning() << "The provided TLS options are invalid:" << tlsError;
       return 1;
   }
 
-  if (parser.isSet("send"))
+  if (parser.isSet("bench-fanout"))
   {
-      // quit application upon receiving signal to quit (e.g. Ctrl+C)
-      signal(SIGINT, handleSignal);
-      signal(SIGTERM, handleSignal);
+      QVector<int> clients = parseCounts(parser.value("bench-fanout"));
+      QVector<int> rates = parseCounts(parser.isSet("bench-rate") ? parser.value("bench-rate")
+                                                                   : QString("100"));
+      if (clients.isEmpty() || rates.isEmpty())
+      {
+          qWarning() << "--bench-fanout and --bench-rate take comma-separated positive numbers.";
+          return 1;
+      }
+      int duration = parser.isSet("bench-duration") ? parser.value("bench-duration").toInt()
+                                                    : DEFAULT_BENCH_DURATION_S;
+      int threads = parser.isSet("bench-threads") ? parser.value("bench-threads").toInt()
+                                                  : QThread::idealThreadCount();
 
-      ZWebSocket zBusClient;
+      // print the result of each step as it finishes, and quit application after the last one
+      FanoutBench bench(zBusUrl, threads);
+      bench.setTlsOptions(tls);
+      QObject::connect(&bench, &FanoutBench::stepFinished,
+                       [] (const FanoutResult &result)
+                       {
+                           QTextStream(stdout) << FanoutBench::format(result) << "\n";
+                       });
+      QObject::connect(&bench, &FanoutBench::finished,
+                       [&app] (bool completed) { app.exit(completed ? 0 : 1); });
+      watchSignals([&app] (int signum) { app.exit(128 + signum); });
 
-      // quit application after processing provided events
-      QObject::connect(&zBusClient, &ZWebSocket::processedEventQueue,
-                       &app, &QCoreApplication::quit);
+      bench.start(clients, rates, qMax(duration, 1) * 1000);
+      return app.exec();
+  }
+
+  // set template variables before any template (e.g. of mock data) is compiled
+  foreach (const QString &variable, parser.values("var"))
+  {
+      int equals = variable.indexOf('=');
+      if (equals < 1)
+      {
+          qWarning() << "Template variables must be given as <name>=<value>.";
+          return 1;
+      }
+      EventTemplate::setVariable(variable.left(equals), variable.mid(equals + 1));
+  }
 
-      // send zBus events to client, then connect to zBus server to ensure the processedEventQueue
-      // signal is only emitted after all events are processed
-      zBusClient.sendZBusEvents(parser.values("send"));
-      zBusClient.open(zBusUrl);
+  // the ring outlives the daemon and the UI, which publish to it
+  ShmRing ring;
+  if (parser.isSet("shm") && !ring.open(parser.value("shm"), SHM_RING_CAPACITY))
+  {
+      qWarning() << "Unable to publish to shared memory:" << ring.errorString();
+      return 1;
+  }
+
+  // events sent by --send and the daemon are written ahead to the outbox, to survive a crash; the
+  // interactive UI does not write its events ahead
+  Outbox outbox;
+  if (parser.isSet("outbox") && !outbox.open(parser.value("outbox")))
+  {
+      qWarning() << "Unable to open the outbox:" << outbox.errorString();
+      return 1;
+  }
+
+  // with nothing to send, the outbox is only drained, so say so rather than exit silently
+  if (outbox.isOpen() && !parser.isSet("send") && !parser.isSet("daemon"))
+  {
+      qInfo() << "resending" << outbox.pendingCount() << "undelivered events from the outbox";
+  }
+
+  if (parser.isSet("daemon"))
+  {
+      // quit application upon receiving signal to quit, so the outbox is flushed to disk
+      watchSignals([&app] (int) { app.quit(); });
+
+      ZDaemon daemon;
+      daemon.setShmRing(ring.isOpen() ? &ring : nullptr);
+      daemon.setOutbox(outbox.isOpen() ? &outbox : nullptr);
+      daemon.setTlsOptions(tls);
+      if (!daemon.listen(zBusUrl))
+      {
+          return 1;
+      }
 
       return app.exec();
   }
 
+  if (parser.isSet("send") || parser.isSet("await") || parser.isSet("outbox"))
+  {
+      int repeat = parser.isSet("repeat") ? parser.value("repeat").toInt() : 1;
+
+      // send through the daemon for this zBus, if one is running, to skip the websocket handshake;
+      // awaiting an event, or writing events ahead to an outbox, requires a connection of our own.
+      // Events that were written to the daemon are never sent again, even if it did not
+      // acknowledge them, since it may already have sent them
+      if (!parser.isSet("await") && !outbox.isOpen())
+      {
+          DaemonDelivery delivery = ZDaemon::send(zBusUrl, parser.values("send"), repeat);
+          if (delivery != DaemonDelivery::NoDaemon)
+          {
+              return delivery == DaemonDelivery::Acknowledged ? 0 : 1;
+          }
+      }
+
+      ZWebSocket zBusClient;
+      zBusClient.setOutbox(outbox.isOpen() ? &outbox : nullptr);
+      zBusClient.setTlsOptions(tls);
+      EventAwaiter awaiter(parser.value("await"), ZClock::now());
+      bool awaited = false;
+      SendSession *session = nullptr;
+      bool stopping = false;
+
+      if (parser.isSet("await"))
+      {
+          if (!awaiter.isValid())
+          {
+              qWarning() << "The provided --await pattern is invalid.";
+              return 1;
+          }
+
+          // measure latency from the last event sent, and only accept events with its requestId;
+          // latency is measured between the timestamps of the events, taken at the socket
+          QObject::connect(&zBusClient, &ZWebSocket::zBusEventSent,
+                           [&] (const QByteArray &text, const ZBusEnvelope &envelope,
+                                qint64 timestamp)
+                           {
+                               awaiter.recordSent(EnvelopeScanner::string(text, envelope.event),
+                                                  EnvelopeScanner::string(text,
+                                                                          envelope.requestId),
+                                                  timestamp);
+                           });
+
+          // print the awaited event and its latency, then quit application; events are matched by
+          // their envelope, so only the awaited event is ever fully parsed
+          QObject::connect(&zBusClient, &ZWebSocket::zBusEnvelopeReceived,
+                           [&] (const QByteArray &text, const ZBusEnvelope &envelope,
+                                qint64 timestamp)
+                           {
+                               if (awaited ||
+                                   !awaiter.matches(EnvelopeScanner::string(text, envelope.event),
+                                                    EnvelopeScanner::string(text,
+                                                                            envelope.requestId)))
+                               {
+                                   return;
+                               }
+
+                               ZBusEvent event(QJsonDocument::fromJson(text).object());
+                               double latency = awaiter.latency(timestamp) / 1e6;
+                               QTextStream(stdout)
+                                   << event.toJson() << "\n"
+                                   << "latency: " << QString::number(latency, 'f', 3) << " ms\n";
+                               awaited = true;
+                               app.exit(0);
+                           });
+
+          // quit application upon receiving signal to quit (e.g. Ctrl+C)
+          watchSignals([&app] (int signum) { app.exit(128 + signum); });
+
+          // quit application if the awaited event does not arrive in time
+          int timeout = parser.isSet("timeout") ? parser.value("timeout").toInt()
+                                                : DEFAULT_TIMEOUT_MS;
+          QTimer::singleShot(timeout, [&, timeout]
+                             {
+                                 if (!awaited)
+                                 {
+                                     qWarning() << "Timed out after" << timeout << "ms awaiting"
+                                                << parser.value("await");
+                                     app.exit(EXIT_TIMEOUT);
+                                 }
+                             });
+      }
+      else
+      {
+          // quit application once every event has been written to zBus, and the websocket closed
+          // cleanly, which also means every event in the outbox was delivered
+          session = new SendSession(&zBusClient, &zBusClient);
+          QObject::connect(session, &SendSession::finished,
+                           [&] (bool delivered)
+                           {
+                               if (!delivered)
+                               {
+                                   qWarning() << "Not every event was delivered to zBus:"
+                                              << zBusClient.errorString();
+                               }
+                               app.exit(delivered ? 0 : EXIT_UNDELIVERED);
+                           });
+
+          // upon receiving signal to quit (e.g. Ctrl+C), finish flushing the events that were sent,
+          // within a deadline; upon receiving a second one, quit application at once
+          watchSignals([&app, &stopping, session] (int signum)
+                       {
+                           if (stopping)
+                           {
+                               app.exit(128 + signum);
+                               return;
+                           }
+                           stopping = true;
+                           session->stop(DRAIN_TIMEOUT_MS);
+                       });
+      }
+
+      // queue zBus events in the client, then connect to zBus server, which pipelines them all as
+      // soon as it is connected, so the processedEventQueue signal is only emitted after all
+      // events are processed
+      zBusClient.sendZBusEvents(parser.values("send"), repeat);
+      if (session != nullptr)
+      {
+          session->start(zBusUrl, started);
+      }
+      else
+      {
+          zBusClient.open(zBusUrl);
+      }
+
+      int exitCode = app.exec();
+      if (session != nullptr && parser.isSet("timings"))
+      {
+          QTextStream(stderr) << "timings: " << session->timings() << "\n";
+      }
+      return exitCode;
+  }
+
   ZBusCli zBusCli;
 
   // quit application when zBusCli emits quit signal
   QObject::connect(&zBusCli, &ZBusCli::quit, &app, &QCoreApplication::quit);
 
-  zBusCli.exec(zBusUrl);
+  if (parser.isSet("max-event-rows"))
+  {
+      zBusCli.set_max_event_rows(parser.value("max-event-rows").toInt());
+  }
+
+  if (parser.isSet("rate-limit"))
+  {
+      zBusCli.set_rate_limit(parser.value("rate-limit").toDouble(),
+                             parser.isSet("rate-limit-domains"));
+  }
+
+  if (ring.isOpen())
+  {
+      zBusCli.set_shm_ring(&ring);
+  }
+
+  zBusCli.set_tls_options(tls);
+  zBusCli.set_standby(parser.isSet("standby"));
+
+  if (parser.isSet("record"))
+  {
+      RecorderSink *recorder = new RecorderSink(parser.value("record"));
+      if (!recorder->isOpen())
+      {
+          qWarning() << "Unable to record events:" << recorder->errorString();
+          delete recorder;
+          return 1;
+      }
+      zBusCli.add_stage("recorder", recorder);
+  }
+
+  if (parser.isSet("frame-log") && !zBusCli.set_frame_log(parser.value("frame-log")))
+  {
+      qWarning() << "Unable to log frames:" << zBusCli.frame_log_error();
+      return 1;
+  }
+
+  zBusCli.exec(zBusUrls);
   return app.exec();
 }
 
-/* \brief Exits the application upon receiving an interrupt or terminate signal.
+/* \brief Passes an interrupt or terminate signal on to the event loop, through the signal pipe.
+ *        Only async-signal-safe functions may be called here, so the signal is handled later, by
+ *        the handler given to watchSignals.
  *
  * \param <signum> Integer that maps to a unix signal.
  */
 void handleSignal(int signum)
 {
-  if ((signum == SIGINT) || (signum == SIGTERM))
+  // if the pipe is full, a signal is pending anyway
+  char byte = char(signum);
+  ssize_t written = write(signalPipe[1], &byte, 1);
+  (void) written;
+}
+
+/* \brief Catches interrupt and terminate signals, and calls the given handler for each one on the
+ *        event loop, rather than in signal context (the self-pipe trick).
+ *
+ * \param <handler> Function called with the number of each signal caught.
+ */
+void watchSignals(const std::function<void (int)> &handler)
+{
+  if (pipe2(signalPipe, O_CLOEXEC | O_NONBLOCK) == -1)
+  {
+      qWarning() << "Unable to watch for signals:" << strerror(errno);
+      return;
+  }
+
+  QSocketNotifier *notifier = new QSocketNotifier(signalPipe[0], QSocketNotifier::Read,
+                                                  QCoreApplication::instance());
+  QObject::connect(notifier, &QSocketNotifier::activated,
+                   [handler]
+                   {
+                       char signum;
+                       while (read(signalPipe[0], &signum, 1) == 1)
+                       {
+                           handler(signum);
+                       }
+                   });
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handleSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+}
+
+/* \brief Parses a comma-separated list of positive numbers, e.g. "1,10,100".
+ *
+ * \param <list> Comma-separated numbers.
+ *
+ * \returns The numbers, or none if any of them is not a positive number.
+ */
+QVector<int> parseCounts(const QString &list)
+{
+  QVector<int> counts;
+  foreach (const QString &item, list.split(','))
   {
-      exit(signum);
+      bool ok = false;
+      int count = item.trimmed().toInt(&ok);
+      if (!ok || count < 1)
+      {
+          return QVector<int>();
+      }
+      counts.append(count);
   }
+  return counts;
 }
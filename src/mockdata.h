@@ -4,19 +4,20 @@
 #include <QJsonObject>
 #include <QString>
 
-// Mock event data used to generate mocked events.
+// Mock event data used to generate mocked events. String values may contain EventTemplate
+// placeholders, which are filled in anew for each mocked event.
 
 static const QJsonObject MOCK_CARD_INFO
 {
     {
         "cardInfo",
         QJsonObject{
-            { "accountNumber", "374245XXXXX1337" },
+            { "accountNumber", "374245XXXXX{{digits:4}}" },
             { "aid", "A000000025010801" },
-            { "amount", "319.2" },
+            { "amount", "{{amount}}" },
             { "appName", "AMERICAN EXPRESS" },
             { "approvalMethod", "AUTOMATIC" },
-            { "approvalNumber", "123456" },
+            { "approvalNumber", "{{digits:6}}" },
             { "arqc", "" },
             { "cardProvider", "AMEX" },
             { "entryMethod", "CHIP" },
@@ -79,6 +80,6 @@ static const QJsonObject MOCK_PRINTER_DISCONNECTED_STATE
     { "isReadingCheck", false }
 };
 
-static const QString MOCK_PCI{ "900100<STORE_NUMBER><KPCOUNTER_ID>" };
+static const QString MOCK_PCI{ "900100{{var:STORE_NUMBER}}{{var:KPCOUNTER_ID}}" };
 
 #endif
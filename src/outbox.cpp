@@ -0,0 +1,402 @@
+#include "outbox.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+// Size the log may grow to, in bytes, before it is compacted while events are still pending.
+static const qint64 COMPACT_SIZE = 1 << 20;
+
+/* \brief Writes all of the given bytes to a file, retrying writes that are interrupted or short.
+ *
+ * \param <fd> Descriptor of the file.
+ * \param <data> Bytes to be written.
+ * \param <size> Number of bytes to be written.
+ *
+ * \returns True if every byte was written.
+ */
+static bool write_all(int fd, const char *data, qint64 size)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::write(fd, data, size);
+        if (written == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return false;
+        }
+
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+/* \brief Constructs an Outbox that is not open.
+ *
+ * \param <commitInterval> Longest time a written record waits to be flushed to disk, in ms.
+ * \param <parent> Parent of this instantiation of Outbox.
+ */
+Outbox::Outbox(int commitInterval, QObject *parent)
+    : QObject(parent), fd(-1), sequence(0), delivered(0), size(0), pendingSize(0), dirty(false)
+{
+    commitTimer.setSingleShot(true);
+    commitTimer.setInterval(commitInterval);
+    connect(&commitTimer, &QTimer::timeout, this, &Outbox::sync);
+}
+
+/* \brief Flushes the log to disk, and closes it.
+ */
+Outbox::~Outbox()
+{
+    close();
+}
+
+/* \brief Opens (or creates) the log at the given path, and loads the events that were not
+ *        delivered before it was last closed.
+ *
+ * \param <path> Path of the log file.
+ *
+ * \returns True if the log is open.
+ */
+bool Outbox::open(const QString &path)
+{
+    close();
+
+    this->path = path;
+    fd = ::open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC,
+                0600);
+    if (fd == -1)
+    {
+        error = QString("could not open outbox %1: %2").arg(path, strerror(errno));
+        return false;
+    }
+
+    if (!load())
+    {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    error.clear();
+    return true;
+}
+
+/* \brief Flushes the log to disk, and closes it. Pending events stay in the log for the next time
+ *        it is opened.
+ */
+void Outbox::close()
+{
+    if (fd == -1)
+    {
+        return;
+    }
+
+    sync();
+    ::close(fd);
+    fd = -1;
+    records.clear();
+    sequence = 0;
+    delivered = 0;
+    size = 0;
+    pendingSize = 0;
+}
+
+/* \returns True if the log is open.
+ */
+bool Outbox::isOpen() const
+{
+    return fd != -1;
+}
+
+/* \returns Reason the log could not be opened, or last failed to be written.
+ */
+QString Outbox::errorString() const
+{
+    return error;
+}
+
+/* \returns Events that were appended, and not delivered yet, in order.
+ */
+QVector<OutboxEntry> Outbox::pending() const
+{
+    QVector<OutboxEntry> entries;
+    for (const Record &record : records)
+    {
+        // the JSON text is between the space after the sequence number and the newline
+        int json = record.line.indexOf(' ') + 1;
+        entries.append({ record.sequence, record.line.mid(json, record.line.size() - json - 1) });
+    }
+
+    return entries;
+}
+
+/* \returns Number of events that were appended, and not delivered yet.
+ */
+int Outbox::pendingCount() const
+{
+    return records.size();
+}
+
+/* \brief Appends an event to the log. The record survives the process dying as soon as this
+ *        returns, and a reboot once the next group commit has flushed it to disk.
+ *
+ * \param <event> Event that is being sent, or queued to be sent, to zBus.
+ *
+ * \returns Sequence number of the event, to be passed to `markDelivered` (0 == not logged).
+ */
+quint64 Outbox::append(const ZBusEvent &event)
+{
+    return append(event.toUtf8Json());
+}
+
+/* \brief Appends the JSON text of an event to the log, as-is, but for line breaks, which are
+ *        whitespace in JSON, and would split the record.
+ *
+ * \param <json> JSON text of the event, in UTF-8.
+ *
+ * \returns Sequence number of the event, to be passed to `markDelivered` (0 == not logged).
+ */
+quint64 Outbox::append(const QByteArray &json)
+{
+    if (fd == -1)
+    {
+        return 0;
+    }
+
+    QByteArray line = "+" + QByteArray::number(sequence + 1) + " " + json;
+    line.replace('\n', ' ').replace('\r', ' ').append('\n');
+    if (!write(line))
+    {
+        return 0;
+    }
+
+    records.enqueue({ ++sequence, line });
+    pendingSize += line.size();
+    return sequence;
+}
+
+/* \brief Records that every event up to the given one was written to zBus, so they are not sent
+ *        again, and compacts the log if it allows. Emits `emptied` if nothing is left pending.
+ *
+ * \param <sequence> Sequence number of the last event written to zBus.
+ */
+void Outbox::markDelivered(quint64 sequence)
+{
+    if (fd == -1 || sequence <= delivered)
+    {
+        return;
+    }
+
+    release(sequence);
+    if (records.isEmpty())
+    {
+        compact();
+        emit emptied();
+        return;
+    }
+
+    write("-" + QByteArray::number(sequence) + "\n");
+    if (size > COMPACT_SIZE && pendingSize * 2 < size)
+    {
+        compact();
+    }
+}
+
+/* \brief Flushes the records written since the last flush to disk, together.
+ */
+void Outbox::sync()
+{
+    commitTimer.stop();
+    if (fd != -1 && dirty)
+    {
+        fdatasync(fd);
+        dirty = false;
+    }
+}
+
+/* \brief Reads the log, keeping the records of events that were not delivered, and discards
+ *        everything after the last intact record.
+ *
+ * \returns True if the log could be read.
+ */
+bool Outbox::load()
+{
+    QByteArray log;
+    char buffer[65536];
+    ssize_t bytes;
+    while ((bytes = ::read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (bytes == -1 && errno != EINTR)
+        {
+            error = QString("could not read outbox %1: %2").arg(path, strerror(errno));
+            return false;
+        }
+        if (bytes > 0)
+        {
+            log.append(buffer, bytes);
+        }
+    }
+
+    int start = 0;
+    for (int end = log.indexOf('\n'); end != -1; end = log.indexOf('\n', start))
+    {
+        QByteArray line = log.mid(start, end - start + 1);
+        bool valid = false;
+        if (line.startsWith('+'))
+        {
+            int space = line.indexOf(' ');
+            quint64 number = line.mid(1, space - 1).toULongLong(&valid);
+            valid = valid && space > 1 && number > sequence;
+            if (valid)
+            {
+                records.enqueue({ number, line });
+                pendingSize += line.size();
+                sequence = number;
+            }
+        }
+        else if (line.startsWith('-'))
+        {
+            quint64 number = line.mid(1, line.size() - 2).toULongLong(&valid);
+            valid = valid && number <= sequence;
+            if (valid)
+            {
+                release(number);
+            }
+        }
+
+        // a record that does not parse was torn by a crash, and so is everything after it
+        if (!valid)
+        {
+            break;
+        }
+        start = end + 1;
+    }
+
+    size = log.size();
+    if (start < size)
+    {
+        qWarning() << "Discarding" << size - start << "bytes of torn records from outbox" << path;
+        if (ftruncate(fd, start) == -1)
+        {
+            error = QString("could not repair outbox %1: %2").arg(path, strerror(errno));
+            return false;
+        }
+        size = start;
+    }
+
+    if (records.isEmpty() && size > 0)
+    {
+        compact();
+    }
+    return true;
+}
+
+/* \brief Writes a record to the end of the log, and schedules a group commit.
+ *
+ * \param <line> Record, including its newline.
+ *
+ * \returns True if the record was written.
+ */
+bool Outbox::write(const QByteArray &line)
+{
+    if (!write_all(fd, line.constData(), line.size()))
+    {
+        error = QString("could not write outbox %1: %2").arg(path, strerror(errno));
+        qWarning() << error;
+
+        // do not leave a torn record in the middle of the log
+        if (ftruncate(fd, size) == -1)
+        {
+            qWarning() << "could not repair outbox" << path << ":" << strerror(errno);
+        }
+        return false;
+    }
+
+    size += line.size();
+    dirty = true;
+    if (!commitTimer.isActive())
+    {
+        commitTimer.start();
+    }
+    return true;
+}
+
+/* \brief Forgets the records of every event up to the given one, which were delivered.
+ *
+ * \param <sequence> Sequence number of the last event delivered.
+ */
+void Outbox::release(quint64 sequence)
+{
+    while (!records.isEmpty() && records.head().sequence <= sequence)
+    {
+        pendingSize -= records.dequeue().line.size();
+    }
+    delivered = sequence;
+}
+
+/* \brief Removes delivered records from the log: by truncating it if nothing is pending, or by
+ *        writing the pending records to a new log, and renaming it over the old one. If the new
+ *        log cannot be written, the old one is kept.
+ */
+void Outbox::compact()
+{
+    if (records.isEmpty())
+    {
+        if (ftruncate(fd, 0) == 0)
+        {
+            size = 0;
+            dirty = true;
+            if (!commitTimer.isActive())
+            {
+                commitTimer.start();
+            }
+        }
+        return;
+    }
+
+    QByteArray temporary = QFile::encodeName(path + ".tmp");
+    int compacted = ::open(temporary.constData(),
+                           O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (compacted == -1)
+    {
+        return;
+    }
+
+    bool written = true;
+    for (const Record &record : records)
+    {
+        written = written && write_all(compacted, record.line.constData(), record.line.size());
+    }
+    if (!written || fdatasync(compacted) == -1 ||
+        rename(temporary.constData(), QFile::encodeName(path).constData()) == -1)
+    {
+        ::close(compacted);
+        unlink(temporary.constData());
+        return;
+    }
+
+    // make the rename itself durable
+    int directory = ::open(QFile::encodeName(QFileInfo(path).absolutePath()).constData(),
+                           O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory != -1)
+    {
+        fsync(directory);
+        ::close(directory);
+    }
+
+    ::close(fd);
+    fd = compacted;
+    size = pendingSize;
+    dirty = false;
+}
@@ -0,0 +1,86 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include "zbusevent.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+/* The JSON text of an outbound event, and its sequence number in the Outbox (0 == not logged).
+ */
+struct OutboxEntry
+{
+    quint64 sequence;
+    QByteArray json;
+};
+
+/* A write-ahead log of the events sent to zBus, so that events queued while zBus is unreachable
+ * survive a crash, a Ctrl+C, or a reboot, and are sent, in order, on the next start.
+ *
+ * The log is an append-only text file with one record per line: `+<sequence> <json>` for an event
+ * that was sent or queued, and `-<sequence>` once every event up to that sequence number has been
+ * written to the socket. Each record is written with a single write(2), so it survives the process
+ * dying as soon as it is appended; records are flushed to disk together (group commit) at most
+ * `commitInterval` ms later, so a burst of events costs one fdatasync rather than one per event. A
+ * torn record at the end of the log, left by a crash mid-write, is discarded when the log is
+ * opened.
+ *
+ * Delivered records are compacted away: the log is truncated whenever nothing is pending, and
+ * rewritten with just the pending records if it grows large while events are still pending.
+ */
+class Outbox : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(Outbox)
+
+public:
+    Outbox(int commitInterval = 5, QObject *parent = nullptr);
+    ~Outbox();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    QVector<OutboxEntry> pending() const;
+    int pendingCount() const;
+    quint64 append(const ZBusEvent &event);
+    quint64 append(const QByteArray &json);
+    void markDelivered(quint64 sequence);
+
+public slots:
+    void sync();
+
+signals:
+    void emptied();
+
+private:
+    // A pending record, exactly as it is in the log.
+    struct Record
+    {
+        quint64 sequence;
+        QByteArray line;
+    };
+
+    bool load();
+    bool write(const QByteArray &line);
+    void release(quint64 sequence);
+    void compact();
+
+    QString path;
+    int fd;                  // descriptor of the log (-1 == closed)
+    QString error;           // reason the log could not be opened or written
+    QQueue<Record> records;  // records of the events not delivered yet, in order
+    quint64 sequence;        // sequence number of the last event appended
+    quint64 delivered;       // sequence number of the last event delivered
+    qint64 size;             // size of the log, in bytes
+    qint64 pendingSize;      // size of the pending records, in bytes
+    bool dirty;              // whether records were written since the last fdatasync
+    QTimer commitTimer;      // flushes written records to disk, commitInterval ms after the first
+};
+
+#endif
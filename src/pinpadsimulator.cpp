@@ -0,0 +1,84 @@
+#include "pinpadsimulator.h"
+
+#include "scheduler.h"
+
+// How long POS needs after pinpad.preparePaymentRequest before it is able to receive the card, in
+// ms.
+static const int CARD_DELAY_MS = 5000;
+
+// How long the pinpad takes to respond to any other request, in ms.
+static const int RESPONSE_DELAY_MS = 100;
+
+// Responses of the pinpad to each request, in the order they are sent.
+static const QMap<QString, QVector<Mock>> PINPAD_RESPONSES
+{
+    { "pos.connected", { Mock::PinpadDisplayItemSuccess } },
+    { "pinpad.preparePaymentRequest", { Mock::PinpadCardInserted, Mock::PinpadCardInfo } },
+    { "pinpad.authorizePaymentRequest", { Mock::PinpadPaymentAccepted, Mock::PinpadCardRemoved } },
+    { "pinpad.finishPaymentRequest", { Mock::PinpadFinishPaymentRequest } }
+};
+
+/* \brief Constructs a PinpadSimulator, which runs on the system scheduler.
+ *
+ * \param <parent> Parent of this instantiation of PinpadSimulator.
+ */
+PinpadSimulator::PinpadSimulator(QObject *parent)
+    : QObject(parent), scheduler(Scheduler::system())
+{
+}
+
+/* \brief Sets the scheduler that the responses are delayed on, e.g. a VirtualClock in tests.
+ *
+ * \param <scheduler> Scheduler, which must outlive the PinpadSimulator.
+ */
+void PinpadSimulator::setScheduler(Scheduler *scheduler)
+{
+    this->scheduler = scheduler;
+}
+
+/* \brief Schedules the responses of the pinpad to an event received from zBus, if it is a request
+ *        to the pinpad.
+ *
+ * \param <event> Event received from zBus.
+ * \param <source> zBus server the event was received from, which the responses go to.
+ */
+void PinpadSimulator::handle(const ZBusEvent &event, int source)
+{
+    handle(event.name(), source);
+}
+
+/* \brief Schedules the responses of the pinpad to an event received from zBus, by its name, so that
+ *        the event need not be decoded.
+ *
+ * \param <name> Name of the event received from zBus, e.g. "pinpad.preparePaymentRequest".
+ * \param <source> zBus server the event was received from, which the responses go to.
+ */
+void PinpadSimulator::handle(const QString &name, int source)
+{
+    foreach (Mock response, responses(name))
+    {
+        scheduler->schedule(delay(response), this,
+                            [this, source, response] { emit responded(source, response); });
+    }
+}
+
+/* \param <name> Name of an event received from zBus, e.g. "pinpad.preparePaymentRequest".
+ *
+ * \returns Responses of the pinpad to the event, in the order they are sent (none if it is not a
+ *          request to the pinpad).
+ */
+QVector<Mock> PinpadSimulator::responses(const QString &name)
+{
+    return PINPAD_RESPONSES.value(name);
+}
+
+/* \param <response> Response of the pinpad.
+ *
+ * \returns Time after the request that the response is sent, in ms.
+ */
+int PinpadSimulator::delay(Mock response)
+{
+    return response == Mock::PinpadCardInserted || response == Mock::PinpadCardInfo
+               ? CARD_DELAY_MS
+               : RESPONSE_DELAY_MS;
+}
@@ -0,0 +1,39 @@
+#ifndef PINPAD_SIMULATOR_H
+#define PINPAD_SIMULATOR_H
+
+#include "zbusevent.h"
+
+#include <QMap>
+#include <QObject>
+#include <QVector>
+
+class Scheduler;
+
+/* Simulates the affirmative responses of a pinpad to the requests POS sends it over zBus, e.g.
+ * inserting a card in response to `pinpad.preparePaymentRequest`, so that a payment flow can run
+ * without a physical pinpad. Each response is emitted once its delay has passed, on the Scheduler,
+ * for the owner to fill in (e.g. with the latest `requestId`) and send.
+ */
+class PinpadSimulator : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PinpadSimulator)
+
+public:
+    PinpadSimulator(QObject *parent = nullptr);
+
+    void setScheduler(Scheduler *scheduler);
+    void handle(const ZBusEvent &event, int source);
+    void handle(const QString &name, int source);
+
+    static QVector<Mock> responses(const QString &name);
+    static int delay(Mock response);
+
+signals:
+    void responded(int source, Mock response);
+
+private:
+    Scheduler *scheduler;  // schedules the responses
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "ratelimiter.h"
+
+#include <QLocale>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+
+/* \brief Constructs a RateLimiter that allows `rate` events per second for each key, with bursts
+ *        of up to `burst` events.
+ *
+ * \param <rate> Number of events allowed through per second, per key (0 == no limit).
+ * \param <burst> Number of events allowed through at once, per key. If less than one, one second's
+ *                worth of events is allowed through at once.
+ */
+RateLimiter::RateLimiter(double rate, double burst) : total(0)
+{
+    setRate(rate, burst);
+}
+
+/* \brief Changes the limit applied to each key. Buckets seen so far are refilled to the new burst
+ *        size as events arrive.
+ *
+ * \param <rate> Number of events allowed through per second, per key (0 == no limit).
+ * \param <burst> Number of events allowed through at once, per key. If less than one, one second's
+ *                worth of events is allowed through at once.
+ */
+void RateLimiter::setRate(double rate, double burst)
+{
+    this->rate = qMax(rate, 0.0);
+    this->burst = burst >= 1 ? burst : qMax(this->rate, 1.0);
+}
+
+/* \returns True if events are being limited.
+ */
+bool RateLimiter::isEnabled() const
+{
+    return rate > 0;
+}
+
+/* \brief Refills the bucket for the given key for the time elapsed since it was last refilled,
+ *        then attempts to take a token from it.
+ *
+ * \param <key> Key (e.g. event name or domain) of the event.
+ * \param <now> Current time, in ms.
+ *
+ * \returns True if the event is allowed through. False if the event has been suppressed.
+ */
+bool RateLimiter::allow(const QString &key, qint64 now)
+{
+    if (!isEnabled())
+    {
+        return true;
+    }
+
+    QHash<QString, Bucket>::iterator bucket = buckets.find(key);
+    if (bucket == buckets.end())
+    {
+        bucket = buckets.insert(key, { burst, now, 0 });
+    }
+
+    bucket->tokens = qMin(burst, bucket->tokens + (now - bucket->updated) * rate / 1000);
+    bucket->updated = now;
+
+    if (bucket->tokens >= 1)
+    {
+        bucket->tokens -= 1;
+        return true;
+    }
+
+    bucket->suppressed++;
+    total++;
+    return false;
+}
+
+/* \returns Number of events that have been suppressed, across all keys.
+ */
+qint64 RateLimiter::suppressed() const
+{
+    return total;
+}
+
+/* \brief Summarizes the number of events suppressed for each key, in descending order, in the form
+ *        "scanner.read: 4,812 suppressed, printer.stateUpdate: 12 suppressed".
+ *
+ * \returns Summary of suppressed events, or an empty string if no events have been suppressed.
+ */
+QString RateLimiter::summary() const
+{
+    QVector<QPair<qint64, QString>> counts;
+    for (QHash<QString, Bucket>::const_iterator i = buckets.constBegin();
+         i != buckets.constEnd();
+         i++)
+    {
+        if (i->suppressed > 0)
+        {
+            counts.append({ i->suppressed, i.key() });
+        }
+    }
+    std::sort(counts.begin(), counts.end(), std::greater<QPair<qint64, QString>>());
+
+    QLocale locale(QLocale::English);
+    QStringList entries;
+    for (const QPair<qint64, QString> &count : counts)
+    {
+        entries.append(count.second + ": " + locale.toString(count.first) + " suppressed");
+    }
+
+    return entries.join(", ");
+}
@@ -0,0 +1,38 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <QHash>
+#include <QString>
+
+/* A set of token buckets, one per key (e.g. event name or domain), that limit how many events with
+ * each key are allowed through per second. Each bucket holds up to `burst` tokens, and is refilled
+ * at `rate` tokens per second; an event is allowed through if a token can be taken from the bucket
+ * for its key. Events that are not allowed through are counted per key, so they can be summarized.
+ */
+class RateLimiter
+{
+public:
+    RateLimiter(double rate = 0, double burst = 0);
+
+    void setRate(double rate, double burst);
+    bool isEnabled() const;
+    bool allow(const QString &key, qint64 now);
+
+    qint64 suppressed() const;
+    QString summary() const;
+
+private:
+    struct Bucket
+    {
+        double tokens;      // number of events that may be allowed through before refilling
+        qint64 updated;     // time the bucket was last refilled, in ms
+        qint64 suppressed;  // number of events with the key that were not allowed through
+    };
+
+    double rate;                    // tokens added to each bucket per second (0 == no limit)
+    double burst;                   // maximum number of tokens in each bucket
+    QHash<QString, Bucket> buckets; // bucket for each key seen so far
+    qint64 total;                   // number of events not allowed through, across all keys
+};
+
+#endif
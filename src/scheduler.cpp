@@ -0,0 +1,33 @@
+#include "scheduler.h"
+
+#include "zclock.h"
+
+#include <QTimer>
+
+/* The scheduler of real time: ZClock, and single-shot QTimers.
+ */
+class SystemScheduler : public Scheduler
+{
+public:
+    qint64 now() const override
+    {
+        return ZClock::now();
+    }
+
+    void schedule(int delay, QObject *context, const std::function<void ()> &task) override
+    {
+        QTimer::singleShot(delay, context, task);
+    }
+};
+
+Scheduler::~Scheduler()
+{
+}
+
+/* \returns The scheduler of real time, which is shared by every thread.
+ */
+Scheduler *Scheduler::system()
+{
+    static SystemScheduler scheduler;
+    return &scheduler;
+}
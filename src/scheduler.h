@@ -0,0 +1,33 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <QtGlobal>
+
+#include <functional>
+
+class QObject;
+
+/* The source of time for timed behavior, e.g. delayed responses and retries: tells the time, and
+ * runs tasks after a delay. Code that takes a Scheduler, rather than reading ZClock and starting
+ * QTimers itself, can be tested against a VirtualClock, whose time only moves when the test
+ * advances it.
+ *
+ *  - now: the current time, in ns, on ZClock (or on the virtual clock)
+ *  - schedule: runs a task on the thread of the context, once `delay` ms have passed, unless the
+ *    context is destroyed first
+ *
+ * The system scheduler, which is the default everywhere, tells the time with ZClock, and runs tasks
+ * with single-shot QTimers.
+ */
+class Scheduler
+{
+public:
+    virtual ~Scheduler();
+
+    virtual qint64 now() const = 0;
+    virtual void schedule(int delay, QObject *context, const std::function<void ()> &task) = 0;
+
+    static Scheduler *system();
+};
+
+#endif
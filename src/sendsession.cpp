@@ -0,0 +1,186 @@
+#include "sendsession.h"
+
+#include "zclock.h"
+#include "zwebsocket.h"
+
+#include <QStringList>
+#include <QTimer>
+
+// Names of the phases, as reported by `timings`.
+static const char *const PHASE_NAMES[SendSession::PhaseCount] = {
+    "startup", "connect", "handshake", "send", "flush"
+};
+
+/* \brief Constructs a SendSession for the given websocket, which should have the events to be sent
+ *        queued up, and not be open yet.
+ *
+ * \param <socket> Websocket the events are sent over.
+ * \param <parent> Parent of this instantiation of SendSession.
+ */
+SendSession::SendSession(ZWebSocket *socket, QObject *parent)
+    : QObject(parent), socket(socket), sent(false), closing(false), done(false)
+{
+    for (qint64 &time : times)
+    {
+        time = 0;
+    }
+
+    connect(socket, &ZWebSocket::bytesWritten, this,
+            [this]
+            {
+                // the first bytes written are the handshake request, once the TCP connection is up
+                if (times[Handshake] == 0)
+                {
+                    times[Handshake] = ZClock::now();
+                }
+                flush();
+            });
+    connect(socket, &ZWebSocket::stateChanged, this,
+            [this] (QAbstractSocket::SocketState state)
+            {
+                // the state changes before `connected` is emitted, and so before the queued events
+                // are sent
+                if (state == QAbstractSocket::ConnectedState && times[Send] == 0)
+                {
+                    times[Send] = ZClock::now();
+                    if (times[Handshake] == 0)
+                    {
+                        // the handshake request was not seen, so it counts towards connecting
+                        times[Handshake] = times[Send];
+                    }
+                }
+            });
+    connect(socket, &ZWebSocket::processedEventQueue, this,
+            [this]
+            {
+                times[Flush] = ZClock::now();
+                sent = true;
+                flush();
+            });
+    connect(socket,
+            static_cast<void (QWebSocket::*)(QAbstractSocket::SocketError)>(&QWebSocket::error),
+            this,
+            [this]
+            {
+                // e.g. the connection was refused, so there is nothing to wait for
+                if (times[Send] == 0)
+                {
+                    finish(false);
+                }
+            });
+    connect(socket, &ZWebSocket::disconnected, this,
+            [this]
+            {
+                times[PhaseCount] = ZClock::now();
+                finish(closing);
+            });
+}
+
+/* \brief Opens the websocket. The queued events are sent as soon as it is connected.
+ *
+ * \param <zBusUrl> URL of the zBus websocket.
+ * \param <started> Time the process started, in ns on ZClock.
+ */
+void SendSession::start(const QUrl &zBusUrl, qint64 started)
+{
+    times[Startup] = started;
+    times[Connect] = ZClock::now();
+    socket->open(zBusUrl);
+}
+
+/* \brief Stops the session early (e.g. on Ctrl+C). Events already handed to the socket are still
+ *        flushed, and the websocket closed cleanly, unless that takes longer than the deadline.
+ *        Events that were not sent yet, because the websocket is not connected, are given up on.
+ *
+ * \param <timeout> Deadline for flushing the events, and closing the websocket, in ms.
+ */
+void SendSession::stop(int timeout)
+{
+    if (done)
+    {
+        return;
+    }
+
+    if (!sent)
+    {
+        finish(false);
+        socket->abort();
+        return;
+    }
+
+    flush();
+    QTimer::singleShot(timeout, this,
+                       [this]
+                       {
+                           if (!done)
+                           {
+                               finish(false);
+                               socket->abort();
+                           }
+                       });
+}
+
+/* \param <phase> Phase of the session.
+ *
+ * \returns Time spent in the phase, in ns, or -1 if the phase did not complete.
+ */
+qint64 SendSession::duration(Phase phase) const
+{
+    if (times[phase] == 0 || times[phase + 1] == 0)
+    {
+        return -1;
+    }
+
+    return times[phase + 1] - times[phase];
+}
+
+/* \returns Time spent in each phase, and in total, e.g. "startup 4.210 ms, connect 0.391 ms, ...".
+ */
+QString SendSession::timings() const
+{
+    QStringList phases;
+    for (int phase = 0; phase < PhaseCount; phase++)
+    {
+        qint64 ns = duration(Phase(phase));
+        QString time = ns < 0 ? "-" : QString::number(ns / 1e6, 'f', 3) + " ms";
+        phases.append(QString("%1 %2").arg(PHASE_NAMES[phase], time));
+    }
+
+    qint64 last = times[Startup];
+    for (qint64 time : times)
+    {
+        last = qMax(last, time);
+    }
+    phases.append("total " + QString::number((last - times[Startup]) / 1e6, 'f', 3) + " ms");
+
+    return phases.join(", ");
+}
+
+/* \brief Closes the websocket once every event was sent, and the socket has written every byte of
+ *        them. Called whenever the socket writes bytes.
+ */
+void SendSession::flush()
+{
+    if (!sent || closing || done || socket->bytesToWrite() > 0)
+    {
+        return;
+    }
+
+    closing = true;
+    socket->close();
+}
+
+/* \brief Emits `finished`, once.
+ *
+ * \param <delivered> Whether every event was written, and the websocket closed cleanly.
+ */
+void SendSession::finish(bool delivered)
+{
+    if (done)
+    {
+        return;
+    }
+
+    done = true;
+    emit finished(delivered);
+}
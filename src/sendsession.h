@@ -0,0 +1,60 @@
+#ifndef SEND_SESSION_H
+#define SEND_SESSION_H
+
+#include <QObject>
+#include <QString>
+#include <QUrl>
+
+class ZWebSocket;
+
+/* The connection of a one-shot `--send`: opens the websocket, lets ZWebSocket pipeline every
+ * queued event as soon as it is connected, waits until the socket has written every byte of them,
+ * then closes the websocket cleanly, and reports whether the events were delivered.
+ *
+ * The time spent in each phase is measured on ZClock:
+ *  - startup: from the start of the process (as given to `start`) until the websocket is opened
+ *  - connect: until the handshake request is written, i.e. DNS, TCP (and TLS) are done
+ *  - handshake: until the handshake response is received, i.e. the websocket is connected
+ *  - send: until every queued event has been handed to the socket
+ *  - flush: until the socket has written every byte, and the close handshake is done
+ */
+class SendSession : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SendSession)
+
+public:
+    enum Phase
+    {
+        Startup,
+        Connect,
+        Handshake,
+        Send,
+        Flush,
+        PhaseCount
+    };
+
+    SendSession(ZWebSocket *socket, QObject *parent = nullptr);
+
+    void start(const QUrl &zBusUrl, qint64 started);
+    void stop(int timeout);
+    qint64 duration(Phase phase) const;
+    QString timings() const;
+
+signals:
+    void finished(bool delivered);
+
+private slots:
+    void flush();
+
+private:
+    void finish(bool delivered);
+
+    ZWebSocket *socket;
+    qint64 times[PhaseCount + 1];  // time each phase started, and the last ended, in ns (0 == not)
+    bool sent;                     // whether every queued event was handed to the socket
+    bool closing;                  // whether the close handshake was started
+    bool done;                     // whether `finished` was emitted
+};
+
+#endif
@@ -0,0 +1,372 @@
+#include "shmring.h"
+
+#include <QMutexLocker>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(ShmRingHeader) == 64, "ShmRingHeader must match the documented layout");
+static_assert(sizeof(ShmRingFrame) == 24, "ShmRingFrame must match the documented layout");
+
+static const char SHM_RING_MAGIC[8] = { 'Z', 'B', 'U', 'S', 'R', 'I', 'N', 'G' };
+
+/* \returns The given size rounded up to a multiple of 8 bytes, so frame headers stay aligned.
+ */
+static quint64 align(quint64 size)
+{
+    return (size + 7) & ~quint64(7);
+}
+
+/* \returns The name of a shared-memory object, which POSIX requires to start with "/".
+ */
+static QByteArray objectName(const QString &name)
+{
+    QByteArray object = name.toUtf8();
+    return object.startsWith('/') ? object : "/" + object;
+}
+
+/* \brief Constructs a ShmRing that is not open.
+ */
+ShmRing::ShmRing()
+    : header(nullptr), frames(nullptr), capacity(0), sequence(0), droppedFrames(0)
+{
+}
+
+/* \brief Closes the ring, removing the shared-memory object.
+ */
+ShmRing::~ShmRing()
+{
+    close();
+}
+
+/* \brief Creates (or takes over) the shared-memory object with the given name, maps it, and
+ *        initializes it as an empty ring. Readers of a previous ring with the same name see its
+ *        positions reset, and resume from the start of the new ring. Event traffic may carry
+ *        payment data, so the object is only readable by its owner, even if it already existed.
+ *
+ * \param <name> Name of the shared-memory object, e.g. "zbus-events" for /dev/shm/zbus-events.
+ * \param <capacity> Size of the frame area, in bytes, rounded up to a power of two.
+ *
+ * \returns True if the ring is open.
+ */
+bool ShmRing::open(const QString &name, quint64 capacity)
+{
+    close();
+
+    this->capacity = 4096;
+    while (this->capacity < capacity)
+    {
+        this->capacity <<= 1;
+    }
+
+    this->name = objectName(name);
+    int fd = shm_open(this->name.constData(), O_CREAT | O_RDWR, 0600);
+    if (fd == -1 || fchmod(fd, 0600) == -1)
+    {
+        error = QString("could not create shared memory %1: %2").arg(name, strerror(errno));
+        if (fd != -1)
+        {
+            ::close(fd);
+        }
+        return false;
+    }
+
+    size_t size = sizeof(ShmRingHeader) + this->capacity;
+    void *segment = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+    {
+        segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int mapError = errno;
+    ::close(fd);
+    if (segment == MAP_FAILED)
+    {
+        error = QString("could not map shared memory %1: %2").arg(name, strerror(mapError));
+        shm_unlink(this->name.constData());
+        return false;
+    }
+
+    // clear the magic first, so readers do not attach to a half-initialized header
+    header = static_cast<ShmRingHeader *>(segment);
+    frames = static_cast<char *>(segment) + sizeof(ShmRingHeader);
+    memset(header->magic, 0, sizeof(header->magic));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    header->version = SHM_RING_VERSION;
+    header->headerSize = sizeof(ShmRingHeader);
+    header->capacity = this->capacity;
+    __atomic_store_n(&header->reserve, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->commit, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->frames, 0, __ATOMIC_RELAXED);
+    memset(header->reserved, 0, sizeof(header->reserved));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(header->magic, SHM_RING_MAGIC, sizeof(header->magic));
+
+    sequence = 0;
+    droppedFrames = 0;
+    error.clear();
+    return true;
+}
+
+/* \brief Unmaps the ring, and removes the shared-memory object. Readers that have it mapped can
+ *        still read the frames that were published.
+ */
+void ShmRing::close()
+{
+    if (header == nullptr)
+    {
+        return;
+    }
+
+    munmap(header, sizeof(ShmRingHeader) + capacity);
+    shm_unlink(name.constData());
+    header = nullptr;
+    frames = nullptr;
+}
+
+/* \returns True if the ring is mapped, and frames are being published.
+ */
+bool ShmRing::isOpen() const
+{
+    return header != nullptr;
+}
+
+/* \returns Reason the ring could not be opened, if any.
+ */
+QString ShmRing::errorString() const
+{
+    return error;
+}
+
+/* \returns Number of frames that were not published because they were larger than half the
+ *          capacity of the ring.
+ */
+quint64 ShmRing::dropped() const
+{
+    return droppedFrames;
+}
+
+/* \brief Publishes a frame to every reader of the ring, overwriting the oldest frames if the ring
+ *        is full. Frames larger than half the capacity are dropped, so that a reader keeping up
+ *        with the writer always has at least one intact frame to read.
+ *
+ * \param <payload> Text of the frame.
+ * \param <timestamp> Time the frame arrived, in ns since the epoch.
+ */
+void ShmRing::publish(const QByteArray &payload, qint64 timestamp)
+{
+    QMutexLocker locker(&mutex);
+    if (header == nullptr)
+    {
+        return;
+    }
+
+    quint64 size = align(sizeof(ShmRingFrame) + payload.size());
+    if (size > capacity / 2)
+    {
+        droppedFrames++;
+        return;
+    }
+
+    // only this writer changes the positions, so they can be read without synchronization
+    quint64 start = header->commit;
+    quint64 offset = start & (capacity - 1);
+    quint64 skip = (capacity - offset < size) ? capacity - offset : 0;
+
+    __atomic_store_n(&header->reserve, start + skip + size, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (skip > 0)
+    {
+        // pad out the rest of the lap; offsets are multiples of 8, so the length always fits
+        reinterpret_cast<ShmRingFrame *>(frames + offset)->length = SHM_RING_PADDING;
+        offset = 0;
+    }
+
+    ShmRingFrame *frame = reinterpret_cast<ShmRingFrame *>(frames + offset);
+    frame->length = payload.size();
+    frame->reserved = 0;
+    frame->sequence = ++sequence;
+    frame->timestamp = timestamp;
+    memcpy(frame + 1, payload.constData(), payload.size());
+
+    __atomic_store_n(&header->frames, sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->commit, start + skip + size, __ATOMIC_RELEASE);
+}
+
+/* \brief Constructs a ShmRingReader that is not open.
+ */
+ShmRingReader::ShmRingReader()
+    : header(nullptr), frames(nullptr), capacity(0), size(0), position(0), overrunCount(0)
+{
+}
+
+/* \brief Unmaps the ring.
+ */
+ShmRingReader::~ShmRingReader()
+{
+    close();
+}
+
+/* \brief Maps the ring with the given name, read-only, and positions the reader after the last
+ *        frame published, so only frames published from now on are read.
+ *
+ * \param <name> Name of the shared-memory object.
+ *
+ * \returns True if the ring is open.
+ */
+bool ShmRingReader::open(const QString &name)
+{
+    close();
+
+    int fd = shm_open(objectName(name).constData(), O_RDONLY, 0);
+    if (fd == -1)
+    {
+        error = QString("could not open shared memory %1: %2").arg(name, strerror(errno));
+        return false;
+    }
+
+    struct stat status;
+    void *segment = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && size_t(status.st_size) >= sizeof(ShmRingHeader))
+    {
+        size = status.st_size;
+        segment = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (segment == MAP_FAILED)
+    {
+        error = QString("could not map shared memory %1").arg(name);
+        return false;
+    }
+
+    header = static_cast<const ShmRingHeader *>(segment);
+    bool valid = memcmp(header->magic, SHM_RING_MAGIC, sizeof(header->magic)) == 0;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (!valid || header->version != SHM_RING_VERSION || header->headerSize != sizeof(ShmRingHeader) ||
+        header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+        sizeof(ShmRingHeader) + header->capacity > size)
+    {
+        error = QString("shared memory %1 is not a zBus ring").arg(name);
+        close();
+        return false;
+    }
+
+    frames = static_cast<const char *>(segment) + sizeof(ShmRingHeader);
+    capacity = header->capacity;
+    position = __atomic_load_n(&header->commit, __ATOMIC_ACQUIRE);
+    overrunCount = 0;
+    error.clear();
+    return true;
+}
+
+/* \brief Unmaps the ring.
+ */
+void ShmRingReader::close()
+{
+    if (header == nullptr)
+    {
+        return;
+    }
+
+    munmap(const_cast<ShmRingHeader *>(header), size);
+    header = nullptr;
+    frames = nullptr;
+}
+
+/* \returns True if the ring is mapped.
+ */
+bool ShmRingReader::isOpen() const
+{
+    return header != nullptr;
+}
+
+/* \returns Reason the ring could not be opened, if any.
+ */
+QString ShmRingReader::errorString() const
+{
+    return error;
+}
+
+/* \returns Number of times the reader fell more than the capacity of the ring behind the writer,
+ *          and skipped ahead to the newest frame, losing the frames in between.
+ */
+quint64 ShmRingReader::overruns() const
+{
+    return overrunCount;
+}
+
+/* \brief Reads the next frame published to the ring, if any, in place. The frame remains valid
+ *        until the writer laps it; check `isIntact` after processing it to be sure it was not
+ *        overwritten in the meantime.
+ *
+ * \param <frame> Frame to be filled in.
+ *
+ * \returns True if a frame was read, false if the reader has caught up with the writer.
+ */
+bool ShmRingReader::next(Frame &frame)
+{
+    while (header != nullptr)
+    {
+        quint64 commit = __atomic_load_n(&header->commit, __ATOMIC_ACQUIRE);
+        if (commit - position > capacity)
+        {
+            // lapped by the writer (or the ring was reset): skip to the newest frame
+            overrunCount++;
+            position = commit;
+        }
+        if (position == commit)
+        {
+            return false;
+        }
+
+        quint64 offset = position & (capacity - 1);
+        const ShmRingFrame *record = reinterpret_cast<const ShmRingFrame *>(frames + offset);
+        quint32 length = record->length;
+        quint64 sequence = record->sequence;
+        qint64 timestamp = record->timestamp;
+        if (!isIntact(position))
+        {
+            // overwritten while it was being read
+            overrunCount++;
+            position = __atomic_load_n(&header->commit, __ATOMIC_ACQUIRE);
+            continue;
+        }
+
+        if (length == SHM_RING_PADDING)
+        {
+            position += capacity - offset;
+            continue;
+        }
+
+        frame = { reinterpret_cast<const char *>(record + 1), int(length), sequence, timestamp,
+                  position };
+        position += align(sizeof(ShmRingFrame) + length);
+        return true;
+    }
+
+    return false;
+}
+
+/* \param <frame> Frame returned by `next`.
+ *
+ * \returns True if the frame has not been overwritten since it was read, so everything read from
+ *          it so far is valid.
+ */
+bool ShmRingReader::isIntact(const Frame &frame) const
+{
+    return isIntact(frame.position);
+}
+
+/* \param <position> Position of a frame in the ring.
+ *
+ * \returns True if the writer has not started overwriting the frame at the given position.
+ */
+bool ShmRingReader::isIntact(quint64 position) const
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&header->reserve, __ATOMIC_RELAXED) - position <= capacity;
+}
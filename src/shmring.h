@@ -0,0 +1,145 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QtGlobal>
+
+/* Layout of a ring buffer in POSIX shared memory (shm_open), as published by ShmRing. All integers
+ * are native-endian. The segment is a 64-byte header followed by `capacity` bytes of frames:
+ *
+ *   offset  size  header field
+ *        0     8  magic, "ZBUSRING"
+ *        8     4  version, SHM_RING_VERSION
+ *       12     4  header size, in bytes (offset of the first frame)
+ *       16     8  capacity of the frame area, in bytes (a power of two)
+ *       24     8  reserve position: end of the frame being written
+ *       32     8  commit position: end of the last frame that was completely written
+ *       40     8  number of frames published
+ *       48    16  reserved
+ *
+ * Positions count every byte ever written, so a position maps to offset (position & (capacity - 1))
+ * in the frame area. Each frame is a 24-byte header followed by its payload, padded to a multiple
+ * of 8 bytes:
+ *
+ *   offset  size  frame field
+ *        0     4  length of the payload, in bytes (SHM_RING_PADDING == skip to the next lap)
+ *        4     4  reserved
+ *        8     8  sequence number, starting from 1
+ *       16     8  timestamp, in ns since the epoch, taken as the frame arrived
+ *       24     -  payload: the text of the websocket message, in UTF-8
+ *
+ * A frame never straddles the end of the frame area: if it does not fit, the rest of the lap is
+ * skipped with a padding frame, which may be just the 4-byte length.
+ *
+ * There is one writer, and any number of readers, which never write to the segment, so readers
+ * never slow the writer down. The writer advances the reserve position (followed by a release
+ * fence), writes the frame, then advances the commit position with release semantics. A reader
+ * loads the commit position with acquire semantics, reads frames up to it in place, then (after an
+ * acquire fence) loads the reserve position: a frame starting at position p was intact if
+ * reserve - p <= capacity. A reader that falls more than `capacity` bytes behind has lost frames,
+ * and resumes from the commit position.
+ */
+struct ShmRingHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 headerSize;
+    quint64 capacity;
+    quint64 reserve;
+    quint64 commit;
+    quint64 frames;
+    char reserved[16];
+};
+
+struct ShmRingFrame
+{
+    quint32 length;
+    quint32 reserved;
+    quint64 sequence;
+    qint64 timestamp;
+};
+
+static const quint32 SHM_RING_VERSION = 1;
+static const quint32 SHM_RING_PADDING = 0xffffffff;
+
+/* The writer of a shared-memory ring buffer, which publishes every frame received from zBus so
+ * that any number of local processes (e.g. log shippers, or test harnesses) can consume the event
+ * stream of one connection. Frames are written without waiting for readers: a reader that falls
+ * behind by more than the capacity of the ring loses frames, rather than holding up the writer.
+ *
+ * Publishing is serialized, so one ring may be shared by several connections on different threads.
+ */
+class ShmRing
+{
+    Q_DISABLE_COPY(ShmRing)
+
+public:
+    ShmRing();
+    ~ShmRing();
+
+    bool open(const QString &name, quint64 capacity);
+    void close();
+
+    bool isOpen() const;
+    QString errorString() const;
+    quint64 dropped() const;
+
+    void publish(const QByteArray &payload, qint64 timestamp);
+
+private:
+    QMutex mutex;           // serializes publishers
+    QByteArray name;        // name of the shared-memory object, starting with "/"
+    ShmRingHeader *header;  // start of the mapped segment (nullptr == not open)
+    char *frames;           // start of the frame area
+    quint64 capacity;       // size of the frame area, in bytes
+    quint64 sequence;       // sequence number of the last frame published
+    quint64 droppedFrames;  // frames too large to be published
+    QString error;          // reason the segment could not be opened, if any
+};
+
+/* A reader of a shared-memory ring buffer written by ShmRing. Frames are returned in place, in the
+ * shared memory, without being copied; since the writer never waits, a frame that is processed
+ * slowly may be overwritten, which `isIntact` detects after the fact.
+ */
+class ShmRingReader
+{
+    Q_DISABLE_COPY(ShmRingReader)
+
+public:
+    struct Frame
+    {
+        const char *data;   // payload, in the shared memory
+        int length;         // length of the payload, in bytes
+        quint64 sequence;   // sequence number of the frame
+        qint64 timestamp;   // time the frame arrived, in ns since the epoch
+        quint64 position;   // position of the frame in the ring
+    };
+
+    ShmRingReader();
+    ~ShmRingReader();
+
+    bool open(const QString &name);
+    void close();
+
+    bool isOpen() const;
+    QString errorString() const;
+    quint64 overruns() const;
+
+    bool next(Frame &frame);
+    bool isIntact(const Frame &frame) const;
+
+private:
+    bool isIntact(quint64 position) const;
+
+    const ShmRingHeader *header;  // start of the mapped segment (nullptr == not open)
+    const char *frames;           // start of the frame area
+    quint64 capacity;             // size of the frame area, in bytes
+    size_t size;                  // size of the mapped segment, in bytes
+    quint64 position;             // position of the next frame to be read
+    quint64 overrunCount;         // times the reader fell behind, and lost frames
+    QString error;                // reason the segment could not be opened, if any
+};
+
+#endif
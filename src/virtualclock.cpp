@@ -0,0 +1,80 @@
+#include "virtualclock.h"
+
+#include <QMutexLocker>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+
+/* \brief Constructs a VirtualClock, with no tasks scheduled.
+ *
+ * \param <start> Time the clock starts at, in ns (timestamps are never 0, as on ZClock).
+ */
+VirtualClock::VirtualClock(qint64 start) : time(start)
+{
+}
+
+/* \returns Current time, in ns.
+ */
+qint64 VirtualClock::now() const
+{
+    QMutexLocker locker(&mutex);
+    return time;
+}
+
+/* \brief Schedules a task to run once the clock is advanced by at least `delay` ms.
+ *
+ * \param <delay> Delay, in ms.
+ * \param <context> Object the task runs for; the task does not run if it is destroyed first.
+ * \param <task> Task to run.
+ */
+void VirtualClock::schedule(int delay, QObject *context, const std::function<void ()> &task)
+{
+    QMutexLocker locker(&mutex);
+    // a task goes after those due at the same time, so they run in the order they were scheduled
+    Task scheduledTask = { time + qint64(qMax(delay, 0)) * 1000000, context, task };
+    auto position = std::upper_bound(tasks.begin(), tasks.end(), scheduledTask,
+                                     [] (const Task &a, const Task &b) { return a.due < b.due; });
+    tasks.insert(position, scheduledTask);
+}
+
+/* \brief Moves the time forward, running each task that falls due along the way, including those
+ *        scheduled by the tasks themselves.
+ *
+ * \param <ms> Time to move forward by, in ms.
+ */
+void VirtualClock::advance(qint64 ms)
+{
+    QMutexLocker locker(&mutex);
+    qint64 target = time + ms * 1000000;
+    while (!tasks.isEmpty() && tasks.first().due <= target)
+    {
+        Task task = tasks.takeFirst();
+        time = qMax(time, task.due);
+        locker.unlock();
+
+        // a task whose context is gone is dropped
+        if (!task.context.isNull())
+        {
+            if (task.context->thread() == QThread::currentThread())
+            {
+                task.run();
+            }
+            else
+            {
+                QTimer::singleShot(0, task.context.data(), task.run);
+            }
+        }
+
+        locker.relock();
+    }
+    time = qMax(time, target);
+}
+
+/* \returns Number of tasks that have not run yet.
+ */
+int VirtualClock::pendingCount() const
+{
+    QMutexLocker locker(&mutex);
+    return tasks.size();
+}
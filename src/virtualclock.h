@@ -0,0 +1,41 @@
+#ifndef VIRTUAL_CLOCK_H
+#define VIRTUAL_CLOCK_H
+
+#include "scheduler.h"
+
+#include <QMutex>
+#include <QPointer>
+#include <QVector>
+
+/* A Scheduler whose time stands still until it is advanced, for tests of timed behavior: advancing
+ * it runs every task that falls due, in the order they fall due, at once, with the time set to when
+ * each task was due. Tasks due at the same time run in the order they were scheduled.
+ *
+ * Tasks run on the thread that advances the clock, if their context lives on it, and are otherwise
+ * posted to the thread of their context. Tasks may be scheduled from any thread.
+ */
+class VirtualClock : public Scheduler
+{
+public:
+    VirtualClock(qint64 start = 1);
+
+    qint64 now() const override;
+    void schedule(int delay, QObject *context, const std::function<void ()> &task) override;
+
+    void advance(qint64 ms);
+    int pendingCount() const;
+
+private:
+    struct Task
+    {
+        qint64 due;                 // time the task falls due, in ns
+        QPointer<QObject> context;  // object the task runs for, or nullptr once destroyed
+        std::function<void ()> run;
+    };
+
+    mutable QMutex mutex;  // guards the members below
+    qint64 time;           // current time, in ns
+    QVector<Task> tasks;   // tasks that have not run yet, in the order they fall due
+};
+
+#endif
@@ -1,29 +1,72 @@
 #include "zbuscli.h"
 
+#include "heightindex.h"
+#include "eventpipeline.h"
+#include "eventrecord.h"
+#include "eventstats.h"
+#include "jsontree.h"
+#include "pinpadsimulator.h"
+#include "ratelimiter.h"
+#include "scheduler.h"
 #include "zbusevent.h"
-#include "zwebsocket.h"
+#include "zclock.h"
+#include "zconnection.h"
 
 // Qt libraries MUST be imported before ncurses libraries.
 // Somewhere in the depths of ncurses, there is a macro that redefines `timeout` globally.
+#include <QCache>
 #include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
 #include <QJsonDocument>
 #include <QJsonValue>
 #include <QList>
-#include <QPair>
+#include <QStringList>
 #include <QTimer>
 #include <QQueue>
 #include <QVector>
 
+#include <limits>
+
 // ncurses libraries
 #include <form.h>
 #include <ncurses.h>
 
-// How long to wait after a disconnection from zBus to retry connecting, in milliseconds.
-static const int RETRY_DELAY_MS = 500;
-
 // How long to wait for input before updating the display, in deciseconds.
 static const int INPUT_WAIT_DS = 1;
 
+// Longest a bracketed paste is read for, waiting for its end, before the rest is given up on, in
+// ms.
+static const int PASTE_TIMEOUT_MS = 5000;
+
+// Default maximum number of rows an event occupies in the history window while it is not selected.
+static const int MAX_EVENT_ROWS = 4;
+
+// Number of most recent entries in the event history searched for the latest inbound event from the
+// same zBus server as an inbound event (past outbound events, and those of other servers). An
+// inbound event identical to that one is counted as a repeat of it, rather than added to the event
+// history as a new entry, so the history stays in the order events arrived.
+static const int DUPLICATE_WINDOW = 8;
+
+// Number of events for which the detail pane keeps the tree of their data.
+static const int DETAIL_TREE_CACHE_SIZE = 64;
+
+// How many events to add to the history height index per iteration of the event loop, while the
+// index is being rebuilt after the terminal is resized.
+static const int HISTORY_INDEX_REBUILD_BUDGET = 4096;
+
+// How long inbound events are held before being added to the event history when connected to
+// several zBus servers, in ms. Events from different servers arrive on different I/O threads, so
+// they are held briefly to be merged into the event history in the order they were received.
+static const int MERGE_DELAY_MS = 50;
+
+// Timestamp of an event, in ns, that no event will reach, for a merge queue that is empty.
+static const qint64 MERGE_QUEUE_EMPTY = std::numeric_limits<qint64>::max();
+
+// Width of the time column displayed before each event in the history window, when enabled.
+static const int TIME_COLUMN_WIDTH = 13;
+
 // ncurses colors
 static const int GREEN_TEXT = 1;
 static const int RED_TEXT = 2;
@@ -40,13 +83,38 @@ static const QMap<Direction, QString> direction_sign
     { Direction::Outbound, "<- " }
 };
 
+/* What is displayed in the time column before each event in the history window: nothing, the time
+ * the event was received or sent, the time since the previous event, or the time since the previous
+ * event with the same requestId (i.e. the previous step of the same flow, such as a payment).
+ */
+enum class TimeDisplay { None, Absolute, Delta, FlowDelta };
+
+/* An event stored in the event history. The event is kept as a compact, immutable record of its
+ * JSON text, rather than as a ZBusEvent, so that a retained event costs little more than its text;
+ * only the characters that fit in the history window are decoded when it is displayed, and the data
+ * is only parsed again when the event is selected.
+ *
+ * Identical inbound events received in quick succession share a single entry, which counts how many
+ * times the event was received, and when it was first and last received.
+ */
+struct HistoryEntry
+{
+    EventRecord record;     // direction, source, JSON text, and time the event was first received
+    int repeats;            // number of times the event has been received
+    qint64 last_received;   // time the event was last received (or sent), in ns on ZClock
+    int previous_step;      // index of the previous event with the same requestId (-1 == none)
+};
+
 // Maps each mode to the corresponding help text to be displayed.
 static const QMap<Mode, QString> help_text
 {
     { Mode::Command, "Esc) back, m) toggle pinpad simulator, s) begin send mode, "
-                     "p) begin peruse mode, q) quit" },
+                     "p) begin peruse mode, t) begin stats mode, c) change send target, q) quit" },
     { Mode::Send, "Esc) back, Tab) switch field, Enter) send event" },
-    { Mode::Peruse, "Esc) back" }
+    { Mode::Peruse, "Esc) back, Up/Down/PgUp/PgDn/Home/End) select event, "
+                    "<number> g) select event <number>, j/k) move in data, "
+                    "Left/Right/Enter) collapse/expand data, d) time/delta/flow delta" },
+    { Mode::Stats, "Esc) back" }
 };
 
 /* A container for the data associated with each entry in the mock menu. An instance of
@@ -70,14 +138,6 @@ struct MockMenuEntry
     MockMenuEntry(const QString &text, enum Mock mock) : text(text), menu(Menu::None), mock(mock) {}
 };
 
-static const QMap<QString, QVector<Mock>> pinpad_simulator_responses
-{
-    { "pos.connected", { Mock::PinpadDisplayItemSuccess } },
-    { "pinpad.preparePaymentRequest", { Mock::PinpadCardInserted, Mock::PinpadCardInfo } },
-    { "pinpad.authorizePaymentRequest", { Mock::PinpadPaymentAccepted, Mock::PinpadCardRemoved } },
-    { "pinpad.finishPaymentRequest", { Mock::PinpadFinishPaymentRequest } }
-};
-
 /* Maps each `Menu` value to a list of `MockMenuEntry`s. This map represents a tree (excluding the
  * cycles introduced by the "back" option) where branches point to lists of mock menu entries, and
  * leaves point to a mock event.
@@ -159,8 +219,10 @@ struct Context
 {
     // general context
     bool pinpad_simulated = false;  // simulates affirmative responses from pinpad
-    bool connected = true;          // zbus connection status
-    int size = 0;                   // last recorded size of event_history
+    int connected = -1;             // number of zBus servers connected to (-1 == not yet known)
+    int target = -1;                // zBus server events are sent to (-1 == all)
+    qint64 suppressed = 0;          // number of events suppressed by the rate limit
+    int revision = 0;               // last recorded revision of event_history
     Mode mode = Mode::Command;      // mode with which to process input
 
     // command mode context
@@ -169,6 +231,11 @@ struct Context
     // peruse mode context
     int top = 0;                    // index in event_history of event at the top of history window
     int selection = -1;             // index in event_history of selected event (-1 == no selection)
+    int jump = -1;                  // index in event_history being entered to jump to (-1 == none)
+    TimeDisplay time_display = TimeDisplay::None; // what the time column displays
+
+    // stats mode context
+    qint64 stats_second = -1;       // second of uptime the statistics were last displayed for
 };
 
 // Stores the dimensions and position of an ncurses WINDOW object alongside said WINDOW object.
@@ -203,11 +270,36 @@ struct META_WINDOW
 class ZBusCliPrivate
 {
 public:
-    QList<QPair<Direction, ZBusEvent>> event_history; // list of all events to and from zBus
+    EventArena arena;                                 // allocator of event history records
+    QVector<HistoryEntry> event_history;              // list of all events to and from zBus
+    int revision = 0;                                 // incremented when event_history changes
+    HeightIndex history_index;                        // height of each event in event_history
+    QString selection_text;                           // full text of the selected event
+    int selection_text_index = -1;                    // index of the event in selection_text
+    QCache<int, JsonTree> detail_trees{DETAIL_TREE_CACHE_SIZE}; // data of recently selected events
     QString current_request_id;                       // last requestId received from zBus event
     QString current_auth_attempt_id;                  // last authAttemptId received from zBus event
     bool pinpad_simulated;                            // simulates affirmative responses from pinpad
-    ZWebSocket client;                                // sender and receiver of zBus events
+    RateLimiter display_limiter;                      // limits inbound events stored and displayed
+    bool limit_by_domain = false;                     // limits events by domain, rather than name
+    QVector<ZConnection *> connections;               // senders and receivers of zBus events
+    int target = -1;                                  // connection events are sent to (-1 == all)
+    QVector<QQueue<InboundEvent>> merge_queues;       // inbound events waiting to be merged,
+                                                      // per zBus server, in the order received
+    QVector<InboundEvent> merge_batch;                // inbound events being handed to pipeline
+    bool merge_scheduled = false;                     // whether a merge is scheduled
+    EventPipeline pipeline;                           // stages that inbound events pass through
+    EventStats stats;                                 // traffic of each event name, in and out
+    TimeDisplay time_display = TimeDisplay::None;     // what the time column displays
+    QHash<QString, int> flow_steps;                   // index of the last event with each requestId
+    ShmRing *shm_ring = nullptr;                      // ring inbound frames are published to
+    TlsOptions tls_options;                           // how wss:// servers are verified
+    bool standby = false;                             // whether each server has a standby socket
+    Scheduler *scheduler = Scheduler::system();       // clock and timers of timed behavior
+    PinpadSimulator simulator;                        // responds to requests to the pinpad
+    QFile frame_log;                                  // file each drawn frame is logged to
+    int refreshes = 0;                                // number of window refreshes so far
+    qint64 oldest_merged = 0;                         // arrival of oldest event merged (0 == none)
 
     FIELD *entry_fields[3] = {};
     FORM *entry_form = nullptr;
@@ -219,6 +311,7 @@ public:
     META_WINDOW entry;
     META_WINDOW sub_entry;
     META_WINDOW history;
+    META_WINDOW detail;
 
     /* \brief Initializes ncurses and constructs the UI to use all available space in the terminal.
     */
@@ -233,6 +326,11 @@ public:
         nonl();                   // allows curses to detect the return key
         halfdelay(INPUT_WAIT_DS); // sets delay between infinite loop iterations
 
+        // enable bracketed paste mode, so that text pasted into the terminal is received as a
+        // single block, surrounded by markers, rather than as a series of keypresses
+        printf("\033[?2004h");
+        fflush(stdout);
+
         // initialize ncurses colors
         init_pair(GREEN_TEXT, COLOR_GREEN, -1);
         init_pair(RED_TEXT, COLOR_RED, -1);
@@ -249,7 +347,7 @@ public:
         help.window = newwin(help.rows, help.columns, help.y, help.x);
         wmove(help.window, 0, 0);
         wprintw(help.window, help_text.value(Mode::Command).toUtf8());
-        wrefresh(help.window);
+        refresh_window(help.window);
 
         // create window to display connection status with zBus
         status.rows = 3;
@@ -318,7 +416,7 @@ public:
         wprintw(entry.window, request_id_label.toUtf8());
         wmove(entry.window, data_y, 0);
         wprintw(entry.window, data_label.toUtf8());
-        wrefresh(entry.window);
+        refresh_window(entry.window);
 
         // create window to display mock menu entries
         mock_menu.rows = 7;
@@ -334,9 +432,19 @@ public:
         history.y = screen.rows - history.rows;
         history.x = screen.columns - history.columns;
         history.window = newwin(history.rows, history.columns, history.y, history.x);
+        history_index.setColumns(history.columns);
+        history_index.setMaxHeight(MAX_EVENT_ROWS);
         wmove(history.window, 0, 0);
         wprintw(history.window, "Events broadcast by the zBus server will appear here.");
-        wrefresh(history.window);
+        refresh_window(history.window);
+
+        // create window to display the data of the selected event, which is only displayed in
+        // peruse mode, and sized when it is displayed
+        detail.rows = 1;
+        detail.columns = screen.columns;
+        detail.y = screen.rows - detail.rows;
+        detail.x = screen.columns - detail.columns;
+        detail.window = newwin(detail.rows, detail.columns, detail.y, detail.x);
     }
 
     /* \brief Frees up memory occupied by the ncurses windows, forms, and fields, then ends curses
@@ -350,6 +458,9 @@ public:
         delwin(entry.window);
         delwin(mock_menu.window);
         delwin(history.window);
+        delwin(detail.window);
+
+        qDeleteAll(connections);
 
         free_form(entry_form);
         free_field(entry_fields[0]);
@@ -357,6 +468,39 @@ public:
         free_field(entry_fields[2]);
 
         endwin();
+
+        // disable bracketed paste mode
+        printf("\033[?2004l");
+        fflush(stdout);
+    }
+
+    /* \brief Copies the given window to the terminal, counting the refresh for the frame log.
+     *
+     * \param <window> Window to be refreshed.
+     */
+    void refresh_window(WINDOW *window)
+    {
+        wrefresh(window);
+        refreshes++;
+    }
+
+    /* \brief Logs a drawn frame to the frame log, if one is open, as one line of `<trigger>
+     *        <latency> <refreshes>`, with the latency in ns.
+     *
+     * \param <trigger> What the frame was drawn for: `input`, `resize`, `events`, or `timer`.
+     * \param <latency> Time from the trigger to the last window of the frame being refreshed.
+     * \param <count> Number of windows refreshed to draw the frame.
+     */
+    void log_frame(const char *trigger, qint64 latency, int count)
+    {
+        if (!frame_log.isOpen())
+        {
+            return;
+        }
+
+        frame_log.write(QByteArray(trigger) + ' ' + QByteArray::number(latency) + ' ' +
+                        QByteArray::number(count) + '\n');
+        frame_log.flush();
     }
 
     /* \brief Displays the help text corresponding to the given mode.
@@ -369,20 +513,28 @@ public:
         wmove(help.window, 0, 0);
         wclear(help.window);
         wprintw(help.window, help_text.value(mode).toUtf8());
-        wrefresh(help.window);
+        refresh_window(help.window);
     }
 
-    /*  \brief Displays the status of the pinpad simulator and the zbus connection.
+    /*  \brief Displays the status of the pinpad simulator and the zbus connections, and a summary
+     *         of the events suppressed by the rate limit, if any.
      *
      *  \param <pinpad_simulated> Indicator of whether the pinpad simulator is enabled.
-     *  \param <connected> Indicator of whether the websocket is connected to zbus.
-     *  \param <error> The error encountered while trying to connect to zBus.
+     *  \param <connected> Number of zBus servers the client is connected to.
+     *  \param <error> The errors encountered while trying to connect to zBus.
+     *  \param <target> Name of the zBus server events are sent to, if there are several.
+     *  \param <suppressed> Summary of the events suppressed by the rate limit.
+     *
+     *  \returns True if the height of the status window changed.
      */
-    void update_status(bool pinpad_simulated, bool connected, QString error)
+    bool update_status(bool pinpad_simulated, int connected, QString error, QString target,
+                       QString suppressed)
     {
         wclear(status.window);
 
-        status.rows = 2 + !connected + pinpad_simulated;
+        bool all_connected = connected == connections.size();
+        int previous_rows = status.rows;
+        status.rows = 2 + !all_connected + pinpad_simulated + !suppressed.isEmpty();
         status.y = help.y + help.rows;
         status.regenerate();
 
@@ -400,28 +552,52 @@ public:
         }
 
         // update the status message and error message
-        if (connected)
+        QString servers = QString::number(connections.size()) + " zBus servers";
+        if (all_connected)
         {
+            QString message = connections.size() == 1 ? QString("status: connected to zBus")
+                                                       : "status: connected to all " + servers;
             wattron(status.window, COLOR_PAIR(GREEN_TEXT) | A_BOLD);
-            wprintw(status.window, "status: connected to zBus");
+            wprintw(status.window, message.toUtf8());
             wattroff(status.window, COLOR_PAIR(GREEN_TEXT) | A_BOLD);
         }
         else
         {
+            QString message = connections.size() == 1
+                ? QString("status: disconnected from zBus")
+                : QString("status: connected to %1 of %2").arg(connected).arg(servers);
             wattron(status.window, COLOR_PAIR(RED_TEXT) | A_BOLD);
-            wprintw(status.window, "status: disconnected from zBus");
+            wprintw(status.window, message.toUtf8());
             wattroff(status.window, COLOR_PAIR(RED_TEXT) | A_BOLD);
-            row++;
+        }
 
-            // display the error message from the websocket
+        // with several zBus servers, name the one events are sent to
+        if (!target.isEmpty())
+        {
+            wprintw(status.window, QString(", sending to " + target).toUtf8());
+        }
+
+        // display the error message from the websocket(s)
+        if (!all_connected)
+        {
+            row++;
             wmove(status.window, row, 0);
             wattron(status.window, COLOR_PAIR(RED_TEXT) | A_BOLD);
             wprintw(status.window, "error: ");
-            wprintw(status.window, error.toUtf8());
+            waddstr(status.window, error.left(status.columns - 8).toUtf8());
             wattroff(status.window, COLOR_PAIR(RED_TEXT) | A_BOLD);
         }
 
-        wrefresh(status.window);
+        // summarize the events suppressed by the rate limit on a single line
+        if (!suppressed.isEmpty())
+        {
+            row++;
+            wmove(status.window, row, 0);
+            wprintw(status.window, suppressed.left(status.columns - 1).toUtf8());
+        }
+
+        refresh_window(status.window);
+        return status.rows != previous_rows;
     }
 
     /* \brief Generates a visual list from the menu entries associated with the given menu value,
@@ -452,7 +628,7 @@ public:
             wprintw(mock_menu.window, entries.at(i).text.toUtf8());
         }
         redrawwin(mock_menu.window);
-        wrefresh(mock_menu.window);
+        refresh_window(mock_menu.window);
     }
 
     /* \brief Repositions the entry window underneatht the status window.
@@ -476,6 +652,291 @@ public:
         set_field_buffer(entry_fields[2], 0, event.dataString().toUtf8());
     }
 
+    /* \brief Reads the remainder of a bracketed paste, after the "Esc + [ + 2" that begins it has
+     *        been read. A bracketed paste is received in the form "Esc + [ + 2 + 0 + 0 + ~",
+     *        followed by the pasted text, followed by "Esc + [ + 2 + 0 + 1 + ~".
+     *
+     * \param <paste> Buffer to be filled with the pasted text.
+     *
+     * \returns True if the input was a bracketed paste. False if the input was some other escape
+     *          sequence beginning with "Esc + [ + 2" (e.g. Insert), in which case that escape
+     *          sequence has been consumed.
+     */
+    bool read_paste(QByteArray &paste)
+    {
+        if (wgetch(entry.window) != '0' ||
+            wgetch(entry.window) != '0' ||
+            wgetch(entry.window) != '~')
+        {
+            return false;
+        }
+
+        // read until the end of the paste, which may arrive in several chunks (e.g. over ssh), or
+        // until the terminal has not sent the end of it in time
+        static const QByteArray paste_end("\033[201~");
+        qint64 deadline = ZClock::now() + qint64(PASTE_TIMEOUT_MS) * 1000000;
+        paste.clear();
+        while (ZClock::now() < deadline)
+        {
+            int input = wgetch(entry.window);
+            if (input == ERR)
+            {
+                continue;
+            }
+
+            paste.append(char(input));
+            if (paste.endsWith(paste_end))
+            {
+                paste.chop(paste_end.size());
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    /* \brief Inserts the given text at the cursor in the current entry field, in a single update to
+     *        the field buffer, then moves the cursor to the end of the field. Line breaks and tabs
+     *        are replaced with spaces, since the entry fields do not accept them as text.
+     *
+     * \param <paste> Text to be inserted into the current entry field.
+     */
+    void insert_paste(QByteArray paste)
+    {
+        paste.replace('\r', ' ').replace('\n', ' ').replace('\t', ' ');
+
+        // synchronize the field buffer with the contents of the form, then locate the cursor in it
+        form_driver(entry_form, REQ_VALIDATION);
+        FIELD *field = current_field(entry_form);
+        QByteArray buffer(field_buffer(field, 0));
+        int cursor = qMin(entry_form->currow * field->dcols + entry_form->curcol, buffer.size());
+
+        // remove the padding the field buffer is filled with, then insert the paste
+        buffer.insert(cursor, paste);
+        while (buffer.endsWith(' '))
+        {
+            buffer.chop(1);
+        }
+
+        set_field_buffer(field, 0, buffer);
+        form_driver(entry_form, REQ_END_FIELD);
+    }
+
+    /* \brief Appends the given event to the event history, and measures its printed length for the
+     *        history height index. The event is formatted once, here; only the beginning of the
+     *        formatted text is kept.
+     *
+     *        If the event is inbound, and identical (in name and data) to the latest inbound event
+     *        from the same zBus server, it is counted as a repeat of that event instead, and is not
+     *        stored again.
+     *
+     * \param <direction> Direction of the event, relative to zBus.
+     * \param <source> zBus server the event was received from or sent to (-1 == all).
+     * \param <event> The zBus event to be recorded.
+     *
+     * \returns Record of the event, or of the event it was counted as a repeat of.
+     */
+    EventRecord record_event(Direction direction, int source, const ZBusEvent &event)
+    {
+        qint64 now = event.timestamp != 0 ? event.timestamp : scheduler->now();
+        return record_event(direction, source, event.toUtf8Json(), event.name(), event.requestId,
+                            now);
+    }
+
+    /* \brief Appends an event to the event history from its JSON text, without decoding it. See
+     *        the other overload.
+     *
+     * \param <direction> Direction of the event, relative to zBus.
+     * \param <source> zBus server the event was received from or sent to (-1 == all).
+     * \param <json> JSON text of the event, laid out as by ZBusEvent::toJson (see EventRecord).
+     * \param <name> Name of the event.
+     * \param <request_id> `requestId` of the event (empty == none).
+     * \param <now> Time the event crossed the websocket, in ns on ZClock.
+     *
+     * \returns Record of the event, or of the event it was counted as a repeat of.
+     */
+    EventRecord record_event(Direction direction, int source, const QByteArray &json,
+                             const QString &name, const QString &request_id, qint64 now)
+    {
+        revision++;
+
+        // the name and data of the event are the prefix of its JSON text before the requestId
+        QByteArray key = QByteArray::fromRawData(json.constData(), EventRecord::keySize(json));
+        uint hash = qHash(key);
+        if (direction == Direction::Inbound)
+        {
+            for (int i = event_history.size() - 1;
+                 i >= qMax(event_history.size() - DUPLICATE_WINDOW, 0);
+                 i--)
+            {
+                HistoryEntry &entry = event_history[i];
+                if (Direction(entry.record.direction()) != Direction::Inbound ||
+                    entry.record.source() != source)
+                {
+                    continue;
+                }
+
+                // only the latest inbound event from the server is repeated; "A, B, A" stays so
+                if (entry.record.hash() == hash && entry.record.key() == key)
+                {
+                    entry.repeats++;
+                    entry.last_received = now;
+                    history_index.update(i, label(entry).size() + entry.record.length());
+                    return entry.record;
+                }
+                break;
+            }
+        }
+
+        // link the event to the previous step of its flow, if it has a requestId
+        int previous_step = -1;
+        if (!request_id.isEmpty())
+        {
+            previous_step = flow_steps.value(request_id, -1);
+            flow_steps.insert(request_id, event_history.size());
+        }
+
+        EventRecord record = arena.create(int(direction), source, name, hash, now, json);
+        event_history.append({ record, 1, now, previous_step });
+        history_index.append(label(event_history.last()).size() + record.length());
+        return record;
+    }
+
+    /* \brief Returns the text displayed before the JSON text of an event: the direction of the
+     *        event, the zBus server it was received from or sent to, if there are several, and, if
+     *        the event has been repeated, the number of times it was received, and when it was
+     *        first and last received.
+     *
+     * \param <entry> The event history entry to be displayed.
+     */
+    QString label(const HistoryEntry &entry)
+    {
+        QString label = direction_sign.value(Direction(entry.record.direction()));
+        if (connections.size() > 1)
+        {
+            label += "[" + target_name(entry.record.source()) + "] ";
+        }
+        if (entry.repeats > 1)
+        {
+            QDateTime first = QDateTime::fromMSecsSinceEpoch(
+                ZClock::toMSecsSinceEpoch(entry.record.timestamp()));
+            QDateTime last = QDateTime::fromMSecsSinceEpoch(
+                ZClock::toMSecsSinceEpoch(entry.last_received));
+            label += QString("(x%1 %2-%3) ").arg(entry.repeats)
+                                            .arg(first.toString("hh:mm:ss"))
+                                            .arg(last.toString("hh:mm:ss"));
+        }
+
+        return label;
+    }
+
+    /* \brief Returns the time column displayed before the given event, TIME_COLUMN_WIDTH
+     *        characters wide, or nothing if the time column is disabled. Times are those of the
+     *        first occurrence of repeated events.
+     *
+     * \param <index> The index of the event in event_history.
+     */
+    QString time_column(int index)
+    {
+        const HistoryEntry &entry = event_history.at(index);
+
+        int previous = -1;
+        switch (time_display)
+        {
+            case TimeDisplay::None:
+                return QString();
+            case TimeDisplay::Absolute:
+                return QDateTime::fromMSecsSinceEpoch(
+                    ZClock::toMSecsSinceEpoch(entry.record.timestamp())).toString("hh:mm:ss.zzz ");
+            case TimeDisplay::Delta:
+                previous = index - 1;
+                break;
+            case TimeDisplay::FlowDelta:
+                previous = entry.previous_step;
+                break;
+        }
+
+        if (previous == -1)
+        {
+            return QString("-").rightJustified(TIME_COLUMN_WIDTH - 1) + " ";
+        }
+
+        // display deltas of up to 100 s in ms, and longer ones in s
+        double delta = (entry.record.timestamp() - event_history.at(previous).record.timestamp())
+                       / 1e6;
+        return delta < 100000 ? QString("+%1ms ").arg(delta, 9, 'f', 3)
+                              : QString("+%1s  ").arg(qMin(delta / 1000, 99999.999), 9, 'f', 3);
+    }
+
+    /* \brief Returns the name of the given zBus server, e.g. "10.0.0.42:8180".
+     *
+     * \param <target> Index of the zBus server in connections (-1 == all).
+     */
+    QString target_name(int target)
+    {
+        return target == -1 ? "all" : connections.at(target)->name();
+    }
+
+    /* \brief Sends the given event to the given zBus server, or to every zBus server, and stores a
+     *        copy in the event_history list, timestamped as it is handed to the connections.
+     *
+     * \param <target> Index of the zBus server in connections (-1 == all).
+     * \param <event> The zBus event to record and send.
+     */
+    void send_event(int target, ZBusEvent event)
+    {
+        event.timestamp = scheduler->now();
+        // the event is serialized once, for its record, which its size is taken from
+        EventRecord record = record_event(Direction::Outbound, target, event);
+        stats.record(event.name(), record.size(), event.timestamp);
+
+        for (int i = 0; i < connections.size(); i++)
+        {
+            if (target == -1 || target == i)
+            {
+                connections.at(i)->send(event);
+            }
+        }
+    }
+
+    /* \brief Returns the text displayed for the given event, truncated with a "[+N chars]" marker
+     *        if it does not fit in the given number of characters. Only the characters displayed
+     *        are decoded from the event record.
+     *
+     * \param <entry> The event history entry to be displayed.
+     * \param <space> Number of characters available to display the event.
+     */
+    QString elide(const HistoryEntry &entry, int space)
+    {
+        QString label = this->label(entry);
+        int length = entry.record.length();
+        if (label.size() + length <= space)
+        {
+            return label + entry.record.text();
+        }
+
+        QString marker = QString(" [+%1 chars]").arg(length);
+        int shown = qBound(0, space - label.size() - marker.size(), length);
+        return label + entry.record.text(shown) + QString(" [+%1 chars]").arg(length - shown);
+    }
+
+    /* \brief Returns the full text displayed for the selected event. The event is formatted only
+     *        when the selection changes.
+     *
+     * \param <selection> The index of the selected event.
+     */
+    QString select(int selection)
+    {
+        const HistoryEntry &entry = event_history.at(selection);
+        if (selection != selection_text_index)
+        {
+            selection_text = entry.record.text();
+            selection_text_index = selection;
+        }
+
+        return label(entry) + selection_text;
+    }
+
     /* \brief Returns the index of the event in the event_history, nearest to the current top, that
      *        accomodates displaying the selected event on screen.
      *
@@ -498,45 +959,41 @@ public:
             return next_selection;
         }
 
-        // get width and height of history window
-        int rows = history.rows;
-        int columns = history.columns;
+        // find the first event, counting up from the next selection, that does not fit in the
+        // history window alongside the next selection; the event below it is the highest top that
+        // accomodates the next selection
+        qint64 last_row = history_index.rowsBefore(next_selection) + history.rows;
+        int first_hidden = history_index.indexAtRow(last_row);
 
-        // determine the distance, in rows, from the current top through the next selection
-        int distance = 0;
-        QQueue<int> event_heights;
-        for (int i = current_top; i >= next_selection; i--)
-        {
-            QPair<Direction, ZBusEvent> event = event_history.at(i);
-            QString prefix = direction_sign.value(event.first);
-            QString json = event.second.toJson();
-            int height = ((prefix.size() + json.size() - 1) / columns) + 1;
-            event_heights.enqueue(height);
-            distance += height;
-        }
+        // if the next selection is too large to fit in the history window by itself, it is
+        // displayed at the top, and truncated
+        return qBound(next_selection, first_hidden - 1, current_top);
+    }
 
-        // if there is enough space in the terminal window to display the current top and the next
-        // selection, return the current top as the next top
-        if (distance <= rows)
+    /* \brief Returns the index of the event in the event_history one page (the height of the
+     *        history window) newer or older than the given selection.
+     *
+     * \param <selection> The index of the selected event (-1 == no selection).
+     * \param <pages> Number of pages to move the selection by. Positive values select newer events,
+     *                negative values select older events.
+     */
+    int find_selection_by_page(int selection, int pages)
+    {
+        int latest_event = event_history.size() - 1;
+        if (selection == -1)
         {
-            return current_top;
+            selection = latest_event;
         }
 
-        // determine where the next top must be to accomodate the next selection
-        for (int i = current_top; i >= next_selection; i--)
-        {
-            if (distance <= rows)
-            {
-                return i;
-            }
+        qint64 row = history_index.rowsBefore(selection) + qint64(pages) * history.rows;
+        int next_selection = qBound(0, history_index.indexAtRow(row), latest_event);
 
-            distance -= event_heights.dequeue();
+        // always move at least one event, if there is an event to move to
+        if (pages > 0)
+        {
+            return qMin(qMax(next_selection, selection + 1), latest_event);
         }
-
-        // I think, if this is reached, the next selection is too large to fit on the terminal window
-        // TODO: address possibility of too-large events by always printing at least one event
-        //       (display class can handle this)
-        return next_selection;
+        return qMax(qMin(next_selection, selection - 1), 0);
     }
 
     /* \brief Updates the history window with the event at the given top index at the top, and the
@@ -550,9 +1007,8 @@ public:
         // clear event history
         wclear(history.window);
 
-        // get width and height of the terminal window
+        // get height of the terminal window
         int rows = history.rows;
-        int columns = history.columns;
 
         // write events until running out of events or screen space
         int row = 0;
@@ -560,12 +1016,10 @@ public:
         {
             // determine the height (due to line-wrapping) of the next event to be written;
             // if the event would extend past the end of the history.window,
-            // do not display that event or any subsequent events
-            QPair<Direction, ZBusEvent> event = event_history.at(i);
-            QString prefix = direction_sign.value(event.first);
-            QString json = event.second.toJson();
-            int height = ((prefix.size() + json.size() - 1) / columns) + 1;
-            if (row + height > rows)
+            // do not display that event or any subsequent events, unless it is the top event, which
+            // is always displayed (truncated, if it is too large to fit in the history.window)
+            int height = history_index.height(i);
+            if (row + height > rows && row > 0)
             {
                 break;
             }
@@ -573,21 +1027,226 @@ public:
             // move to next row, and write event to line
             wmove(history.window, row, 0);
 
-            // if the event has been selected, make it bold
+            // if the event has been selected, make it bold and display it in full; otherwise, elide
+            // it to its height
             if (i == selection)
             {
                 wattron(history.window, A_BOLD);
+                wprintw(history.window, (time_column(i) + select(i)).toUtf8());
+                wattroff(history.window, A_BOLD);
+            }
+            else
+            {
+                QString time = time_column(i);
+                QString text = time + elide(event_history.at(i),
+                                            height * history.columns - time.size());
+                wprintw(history.window, text.toUtf8());
             }
-            wprintw(history.window, prefix.toUtf8());
-            wprintw(history.window, json.toUtf8());
-            wattroff(history.window, A_BOLD);
 
             // set row for next event immediately after current event
             row = row + height;
+            if (row >= rows)
+            {
+                break;
+            }
         }
 
         // update screen
-        wrefresh(history.window);
+        refresh_window(history.window);
+    }
+
+    /* \brief Displays the traffic statistics for each event name in the history window, as a table
+     *        ordered from the busiest event name to the quietest, in as many rows as fit, followed
+     *        by the cost of each stage of the inbound pipeline.
+     */
+    void update_stats_window()
+    {
+        wclear(history.window);
+
+        int name_width = qMax(history.columns - 77, 16);
+        QVector<EventStats::Row> rows = stats.rows(scheduler->now());
+
+        // the statistics contain "%", so they are written with waddstr, rather than wprintw
+        wmove(history.window, 0, 0);
+        wattron(history.window, A_BOLD);
+        waddstr(history.window, QString("%1%2%3%4%5%6%7%8%9%10")
+                                    .arg("event", -name_width)
+                                    .arg("1s/s", 7).arg("10s/s", 7).arg("60s/s", 7)
+                                    .arg("share", 7).arg("avg B", 9).arg("max B", 9)
+                                    .arg("total", 11).arg("gap ms", 10).arg("jitter ms", 10)
+                                    .toUtf8());
+        wattroff(history.window, A_BOLD);
+
+        // leave room below the events for a header, a row per pipeline stage, the memory held by
+        // the event history, and the handshake times and gaps of the connections
+        QVector<EventPipeline::Row> stages = pipeline.rows();
+        int event_rows = history.rows - stages.size() - 5;
+
+        for (int row = 1; row < event_rows && row <= rows.size(); row++)
+        {
+            const EventStats::Row &stats = rows.at(row - 1);
+            wmove(history.window, row, 0);
+            waddstr(history.window, QString("%1%2%3%4%5%6%7%8%9%10")
+                                        .arg(stats.name.left(name_width - 1), -name_width)
+                                        .arg(stats.rate_1s, 7, 'f', 1)
+                                        .arg(stats.rate_10s, 7, 'f', 1)
+                                        .arg(stats.rate_60s, 7, 'f', 1)
+                                        .arg(QString::number(stats.share * 100, 'f', 1) + "%", 7)
+                                        .arg(stats.average_size, 9, 'f', 0)
+                                        .arg(stats.max_size, 9)
+                                        .arg(stats.count, 11)
+                                        .arg(stats.gap_ms, 10, 'f', 1)
+                                        .arg(stats.jitter_ms, 10, 'f', 2).toUtf8());
+        }
+
+        int top = qMax(qMin(rows.size(), event_rows - 1) + 2, 2);
+        wmove(history.window, top, 0);
+        wattron(history.window, A_BOLD);
+        waddstr(history.window, QString("%1%2%3%4%5").arg("stage", -name_width)
+                                    .arg("events", 11).arg("batches", 11)
+                                    .arg("avg us/event", 14).arg("max us/batch", 14).toUtf8());
+        wattroff(history.window, A_BOLD);
+
+        for (int row = top + 1; row < history.rows && row <= top + stages.size(); row++)
+        {
+            const EventPipeline::Row &stage = stages.at(row - top - 1);
+            wmove(history.window, row, 0);
+            waddstr(history.window, QString("%1%2%3%4%5")
+                                        .arg(stage.name.left(name_width - 1), -name_width)
+                                        .arg(stage.events, 11)
+                                        .arg(stage.batches, 11)
+                                        .arg(stage.average_us, 14, 'f', 2)
+                                        .arg(stage.max_batch_us, 14, 'f', 1).toUtf8());
+        }
+
+        int row = top + stages.size() + 1;
+        if (row < history.rows)
+        {
+            qint64 bytes = EventArena::bytes() + event_history.capacity() * sizeof(HistoryEntry);
+            wmove(history.window, row, 0);
+            waddstr(history.window, QString("history: %1 events in %2 KiB (%3 B/event)")
+                                        .arg(event_history.size())
+                                        .arg(bytes / 1024)
+                                        .arg(bytes / qMax(event_history.size(), 1)).toUtf8());
+        }
+
+        if (row + 1 < history.rows)
+        {
+            // a connection that offered a TLS session ticket skips the full TLS handshake, if the
+            // server accepts the ticket
+            QStringList handshakes;
+            foreach (ZConnection *connection, connections)
+            {
+                qint64 ns = connection->handshakeTime();
+                handshakes.append(QString("%1 %2%3").arg(connection->name())
+                                      .arg(ns < 0 ? "-" : QString::number(ns / 1e6, 'f', 1) + " ms")
+                                      .arg(connection->offeredSessionTicket() ? " (ticket)" : ""));
+            }
+            wmove(history.window, row + 1, 0);
+            waddstr(history.window, ("handshake: " + handshakes.join(", ")).toUtf8());
+        }
+
+        if (row + 2 < history.rows)
+        {
+            // the gap is how long events were missed for, the last time a connection was lost
+            QStringList gaps;
+            foreach (ZConnection *connection, connections)
+            {
+                qint64 ns = connection->gapTime();
+                QString gap = QString("%1 %2").arg(connection->name())
+                                  .arg(ns < 0 ? "-" : QString::number(ns / 1e6, 'f', 1) + " ms");
+                if (connection->hasStandby())
+                {
+                    gap += QString(" (%1 failovers, %2 duplicates)")
+                               .arg(connection->failoverCount())
+                               .arg(connection->duplicates());
+                }
+                gaps.append(gap);
+            }
+            wmove(history.window, row + 2, 0);
+            waddstr(history.window, ("gap: " + gaps.join(", ")).toUtf8());
+        }
+
+        refresh_window(history.window);
+    }
+
+    /* \brief Returns the collapsible tree of the data of the given event, creating it if the event
+     *        has not been selected recently. The tree keeps the nodes that have been expanded and
+     *        the lines that have been formatted, so navigating between events is cheap.
+     *
+     * \param <selection> The index of the selected event.
+     */
+    JsonTree *detail_tree(int selection)
+    {
+        JsonTree *tree = detail_trees.object(selection);
+        if (tree == nullptr)
+        {
+            tree = new JsonTree(event_history.at(selection).record.data());
+            detail_trees.insert(selection, tree);
+        }
+
+        return tree;
+    }
+
+    /* \brief Displays the data of the selected event in the detail pane, as a collapsible tree.
+     *        Only the lines of the tree that fit in the detail pane are formatted.
+     *
+     * \param <selection> The index of the selected event (-1 == no selection).
+     */
+    void update_detail_window(int selection)
+    {
+        wclear(detail.window);
+
+        // separate the detail pane from the history window
+        wmove(detail.window, 0, 0);
+        whline(detail.window, ACS_HLINE, detail.columns);
+
+        if (selection == -1)
+        {
+            wmove(detail.window, 1, 0);
+            wprintw(detail.window, "The data of the selected event will appear here.");
+            refresh_window(detail.window);
+            return;
+        }
+
+        // write the lines of the tree until running out of lines or screen space, highlighting
+        // the line with the cursor
+        JsonTree *tree = detail_tree(selection);
+        int rows = detail.rows - 1;
+        int top = tree->scrollTo(rows);
+        for (int row = 0; row < rows && top + row < tree->lineCount(); row++)
+        {
+            wmove(detail.window, row + 1, 0);
+            if (top + row == tree->cursor())
+            {
+                wattron(detail.window, A_REVERSE);
+            }
+            wprintw(detail.window, tree->line(top + row).left(detail.columns - 1).toUtf8());
+            wattroff(detail.window, A_REVERSE);
+        }
+
+        refresh_window(detail.window);
+    }
+
+    /* \brief Fits each window to the new width of the terminal, after the terminal is resized. The
+     *        history height index is emptied if the width of the history window changed, and must
+     *        be rebuilt.
+     */
+    void resize_screen()
+    {
+        getmaxyx(screen.window, screen.rows, screen.columns);
+        wclear(screen.window);
+        refresh_window(screen.window);
+
+        META_WINDOW *windows[] = { &help, &status, &mock_menu, &entry, &history, &detail };
+        for (META_WINDOW *window : windows)
+        {
+            window->columns = screen.columns;
+            window->x = 0;
+            window->regenerate();
+        }
+
+        history_index.setColumns(history.columns);
     }
 
     /* \brief Adjusts the height of the event history window, depending on the given mode.
@@ -605,19 +1264,36 @@ public:
                 history.rows = screen.rows - (entry.y + entry.rows);
                 break;
             case Mode::Peruse:
+                // the detail pane occupies the bottom half of the space below the status window
+                detail.rows = qMax((screen.rows - (status.y + status.rows)) / 2, 1);
+                detail.y = screen.rows - detail.rows;
+                detail.regenerate();
+                history.rows = detail.y - (status.y + status.rows);
+                break;
+            case Mode::Stats:
                 history.rows = screen.rows - (status.y + status.rows);
                 break;
         }
 
-        history.y = screen.rows - history.rows;
+        history.y = (mode == Mode::Peruse ? detail.y : screen.rows) - history.rows;
 
         history.regenerate();
-        wrefresh(history.window);
+        refresh_window(history.window);
     }
 };
 
-/* \brief Constructs an instance of ZBusCli, setting up the retry logic and the connections between
- *        the zBus client and the ncurses event loop.
+/* \brief Constructs an instance of ZBusCli, setting up the connection between the ncurses event
+ *        loop and the sending of events, and the stages of the inbound pipeline:
+ *
+ *        metrics - counts every event in the traffic statistics.
+ *        ids - captures the `requestId` and `authAttemptId` expected from mock pinpad events.
+ *        simulator - if the pinpad simulator is enabled, responds to the zBus server the event was
+ *                    received from.
+ *        rate limit - drops events whose name (or domain) is over the rate limit; they are
+ *                     counted and summarized in the status window instead.
+ *        history - stores the event in the event_history list, and displays it.
+ *
+ *        Stages added with `add_stage` run before the rate limit, so they see every event.
  *
  * \param <parent> The parent of the object instantiated.
  */
@@ -625,12 +1301,61 @@ ZBusCli::ZBusCli(QObject *parent) : QObject(parent)
 {
     p = new ZBusCliPrivate();
 
-    connect(&p->client, &ZWebSocket::disconnected,
-            this, &ZBusCli::retry_connection);
     connect(this, &ZBusCli::event_submitted,
             this, &ZBusCli::handle_outbound_event);
-    connect(&p->client, &ZWebSocket::zBusEventReceived,
-            this, &ZBusCli::handle_inbound_event);
+
+    // every stage works from the envelope of the event; its data is only parsed when it is
+    // displayed in detail
+    p->pipeline.append("metrics", new EventSink([this] (InboundEvent &inbound)
+    {
+        p->stats.record(inbound.name(), inbound.text.size(), inbound.timestamp);
+    }));
+
+    p->pipeline.append("ids", new EventSink([this] (InboundEvent &inbound)
+    {
+        const QString request_id = inbound.requestId();
+        p->current_request_id = request_id.isEmpty() ? p->current_request_id : request_id;
+
+        const QString auth_attempt_id = inbound.authAttemptId();
+        p->current_auth_attempt_id = auth_attempt_id.isEmpty() ? p->current_auth_attempt_id
+                                                               : auth_attempt_id;
+    }));
+
+    p->pipeline.append("simulator", new EventSink([this] (InboundEvent &inbound)
+    {
+        if (!p->pinpad_simulated)
+        {
+            return;
+        }
+
+        p->simulator.handle(inbound.name(), inbound.source);
+    }));
+
+    // the responses are filled in with the ids received last, when they are sent
+    connect(&p->simulator, &PinpadSimulator::responded,
+            this, [this] (int source, Mock response)
+            {
+                p->send_event(source,
+                              { response, p->current_request_id, p->current_auth_attempt_id });
+            });
+
+    p->pipeline.append("rate limit", new EventFilter([this] (const InboundEvent &inbound)
+    {
+        const QString key = p->limit_by_domain ? inbound.domain() : inbound.name();
+        return p->display_limiter.allow(key, p->scheduler->now() / 1000000);
+    }));
+
+    p->pipeline.append("history", new EventSink([this] (InboundEvent &inbound)
+    {
+        if (p->oldest_merged == 0)
+        {
+            p->oldest_merged = inbound.timestamp;
+        }
+
+        p->record_event(Direction::Inbound, inbound.source,
+                        EventRecord::envelopeJson(inbound.text, inbound.envelope), inbound.name(),
+                        inbound.requestId(), inbound.timestamp);
+    }));
 }
 
 /* \brief Cleans up the PIMPL object.
@@ -640,84 +1365,247 @@ ZBusCli::~ZBusCli()
     delete p;
 }
 
-/* \brief Connects the zBus client to the zBus server at the given URL, and starts the ncurses event
- *        loop.
+/* \brief Connects to the zBus servers at the given URLs, each on its own I/O thread, and starts the
+ *        ncurses event loop. Each connection is retried whenever it is lost.
  *
- * \param <zBusUrl> URL to zBus.
+ * \param <zBusUrls> URLs to zBus.
  */
-void ZBusCli::exec(const QUrl &zBusUrl)
+void ZBusCli::exec(const QList<QUrl> &zBusUrls)
 {
-    // connect client to zBus server
-    p->client.open(zBusUrl);
+    // connect a client to each zBus server
+    foreach (const QUrl &zBusUrl, zBusUrls)
+    {
+        int source = p->connections.size();
+        ZConnection *connection = new ZConnection(zBusUrl, p->shm_ring, p->tls_options,
+                                                  p->standby);
+        connection->setScheduler(p->scheduler);
+        connect(connection, &ZConnection::eventsReceived,
+                this, [this, source] (const QVector<ReceivedEvent> &events)
+                {
+                    receive_events(source, events);
+                });
+        p->connections.append(connection);
+        connection->open();
+    }
+    p->merge_queues.resize(p->connections.size());
 
     // wait for input and update display
     handle_input(Context{});
 }
 
-/* \brief Attempts to connect to zBus after a delay. This is connected to ZWebSocket's disconnected
- *        signal to enable retries.
+/* \brief Caps the number of rows an event occupies in the history window while it is not selected.
+ *        Larger events are elided, and displayed in full when selected in peruse mode.
+ *
+ * \param <rows> Maximum number of rows (0 == no maximum).
  */
-void ZBusCli::retry_connection()
+void ZBusCli::set_max_event_rows(int rows)
 {
-    QUrl zBusUrl = p->client.requestUrl();
-    QTimer::singleShot(RETRY_DELAY_MS, [this, zBusUrl] {p->client.open(zBusUrl);});
+    bool rebuilding = p->history_index.isRebuilding();
+    p->history_index.setMaxHeight(rows);
+    if (!rebuilding)
+    {
+        rebuild_history_index();
+    }
 }
 
-/* \brief Sends the given event to zBus, and stores a copy in the event_history list.
+/* \brief Limits the number of inbound events with the same name (or domain) that are stored and
+ *        displayed per second. Events over the limit are still processed (e.g. by the pinpad
+ *        simulator), but are only counted, and summarized in the status window.
+ *
+ * \param <rate> Number of events stored per second, per name or domain (0 == no limit).
+ * \param <by_domain> Limits events by domain, rather than by name.
+ */
+void ZBusCli::set_rate_limit(double rate, bool by_domain)
+{
+    p->display_limiter.setRate(rate, 0);
+    p->limit_by_domain = by_domain;
+}
+
+/* \brief Publishes the text of every event received from zBus to the given shared-memory ring, for
+ *        other local processes to consume. Must be called before `exec`.
+ *
+ * \param <ring> Ring to publish to, which must outlive the ZBusCli.
+ */
+void ZBusCli::set_shm_ring(ShmRing *ring)
+{
+    p->shm_ring = ring;
+}
+
+/* \brief Sets the CAs and public key pins that the servers of wss:// URLs are verified against.
+ *        Must be called before `exec`.
+ *
+ * \param <options> CAs and pins to trust.
+ */
+void ZBusCli::set_tls_options(const TlsOptions &options)
+{
+    p->tls_options = options;
+}
+
+/* \brief Keeps a standby websocket connected to each zBus server alongside the primary one, which
+ *        takes over at once when the primary is lost, so no events are missed while it reconnects.
+ *        Must be called before `exec`.
+ *
+ * \param <standby> Whether to keep a standby websocket.
+ */
+void ZBusCli::set_standby(bool standby)
+{
+    p->standby = standby;
+}
+
+/* \brief Sets the scheduler that every timed behavior runs on: timestamps, the pinpad simulator,
+ *        and retrying connections, e.g. a VirtualClock in tests. Must be called before `exec`.
+ *
+ * \param <scheduler> Scheduler, which must outlive the ZBusCli.
+ */
+void ZBusCli::set_scheduler(Scheduler *scheduler)
+{
+    p->scheduler = scheduler;
+    p->simulator.setScheduler(scheduler);
+}
+
+/* \brief Logs every frame the UI draws to the given file, one line per frame: what it was drawn
+ *        for (`input`, `resize`, `events`, or `timer`), the time from that to the frame being
+ *        refreshed to the terminal, in ns, and the number of windows refreshed. Latencies of
+ *        `events` frames are from the oldest event drawn being received.
+ *
+ * \param <path> Path of the file, which is truncated.
+ *
+ * \returns Whether the file was opened; if not, `frame_log_error` describes why.
+ */
+bool ZBusCli::set_frame_log(const QString &path)
+{
+    p->frame_log.close();
+    p->frame_log.setFileName(path);
+    return p->frame_log.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+/* \brief Returns a description of why the frame log could not be opened.
+ */
+QString ZBusCli::frame_log_error() const
+{
+    return p->frame_log.errorString();
+}
+
+/* \brief Adds a stage to the inbound pipeline, before the rate limit and the event history, so it
+ *        sees every event received from zBus, e.g. a sink that records events, or a filter that
+ *        hides noisy events from the history.
+ *
+ * \param <name> Name of the stage, as displayed in stats mode.
+ * \param <stage> Stage to be added, which ZBusCli takes ownership of.
+ */
+void ZBusCli::add_stage(const QString &name, EventStage *stage)
+{
+    p->pipeline.insert(p->pipeline.size() - 2, name, stage);
+}
+
+/* \brief Adds a bounded number of events to the history height index, and schedules itself to run
+ *        again until every event is in the index. This spreads the cost of rebuilding the index
+ *        after the terminal is resized over several iterations of the event loop.
+ */
+void ZBusCli::rebuild_history_index()
+{
+    if (!p->history_index.rebuild(HISTORY_INDEX_REBUILD_BUDGET))
+    {
+        QTimer::singleShot(0, this, &ZBusCli::rebuild_history_index);
+    }
+}
+
+/* \brief Sends the given event to the current send target, and stores a copy in the
+ *        event_history list.
  *
  *        This is connected to the event_submitted signal that is emitted from the ncurses event
  *        loop to enable sending events from the text-based UI.
  *
  * \param <event> The zBus event to record and send.
- *
- * \returns Number of bytes sent.
  */
-qint64 ZBusCli::handle_outbound_event(const ZBusEvent &event)
+void ZBusCli::handle_outbound_event(const ZBusEvent &event)
 {
-    p->event_history.append({ Direction::Outbound, event });
-    return p->client.sendZBusEvent(event);
+    p->send_event(p->target, event);
 }
 
-/* \brief Stores the given event in the event_history list, and captures the event's `requestId` and
- *        `authAttemptId`.
+/* \brief Hands a batch of events received from one zBus server to the inbound pipeline. With a
+ *        single zBus server, the batch is processed immediately; with several, the events are
+ *        queued to be merged with the events of the other servers by `merge_inbound_events`, which
+ *        is scheduled to run once the oldest of them is MERGE_DELAY_MS old.
  *
- *        This is connected to ZWebSocket's zBusEventReceived signal in order to save all received
- *        events, and keep track of the current requestId and authAttemptId expected from mock
- *        pinpad events.
- *
- * \param <event> Event received from zBus.
+ * \param <source> Index of the zBus server the events were received from.
+ * \param <events> Events received from the zBus server, in the order they were received.
  */
-void ZBusCli::handle_inbound_event(const ZBusEvent &event)
+void ZBusCli::receive_events(int source, const QVector<ReceivedEvent> &events)
 {
-    p->event_history.append({Direction::Inbound, event});
+    if (p->connections.size() == 1)
+    {
+        QVector<InboundEvent> &batch = p->merge_batch;
+        for (const ReceivedEvent &received : events)
+        {
+            batch.append({ source, received.text, received.envelope, received.timestamp });
+        }
+        p->pipeline.process(batch);
+        batch.clear();
+        return;
+    }
 
-    // if the received event contains a requestId,
-    // update the stored requestId for mock events
-    p->current_request_id = event.requestId.isEmpty() ? p->current_request_id
-                                                      : event.requestId;
+    QQueue<InboundEvent> &queue = p->merge_queues[source];
+    for (const ReceivedEvent &received : events)
+    {
+        queue.enqueue({ source, received.text, received.envelope, received.timestamp });
+    }
 
-    // if the received event contains an authAttemptId,
-    // update the stored authAttemptId for mock events
-    const QString auth_attempt_id = event.data.toObject().value("authAttemptId").toString();
-    p->current_auth_attempt_id = auth_attempt_id.isEmpty() ? p->current_auth_attempt_id
-                                                           : auth_attempt_id;
+    if (!p->merge_scheduled && !queue.isEmpty())
+    {
+        p->merge_scheduled = true;
+        p->scheduler->schedule(MERGE_DELAY_MS, this, [this] { merge_inbound_events(); });
+    }
+}
 
-    // if the pinpad simulator is enabled, attempt to respond to the event
-    if (p->pinpad_simulated)
+/* \brief Hands the queued inbound events that were received at least MERGE_DELAY_MS ago to the
+ *        inbound pipeline, as one batch, in the order they were received, regardless of which zBus
+ *        server they were received from. An event delayed by more than MERGE_DELAY_MS is handled
+ *        when it arrives, slightly out of order, rather than being inserted into the middle of the
+ *        event history. If events remain queued, the merge is scheduled again for when the oldest
+ *        of them is ready.
+ */
+void ZBusCli::merge_inbound_events()
+{
+    p->merge_scheduled = false;
+
+    // the queue of each server is in order already, so the queues are merged by repeatedly taking
+    // the oldest of their heads; there are only a few servers, so the heads are simply scanned
+    qint64 cutoff = p->scheduler->now() - qint64(MERGE_DELAY_MS) * 1000000;
+    qint64 oldest = MERGE_QUEUE_EMPTY;
+    QVector<InboundEvent> &batch = p->merge_batch;
+    forever
     {
-        QVector<Mock> responses = pinpad_simulator_responses.value(event.name());
-        foreach (Mock response, responses)
+        int next = -1;
+        oldest = MERGE_QUEUE_EMPTY;
+        for (int source = 0; source < p->merge_queues.size(); source++)
         {
-            // POS needs about 5 seconds before it is able to receive responses to
-            // pinpad.preparePaymentRequest
-            int timeout = (response == Mock::PinpadCardInserted
-                        || response == Mock::PinpadCardInfo) ? 5000 : 100;
-            QTimer::singleShot(
-                    timeout,
-                    [this, response] { handle_outbound_event({ response,
-                                                               p->current_request_id,
-                                                               p->current_auth_attempt_id });});
+            const QQueue<InboundEvent> &queue = p->merge_queues.at(source);
+            if (!queue.isEmpty() && queue.head().timestamp < oldest)
+            {
+                next = source;
+                oldest = queue.head().timestamp;
+            }
+        }
+
+        if (next == -1 || oldest > cutoff)
+        {
+            break;
         }
+        batch.append(p->merge_queues[next].dequeue());
+    }
+
+    if (!batch.isEmpty())
+    {
+        p->pipeline.process(batch);
+        batch.clear();
+    }
+
+    if (oldest != MERGE_QUEUE_EMPTY)
+    {
+        int delay = int((oldest - cutoff + 999999) / 1000000);
+        p->merge_scheduled = true;
+        p->scheduler->schedule(delay, this, [this] { merge_inbound_events(); });
     }
 }
 
@@ -730,6 +1618,24 @@ void ZBusCli::handle_input(Context current)
 {
     // capture input
     int input = wgetch(p->entry.window);
+    qint64 frame_start = p->scheduler->now();
+    int refreshes = p->refreshes;
+
+    // if the terminal has been resized, fit the windows to the terminal, and begin rebuilding the
+    // history height index if it is not already being rebuilt
+    bool resized = false;
+    if (input == KEY_RESIZE)
+    {
+        bool rebuilding = p->history_index.isRebuilding();
+        p->resize_screen();
+        if (!rebuilding)
+        {
+            rebuild_history_index();
+        }
+
+        resized = true;
+        input = ERR;
+    }
 
     // process input with current context, and update context for next input
     Context next;
@@ -746,27 +1652,52 @@ void ZBusCli::handle_input(Context current)
         case Mode::Peruse:
             next = handle_peruse_input(input, current);
             break;
+
+        case Mode::Stats:
+            next = handle_stats_input(input, current);
+            break;
     }
 
     // tracks if there have been any window changes that need to be propogated to lower windows
     bool changes_above = false;
 
-    // if the mode has changed, update the help text
-    if (current.mode != next.mode)
+    // if the mode has changed or the terminal has been resized, update the help text
+    if (current.mode != next.mode || resized)
     {
         p->update_help_text(next.mode);
         changes_above = true;
     }
 
-    // if anything above has changed, the connection status has changed, or the pinpad simulated has
-    // been toggled, update the status
+    // if anything above has changed, the connection status has changed, the pinpad simulated has
+    // been toggled, the send target has changed, or more events have been suppressed, update the
+    // status; windows below only need to be updated if the height of the status changed
+    int connected = 0;
+    QStringList errors;
+    foreach (ZConnection *connection, p->connections)
+    {
+        connected += connection->isConnected();
+        if (!connection->isConnected())
+        {
+            errors.append(p->connections.size() == 1
+                              ? connection->errorString()
+                              : connection->name() + ": " + connection->errorString());
+        }
+    }
+
     if (changes_above ||
-        current.connected != p->client.isValid() ||
-        current.pinpad_simulated != next.pinpad_simulated)
+        current.connected != connected ||
+        current.pinpad_simulated != next.pinpad_simulated ||
+        current.target != next.target ||
+        current.suppressed != p->display_limiter.suppressed())
     {
-        next.connected = p->client.isValid();
-        p->update_status(next.pinpad_simulated, next.connected, p->client.errorString());
-        changes_above = true;
+        next.connected = connected;
+        next.suppressed = p->display_limiter.suppressed();
+        changes_above = p->update_status(next.pinpad_simulated,
+                                         next.connected,
+                                         errors.join(", "),
+                                         p->connections.size() > 1 ? p->target_name(next.target)
+                                                                   : QString(),
+                                         p->display_limiter.summary()) || changes_above;
     }
 
     // if anything above has changed or the menu selection has changed, update the menu
@@ -789,15 +1720,32 @@ void ZBusCli::handle_input(Context current)
         p->resize_history_window(next.mode);
     }
 
-    // if the event selection has changed, any new events have been received, or the mode has
-    // changed, update the event history
-    next.size = p->event_history.size();
-    if (next.selection != current.selection ||
-        next.size > current.size ||
-        current.mode != next.mode)
+    // if in stats mode, update the statistics once per second, or immediately if the mode has
+    // changed; otherwise, if the event selection has changed, any events have been sent or
+    // received, or the mode has changed, update the event history
+    next.revision = p->revision;
+    next.stats_second = p->scheduler->now() / 1000000000;
+    if (next.mode == Mode::Stats)
     {
+        if (next.stats_second != current.stats_second || current.mode != next.mode || resized)
+        {
+            p->update_stats_window();
+        }
+    }
+    else if (next.selection != current.selection ||
+             next.revision != current.revision ||
+             next.time_display != current.time_display ||
+             current.mode != next.mode ||
+             resized)
+    {
+        p->history_index.setExpanded(next.selection);
         next.top = p->find_top_for_selection(current.top, next.selection);
         p->update_history_window(next.top, next.selection);
+
+        if (next.mode == Mode::Peruse)
+        {
+            p->update_detail_window(next.selection);
+        }
     }
 
     // if entry fields are visible, return cursor to last position in current field
@@ -807,6 +1755,29 @@ void ZBusCli::handle_input(Context current)
         pos_form_cursor(p->entry_form);
     }
 
+    // if anything was drawn, log how long it took from the input, resize, or arrival of the events
+    // that it was drawn for
+    if (p->refreshes != refreshes)
+    {
+        const char *trigger = "timer";
+        if (resized)
+        {
+            trigger = "resize";
+        }
+        else if (input != ERR)
+        {
+            trigger = "input";
+        }
+        else if (next.revision != current.revision && p->oldest_merged != 0)
+        {
+            trigger = "events";
+            frame_start = p->oldest_merged;
+        }
+
+        p->log_frame(trigger, p->scheduler->now() - frame_start, p->refreshes - refreshes);
+        p->oldest_merged = 0;
+    }
+
     // process next input with new context
     QTimer::singleShot(0, this, [this, next] { handle_input(next); });
 }
@@ -828,7 +1799,12 @@ Context ZBusCli::handle_command_input(int input, Context context)
             input = wgetch(p->entry.window);
             if (input == '[')
             {
-                wgetch(p->entry.window);
+                // ignore anything pasted into the terminal along with it
+                QByteArray paste;
+                if (wgetch(p->entry.window) == '2')
+                {
+                    p->read_paste(paste);
+                }
                 return context;
             }
 
@@ -900,6 +1876,22 @@ Context ZBusCli::handle_command_input(int input, Context context)
             context.menu = Menu::Main;
             return context;
 
+        // On "t", switch to stats mode and reset the mock menu window
+        case 't':
+            context.mode = Mode::Stats;
+            context.menu = Menu::Main;
+            return context;
+
+        // On "c", send events to the next zBus server, or to every zBus server after the last one
+        case 'c':
+            if (p->connections.size() > 1)
+            {
+                context.target = context.target + 1 < p->connections.size() ? context.target + 1
+                                                                             : -1;
+                p->target = context.target;
+            }
+            return context;
+
         // On "q", quit the application
         case 'q':
             emit quit();
@@ -962,9 +1954,19 @@ Context ZBusCli::handle_send_input(int input, Context context)
             }
 
             // it's an "Escape Sequence"; on Arrow Key, move cursor (arrow keys are received in the
-            // form "Esc + [ + A")
+            // form "Esc + [ + A"), and on a bracketed paste, insert the pasted text all at once
             switch (wgetch(p->entry.window))
             {
+                // Paste
+                case '2':
+                    {
+                        QByteArray paste;
+                        if (p->read_paste(paste))
+                        {
+                            p->insert_paste(paste);
+                        }
+                    }
+                    break;
                 // Up
                 case 'A': 
                     form_driver(p->entry_form, REQ_UP_CHAR);
@@ -1001,6 +2003,8 @@ Context ZBusCli::handle_send_input(int input, Context context)
  */
 Context ZBusCli::handle_peruse_input(int input, Context context)
 {
+    int latest_event = p->event_history.size() - 1;
+
     switch(input)
     {
         // on Escape, determine whether or not this is the beginning of an "Escape Sequence"
@@ -1013,9 +2017,28 @@ Context ZBusCli::handle_peruse_input(int input, Context context)
             {
                 context.mode = Mode::Command;
                 context.selection = -1;
+                context.jump = -1;
                 return handle_command_input(input, context);
             }
 
+            // it's an "Escape Sequence"; ignore anything pasted into the terminal
+            input = wgetch(p->entry.window);
+            if (input == '2')
+            {
+                QByteArray paste;
+                p->read_paste(paste);
+                return context;
+            }
+
+            // Home, End, Page Up, and Page Down may be received in the form "Esc + [ + 5 + ~", so
+            // map them to a single character after consuming the "~"
+            if (input >= '1' && input <= '8')
+            {
+                wgetch(p->entry.window);
+                input = (input == '1' || input == '7') ? 'H'
+                      : (input == '4' || input == '8') ? 'F'
+                      : input;
+            }
 
             // if the event history is empty, ignore selections
             if (p->event_history.empty())
@@ -1023,10 +2046,9 @@ Context ZBusCli::handle_peruse_input(int input, Context context)
                 return context;
             }
 
-            // it's an "Escape Sequence"; on Arrow Key, select another event (arrow keys are
+            // on Arrow Key, Home, End, Page Up, or Page Down, select another event (arrow keys are
             // received in the form "Esc + [ + A")
-            int latest_event = p->event_history.size() - 1;
-            switch (wgetch(p->entry.window))
+            switch (input)
             {
                 // Up
                 case 'A':
@@ -1040,7 +2062,149 @@ Context ZBusCli::handle_peruse_input(int input, Context context)
                     // wrap around to latest event if first event is selected
                     context.selection = context.selection > 0 ? context.selection - 1 : latest_event;
                     return context;
+                // Home
+                case 'H':
+                    context.selection = latest_event;
+                    return context;
+                // End
+                case 'F':
+                    context.selection = 0;
+                    return context;
+                // Page Up
+                case '5':
+                    context.selection = p->find_selection_by_page(context.selection, 1);
+                    return context;
+                // Page Down
+                case '6':
+                    context.selection = p->find_selection_by_page(context.selection, -1);
+                    return context;
+                // Right
+                case 'C':
+                    if (context.selection != -1)
+                    {
+                        JsonTree *tree = p->detail_tree(context.selection);
+                        tree->expand(tree->cursor());
+                        p->update_detail_window(context.selection);
+                    }
+                    return context;
+                // Left
+                case 'D':
+                    if (context.selection != -1)
+                    {
+                        JsonTree *tree = p->detail_tree(context.selection);
+                        tree->collapse(tree->cursor());
+                        p->update_detail_window(context.selection);
+                    }
+                    return context;
             }
+            break;
+
+        // on "j" or "k", move the cursor in the detail pane down or up
+        case 'j':
+        case 'k':
+            if (context.selection != -1)
+            {
+                p->detail_tree(context.selection)->moveCursor(input == 'j' ? 1 : -1);
+                p->update_detail_window(context.selection);
+            }
+            return context;
+
+        // on Enter, expand or collapse the data under the cursor in the detail pane
+        case '\r':
+        case '\n':
+        case KEY_ENTER:
+            if (context.selection != -1)
+            {
+                JsonTree *tree = p->detail_tree(context.selection);
+                tree->toggle(tree->cursor());
+                p->update_detail_window(context.selection);
+            }
+            return context;
+
+        // on any digit, add the digit to the index of the event to jump to
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            context.jump = qMin(qMax(context.jump, 0) * 10 + (input - '0'), latest_event);
+            return context;
+
+        // on "g", select the event at the entered index
+        case 'g':
+            if (context.jump != -1 && latest_event != -1)
+            {
+                context.selection = qBound(0, context.jump, latest_event);
+            }
+            context.jump = -1;
+            return context;
+
+        // on "d", cycle the time column between off, the absolute time of each event, the time
+        // since the previous event, and the time since the previous step of the same flow
+        case 'd':
+            {
+                context.time_display = context.time_display == TimeDisplay::None
+                                           ? TimeDisplay::Absolute
+                                     : context.time_display == TimeDisplay::Absolute
+                                           ? TimeDisplay::Delta
+                                     : context.time_display == TimeDisplay::Delta
+                                           ? TimeDisplay::FlowDelta
+                                           : TimeDisplay::None;
+                p->time_display = context.time_display;
+
+                // the time column widens every event, so the height index must be rebuilt
+                bool rebuilding = p->history_index.isRebuilding();
+                p->history_index.setPadding(context.time_display == TimeDisplay::None
+                                                ? 0 : TIME_COLUMN_WIDTH);
+                if (!rebuilding)
+                {
+                    rebuild_history_index();
+                }
+            }
+            return context;
+    }
+
+    // on any other input, do nothing
+    return context;
+}
+
+/* \brief Handles input received while the client is in Stats mode.
+ *
+ * \param <input> Character code of keypress from keyboard.
+ * \param <context> The context at the time of input.
+ *
+ * \returns The context that subsequent input should be processed with.
+ */
+Context ZBusCli::handle_stats_input(int input, Context context)
+{
+    switch(input)
+    {
+        // on Escape, determine whether or not this is the beginning of an "Escape Sequence"
+        case '\033':
+            input = wgetch(p->entry.window);
+
+            // it's not an "Escape Sequence"; on Escape, switch to Command Mode and process
+            // subsequent input
+            if (input != '[')
+            {
+                context.mode = Mode::Command;
+                return handle_command_input(input, context);
+            }
+
+            // it's an "Escape Sequence"; ignore it, along with anything pasted into the terminal
+            {
+                QByteArray paste;
+                if (wgetch(p->entry.window) == '2')
+                {
+                    p->read_paste(paste);
+                }
+            }
+            return context;
     }
 
     // on any other input, do nothing
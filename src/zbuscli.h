@@ -1,11 +1,20 @@
 #ifndef ZBUS_CLI_H
 #define ZBUS_CLI_H
 
+#include <QList>
 #include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QVector>
 
 class Context;
+class EventStage;
+class Scheduler;
+class ShmRing;
 class ZBusCliPrivate;
 class ZBusEvent;
+struct ReceivedEvent;
+struct TlsOptions;
 
 /* The Menu determines what options are displayed to the user, and what the client does with
  * (menu-related) input received from the user. A valid input will result in either a new menu being
@@ -21,8 +30,10 @@ enum class Menu { None, Main, Pinpad, Printer, Scanner, PinpadCard, PinpadPaymen
  * Send - Takes input for the purpose of navigating and editing the event type and data fields, and
  *        sending the constructed events.
  * Peruse - Takes input for the purpose of navigating the event history.
+ * Stats - Displays the rate, size, and timing jitter of the events sent to, and received from,
+ *         zBus for each event name, like `top`.
  */
-enum class Mode { Command, Send, Peruse };
+enum class Mode { Command, Send, Peruse, Stats };
 
 /* Bridge between the ZWebSocket sending and receiving events, and the ncurses event loop displaying
  * the events and accepting input from the user.
@@ -36,22 +47,34 @@ public:
     ZBusCli(QObject *parent = nullptr);
     ~ZBusCli();
 
-    void exec(const QUrl &zBusUrl);
+    void exec(const QList<QUrl> &zBusUrls);
+    void set_max_event_rows(int rows);
+    void set_rate_limit(double rate, bool by_domain);
+    void set_shm_ring(ShmRing *ring);
+    void set_tls_options(const TlsOptions &options);
+    void set_standby(bool standby);
+    void set_scheduler(Scheduler *scheduler);
+    bool set_frame_log(const QString &path);
+    QString frame_log_error() const;
+    void add_stage(const QString &name, EventStage *stage);
     void handle_input(Context current);
     Context handle_command_input(int input, Context context);
     Context handle_peruse_input(int input, Context context);
     Context handle_send_input(int input, Context context);
+    Context handle_stats_input(int input, Context context);
 
 signals:
     void event_submitted(const ZBusEvent &event);
     void quit();
 
 private slots:
-    void retry_connection();
-    qint64 handle_outbound_event(const ZBusEvent &event);
-    void handle_inbound_event(const ZBusEvent &event);
+    void rebuild_history_index();
+    void handle_outbound_event(const ZBusEvent &event);
 
 private:
+    void receive_events(int source, const QVector<ReceivedEvent> &events);
+    void merge_inbound_events();
+
     ZBusCliPrivate *p;
 };
 
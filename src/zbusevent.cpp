@@ -1,5 +1,6 @@
 #include "zbusevent.h"
 
+#include "eventtemplate.h"
 #include "mockdata.h"
 
 #include <QJsonArray>
@@ -62,6 +63,42 @@ static const QMap<Mock, ZBusEvent> mockEvent
     { Mock::ScannerReadPCI, { "scanner.read", MOCK_PCI } }
 };
 
+/* \brief Fills in the placeholders in the data of a mock event. The data of each mock is compiled
+ *        into a template the first time the mock is used, and the template is reused afterwards.
+ *
+ * \param <name> Mock event type.
+ *
+ * \returns Data of the mock event, with its placeholders filled in.
+ */
+static QJsonValue expandMockData(Mock name)
+{
+    static QMap<Mock, EventTemplate> templates;
+
+    QJsonValue data = mockEvent[name].data;
+    if (!data.isObject() && !data.isString())
+    {
+        return data;
+    }
+
+    QMap<Mock, EventTemplate>::iterator compiled = templates.find(name);
+    if (compiled == templates.end())
+    {
+        QString text = data.isObject()
+            ? QString::fromUtf8(QJsonDocument(data.toObject()).toJson(QJsonDocument::Compact))
+            : data.toString();
+        compiled = templates.insert(name, EventTemplate(text));
+    }
+
+    if (compiled->isStatic())
+    {
+        return data;
+    }
+
+    const QByteArray &expanded = compiled->expand();
+    return data.isObject() ? QJsonValue(QJsonDocument::fromJson(expanded).object())
+                           : QJsonValue(QString::fromUtf8(expanded));
+}
+
 /* \brief Constructs a ZBusEvent from a json object. If a field can not be extracted from
  *        the given object for any reason (e.g. invalid json, missing field), it will be left blank.
  *
@@ -120,7 +157,7 @@ ZBusEvent::ZBusEvent(enum Mock name,
 {
     this->domain = mockEvent[name].domain;
     this->type = mockEvent[name].type;
-    this->data = mockEvent[name].data;
+    this->data = expandMockData(name);
     this->requestId = requestId;
 
     if (this->data.isObject())
@@ -136,6 +173,17 @@ ZBusEvent::ZBusEvent(enum Mock name,
  * \returns JSON-formatted string generated from the ZBusEvent.
  */
 QString ZBusEvent::toJson() const
+{
+    return QString::fromUtf8(toUtf8Json());
+}
+
+/* \brief Creates compact JSON text from the ZBusEvent, in UTF-8, e.g. to be stored or sent without
+ *        converting it to a QString first. The keys are in alphabetical order: data, event,
+ *        requestId.
+ *
+ * \returns JSON-formatted UTF-8 text generated from the ZBusEvent.
+ */
+QByteArray ZBusEvent::toUtf8Json() const
 {
     QJsonObject json{{"event", name()},
                      {"data", data},
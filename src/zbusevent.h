@@ -1,8 +1,10 @@
 #ifndef ZBUS_EVENT_H
 #define ZBUS_EVENT_H
 
+#include <QByteArray>
 #include <QJsonValue>
 #include <QJsonObject>
+#include <QMetaType>
 #include <QString>
 
 struct DomainAndType;
@@ -64,6 +66,7 @@ public:
               const QString &authAttemptId = QString());
 
     QString toJson() const;
+    QByteArray toUtf8Json() const;
     QString name() const;
     QString dataString() const;
 
@@ -71,6 +74,10 @@ public:
     QString type;
     QJsonValue data;
     QString requestId;
+    qint64 timestamp = 0;  // time the event crossed the websocket, in ns on ZClock (0 == never)
 };
 
+// allows events to be passed between threads in queued signals
+Q_DECLARE_METATYPE(ZBusEvent)
+
 #endif
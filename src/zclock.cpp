@@ -0,0 +1,57 @@
+#include "zclock.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+
+/* The monotonic timer that timestamps are measured with, and the wall-clock time it was started at.
+ */
+struct Origin
+{
+    QElapsedTimer timer;
+    qint64 epoch;  // wall-clock time the timer was started, in ms since the epoch
+
+    Origin()
+    {
+        timer.start();
+        epoch = QDateTime::currentMSecsSinceEpoch();
+    }
+};
+
+/* \returns The origin of the clock, which is initialized (thread-safely) on first use.
+ */
+static const Origin &origin()
+{
+    static Origin origin;
+    return origin;
+}
+
+/* \returns Current time, in ns since the clock was first read, plus one.
+ */
+qint64 ZClock::now()
+{
+    return origin().timer.nsecsElapsed() + 1;
+}
+
+/* \brief Converts a timestamp to wall-clock time. The conversion uses the wall-clock time when the
+ *        clock was first read, so it is unaffected by later changes to the system time.
+ *
+ * \param <timestamp> Time, in ns on ZClock.
+ *
+ * \returns The time, in ms since the epoch.
+ */
+qint64 ZClock::toMSecsSinceEpoch(qint64 timestamp)
+{
+    return origin().epoch + (timestamp - 1) / 1000000;
+}
+
+/* \brief Converts a timestamp to wall-clock time, keeping its precision, e.g. for other processes
+ *        that do not share the clock.
+ *
+ * \param <timestamp> Time, in ns on ZClock.
+ *
+ * \returns The time, in ns since the epoch.
+ */
+qint64 ZClock::toNSecsSinceEpoch(qint64 timestamp)
+{
+    return origin().epoch * 1000000 + timestamp - 1;
+}
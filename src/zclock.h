@@ -0,0 +1,18 @@
+#ifndef ZCLOCK_H
+#define ZCLOCK_H
+
+#include <QtGlobal>
+
+/* The monotonic clock that events are timestamped with when they cross the websocket, shared by
+ * every thread. Timestamps are in ns since the clock was first read, and are never 0, so 0 can mean
+ * "not timestamped". They can be converted to wall-clock time for display.
+ */
+class ZClock
+{
+public:
+    static qint64 now();
+    static qint64 toMSecsSinceEpoch(qint64 timestamp);
+    static qint64 toNSecsSinceEpoch(qint64 timestamp);
+};
+
+#endif
@@ -0,0 +1,289 @@
+#include "zconnection.h"
+
+#include "scheduler.h"
+#include "zwebsocket.h"
+
+#include <QTimer>
+
+// How long to wait after a disconnection from zBus to retry connecting, in milliseconds.
+static const int RETRY_DELAY_MS = 500;
+
+/* \brief Constructs a ZConnection, and starts its I/O thread. The connection is not opened until
+ *        `open` is called.
+ *
+ * \param <zBusUrl> URL of the zBus server.
+ * \param <ring> Ring that received frames are published to (nullptr == none).
+ * \param <tls> How the server of a wss:// URL is verified.
+ * \param <standby> Whether a standby websocket is kept connected alongside the primary one.
+ * \param <parent> Parent of this instantiation of ZConnection.
+ */
+ZConnection::ZConnection(const QUrl &zBusUrl, ShmRing *ring, const TlsOptions &tls, bool standby,
+                         QObject *parent)
+    : QObject(parent), zBusUrl(zBusUrl), scheduler(Scheduler::system()), primary(0), lostAt(0),
+      lastGap(-1), failed(0), connected(false), handshake(-1), ticket(false), gap(-1), failovers(0)
+{
+    qRegisterMetaType<ZBusEvent>();
+    qRegisterMetaType<QVector<ReceivedEvent>>();
+
+    sockets[0] = new ZWebSocket();
+    sockets[1] = standby ? new ZWebSocket() : nullptr;
+    for (int index = 0; index < 2; index++)
+    {
+        up[index] = false;
+        ZWebSocket *socket = sockets[index];
+        if (socket == nullptr)
+        {
+            continue;
+        }
+
+        socket->setShmRing(ring);
+        socket->setTlsOptions(tls);
+        if (standby)
+        {
+            socket->setDuplicateFilter(&filter, index);
+        }
+        socket->moveToThread(&thread);
+        connect(&thread, &QThread::finished, socket, &QObject::deleteLater);
+        attach(index);
+    }
+
+    // lambdas with a websocket as their context run on the I/O thread
+    connect(this, &ZConnection::openRequested, sockets[0],
+            [this]
+            {
+                for (ZWebSocket *socket : sockets)
+                {
+                    if (socket != nullptr)
+                    {
+                        socket->open(this->zBusUrl);
+                    }
+                }
+            });
+    connect(this, &ZConnection::sendRequested,
+            sockets[0], [this] (const ZBusEvent &event)
+            {
+                sockets[primary]->sendZBusEvent(event);
+            });
+
+    thread.start();
+}
+
+/* \brief Stops the I/O thread, which closes and deletes the websockets.
+ */
+ZConnection::~ZConnection()
+{
+    thread.quit();
+    thread.wait();
+}
+
+/* \brief Sets the scheduler that the websockets are timed, and retried, on, e.g. a VirtualClock in
+ *        tests. Must be called before `open`.
+ *
+ * \param <scheduler> Scheduler, which must outlive the ZConnection.
+ */
+void ZConnection::setScheduler(Scheduler *scheduler)
+{
+    this->scheduler = scheduler;
+    for (ZWebSocket *socket : sockets)
+    {
+        if (socket != nullptr)
+        {
+            socket->setScheduler(scheduler);
+        }
+    }
+}
+
+/* \brief Connects to the zBus server.
+ */
+void ZConnection::open()
+{
+    emit openRequested();
+}
+
+/* \brief Sends the given event to the zBus server, or queues it to be sent when the connection is
+ *        established.
+ *
+ * \param <event> Event to be sent to zBus.
+ */
+void ZConnection::send(const ZBusEvent &event)
+{
+    emit sendRequested(event);
+}
+
+/* \returns Short name of the zBus server, e.g. "10.0.0.42:8180", to tag its events with.
+ */
+QString ZConnection::name() const
+{
+    return zBusUrl.port() == -1 ? zBusUrl.host()
+                                : zBusUrl.host() + ":" + QString::number(zBusUrl.port());
+}
+
+/* \returns True if the websocket was connected to zBus, when last reported by the I/O thread.
+ */
+bool ZConnection::isConnected() const
+{
+    return connected;
+}
+
+/* \returns Error that caused the websocket to disconnect from zBus, if any.
+ */
+QString ZConnection::errorString() const
+{
+    return error;
+}
+
+/* \returns Time the last connection to zBus took to establish, including the TCP, TLS, and
+ *          websocket handshakes, in ns, or -1 if no connection was established yet.
+ */
+qint64 ZConnection::handshakeTime() const
+{
+    return handshake;
+}
+
+/* \returns True if the last connection to zBus offered a TLS session ticket, to resume the session
+ *          of the connection before it.
+ */
+bool ZConnection::offeredSessionTicket() const
+{
+    return ticket;
+}
+
+/* \returns True if a standby websocket is kept connected alongside the primary one.
+ */
+bool ZConnection::hasStandby() const
+{
+    return sockets[1] != nullptr;
+}
+
+/* \returns Time neither websocket was connected to zBus, the last time the connection was lost,
+ *          i.e. for which events broadcast by zBus were missed, in ns, or -1 if it was never lost.
+ *          0 if the standby took over at once.
+ */
+qint64 ZConnection::gapTime() const
+{
+    return gap;
+}
+
+/* \returns Number of times the standby websocket took over from the primary one.
+ */
+int ZConnection::failoverCount() const
+{
+    return failovers;
+}
+
+/* \returns Number of events received by both websockets, and so dropped by one of them.
+ */
+qint64 ZConnection::duplicates() const
+{
+    return filter.duplicates();
+}
+
+/* \brief Records the status of the websockets, as reported by the I/O thread.
+ *
+ * \param <connected> Whether a websocket is connected to zBus.
+ * \param <error> Error that caused the websocket to disconnect, if any.
+ * \param <handshakeTime> Time the last connection took to establish, in ns (-1 == none).
+ * \param <ticket> Whether the last connection offered a TLS session ticket.
+ * \param <gapTime> Time neither websocket was connected, the last time, in ns (-1 == never).
+ * \param <failoverCount> Number of times the standby took over from the primary.
+ */
+void ZConnection::setStatus(bool connected, const QString &error, qint64 handshakeTime,
+                            bool ticket, qint64 gapTime, int failoverCount)
+{
+    this->connected = connected;
+    this->error = error;
+    this->handshake = handshakeTime;
+    this->ticket = ticket;
+    this->gap = gapTime;
+    this->failovers = failoverCount;
+}
+
+/* \brief Handles the events, connection, and disconnection of one of the websockets, on the I/O
+ *        thread.
+ *
+ * \param <index> Index of the websocket in `sockets`.
+ */
+void ZConnection::attach(int index)
+{
+    ZWebSocket *socket = sockets[index];
+
+    // events are routed by their envelope, so the websocket never parses them
+    connect(socket, &ZWebSocket::zBusEnvelopeReceived,
+            socket, [this, socket] (const QByteArray &text, const ZBusEnvelope &envelope,
+                                    qint64 timestamp)
+            {
+                // deliver everything received in this iteration of the event loop together
+                if (batch.isEmpty())
+                {
+                    QTimer::singleShot(0, socket, [this] { flush(); });
+                }
+                batch.append({ text, envelope, timestamp });
+            });
+
+    connect(socket, &ZWebSocket::connected,
+            socket, [this, index]
+            {
+                up[index] = true;
+                filter.setActive(index, true);
+                if (lostAt != 0)
+                {
+                    lastGap = scheduler->now() - lostAt;
+                    lostAt = 0;
+                }
+                if (!up[primary])
+                {
+                    primary = index;
+                }
+                report(QString());
+            });
+    connect(socket, &ZWebSocket::disconnected,
+            socket, [this, index, socket]
+            {
+                // `disconnected` is also emitted when an attempt to connect fails
+                bool lost = up[index];
+                up[index] = false;
+                filter.setActive(index, false);
+
+                // the standby takes over at once, and the lost websocket becomes the standby once
+                // it reconnects
+                int other = 1 - index;
+                if (index == primary && up[other])
+                {
+                    primary = other;
+                    failed++;
+                    lastGap = 0;
+                }
+                else if (lost && !up[other])
+                {
+                    lostAt = scheduler->now();
+                }
+
+                report(socket->tlsError().isEmpty() ? socket->errorString() : socket->tlsError());
+                scheduler->schedule(RETRY_DELAY_MS, socket,
+                                    [this, socket] { socket->open(zBusUrl); });
+            });
+}
+
+/* \brief Reports the status of the websockets to the thread that owns the ZConnection, from the
+ *        I/O thread.
+ *
+ * \param <error> Error that caused a websocket to disconnect, if any.
+ */
+void ZConnection::report(const QString &error)
+{
+    ZWebSocket *socket = sockets[primary];
+    QMetaObject::invokeMethod(this, "setStatus", Qt::QueuedConnection,
+                              Q_ARG(bool, up[0] || up[1]), Q_ARG(QString, error),
+                              Q_ARG(qint64, socket->handshakeTime()),
+                              Q_ARG(bool, socket->offeredSessionTicket()),
+                              Q_ARG(qint64, lastGap), Q_ARG(int, failed));
+}
+
+/* \brief Delivers the events received since the last batch, on the I/O thread.
+ */
+void ZConnection::flush()
+{
+    QVector<ReceivedEvent> events;
+    events.swap(batch);
+    emit eventsReceived(events);
+}
@@ -0,0 +1,110 @@
+#ifndef ZCONNECTION_H
+#define ZCONNECTION_H
+
+#include "duplicatefilter.h"
+#include "zbusevent.h"
+#include "zwebsocket.h"
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QUrl>
+#include <QVector>
+
+class Scheduler;
+class ShmRing;
+
+/* The JSON text of an event received from zBus by a ZConnection, with its envelope, which is all
+ * that is needed to route it; it is only parsed when its data is needed.
+ */
+struct ReceivedEvent
+{
+    QByteArray text;        // JSON text of the event, in UTF-8
+    ZBusEnvelope envelope;  // envelope fields of the event, in the text
+    qint64 timestamp;       // time the event arrived, in ns on ZClock
+};
+
+Q_DECLARE_METATYPE(ReceivedEvent)
+
+/* A connection to a single zBus server, which runs its ZWebSocket on a dedicated I/O thread, so
+ * that the websocket protocol and envelope scanning of many connections do not compete with the UI
+ * thread.
+ * The connection is retried whenever it is lost.
+ *
+ * With a standby, a second websocket is kept connected to the same server alongside the primary
+ * one, and receives the same events, which a DuplicateFilter lets through once. When the primary
+ * websocket is lost, the standby takes over at once, without missing the events broadcast while
+ * the lost one reconnects, in the background, to become the new standby. The gap, while neither
+ * websocket is connected, is measured.
+ *
+ * Events received in a single iteration of the I/O thread's event loop are delivered to the thread
+ * that owns the ZConnection as one batch, so a busy connection costs the owning thread one queued
+ * signal per batch, rather than one per event.
+ *
+ * The text of each received event can also be published to a shared-memory ring, on the I/O
+ * thread, as it arrives.
+ */
+class ZConnection : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ZConnection)
+
+public:
+    ZConnection(const QUrl &zBusUrl, ShmRing *ring = nullptr, const TlsOptions &tls = TlsOptions(),
+                bool standby = false, QObject *parent = nullptr);
+    ~ZConnection();
+
+    void setScheduler(Scheduler *scheduler);
+    void open();
+    void send(const ZBusEvent &event);
+
+    QString name() const;
+    bool isConnected() const;
+    QString errorString() const;
+    qint64 handshakeTime() const;
+    bool offeredSessionTicket() const;
+    bool hasStandby() const;
+    qint64 gapTime() const;
+    int failoverCount() const;
+    qint64 duplicates() const;
+
+signals:
+    void eventsReceived(const QVector<ReceivedEvent> &events);
+
+    // requests from the owning thread, handled on the I/O thread
+    void openRequested();
+    void sendRequested(const ZBusEvent &event);
+
+private slots:
+    void setStatus(bool connected, const QString &error, qint64 handshakeTime, bool ticket,
+                   qint64 gapTime, int failoverCount);
+
+private:
+    void attach(int index);
+    void report(const QString &error);
+    void flush();
+
+    QUrl zBusUrl;                  // URL of the zBus server
+    QThread thread;                // I/O thread
+    Scheduler *scheduler;          // times, and retries, the websockets
+
+    // owned by the I/O thread
+    ZWebSocket *sockets[2];        // websockets (the second == nullptr without a standby)
+    bool up[2];                    // whether each websocket is connected
+    int primary;                   // index of the websocket events are sent over
+    qint64 lostAt;                 // time neither websocket was connected since, in ns (0 == not)
+    qint64 lastGap;                // time neither websocket was connected, last time, in ns
+    int failed;                    // number of times the standby took over from the primary
+    DuplicateFilter filter;        // drops the events both websockets received
+    QVector<ReceivedEvent> batch;  // events received since the last batch
+
+    // as last reported by the I/O thread
+    bool connected;                // whether a websocket was connected
+    QString error;                 // error that caused the websocket to disconnect, if any
+    qint64 handshake;              // time the last connection took to establish, in ns (-1 == none)
+    bool ticket;                   // whether the last connection offered a TLS session ticket
+    qint64 gap;                    // time neither websocket was connected, last time (-1 == never)
+    int failovers;                 // number of times the standby took over from the primary
+};
+
+#endif
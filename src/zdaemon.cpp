@@ -0,0 +1,240 @@
+#include "zdaemon.h"
+
+#include "eventtemplate.h"
+#include "scheduler.h"
+#include "zwebsocket.h"
+
+#include <QDebug>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QVector>
+
+// How long to wait before reconnecting to zBus after the connection is lost, in ms.
+static const int RETRY_DELAY_MS = 500;
+
+// How long `send` waits for the daemon to accept a connection, in ms. The daemon is local, so
+// this only needs to cover a busy daemon; a missing daemon fails immediately.
+static const int CONNECT_TIMEOUT_MS = 250;
+
+// How long `send` waits for the daemon to acknowledge the events, in ms.
+static const int REPLY_TIMEOUT_MS = 5000;
+
+class ZDaemonPrivate {
+public:
+    QLocalServer server;
+    ZWebSocket client;
+    QUrl zBusUrl;
+    Scheduler *scheduler = Scheduler::system();  // retries the connection
+};
+
+/* \brief Constructs a ZDaemon that is not yet listening for events.
+ *
+ * \param <parent> Parent of this instantiation of ZDaemon.
+ */
+ZDaemon::ZDaemon(QObject *parent) : QObject(parent)
+{
+    p = new ZDaemonPrivate();
+
+    connect(&p->server, &QLocalServer::newConnection, this, &ZDaemon::acceptConnection);
+    connect(&p->client, &ZWebSocket::disconnected, this, &ZDaemon::retryConnection);
+    connect(&p->client, &ZWebSocket::connected,
+            [this]
+            {
+                qInfo() << "connected to zBus at" << p->zBusUrl.toString() << "in"
+                        << QString::number(p->client.handshakeTime() / 1e6, 'f', 1) << "ms"
+                        << (p->client.offeredSessionTicket() ? "(ticket)" : "");
+            });
+}
+
+/* \brief Cleans up objects created on the heap.
+ */
+ZDaemon::~ZDaemon()
+{
+    delete p;
+}
+
+/* \brief Connects to zBus, and starts listening for events on the local socket for the given URL.
+ *        A socket left behind by a daemon that did not exit cleanly is replaced, but a daemon that
+ *        is still running is not.
+ *
+ * \param <zBusUrl> URL of the zBus websocket.
+ *
+ * \returns True if the daemon is listening.
+ */
+bool ZDaemon::listen(const QUrl &zBusUrl)
+{
+    QString name = socketName(zBusUrl);
+
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(CONNECT_TIMEOUT_MS))
+    {
+        qWarning() << "A daemon is already running for" << zBusUrl.toString();
+        return false;
+    }
+
+    QLocalServer::removeServer(name);
+    p->server.setSocketOptions(QLocalServer::UserAccessOption);
+    if (!p->server.listen(name))
+    {
+        qWarning() << "Unable to listen on" << name << ":" << p->server.errorString();
+        return false;
+    }
+
+    qInfo() << "listening on" << p->server.fullServerName();
+    p->zBusUrl = zBusUrl;
+    p->client.open(zBusUrl);
+    return true;
+}
+
+/* \brief Publishes the text of every event received from zBus to the given shared-memory ring, so
+ *        local processes can consume the event stream of the daemon's connection.
+ *
+ * \param <ring> Ring to publish to, which must outlive the ZDaemon.
+ */
+void ZDaemon::setShmRing(ShmRing *ring)
+{
+    p->client.setShmRing(ring);
+}
+
+/* \brief Writes the events the daemon sends ahead to the given outbox, so that events queued while
+ *        zBus is unreachable survive the daemon, and sends the events it holds from a previous run.
+ *
+ * \param <outbox> Open outbox, which must outlive the ZDaemon.
+ */
+void ZDaemon::setOutbox(Outbox *outbox)
+{
+    p->client.setOutbox(outbox);
+}
+
+/* \brief Sets the CAs and public key pins that the server of a wss:// URL is verified against. The
+ *        TLS session is resumed whenever the daemon reconnects.
+ *
+ * \param <options> CAs and pins to trust.
+ */
+void ZDaemon::setTlsOptions(const TlsOptions &options)
+{
+    p->client.setTlsOptions(options);
+}
+
+/* \brief Sets the scheduler that the connection is timed, and retried, on, e.g. a VirtualClock in
+ *        tests.
+ *
+ * \param <scheduler> Scheduler, which must outlive the ZDaemon.
+ */
+void ZDaemon::setScheduler(Scheduler *scheduler)
+{
+    p->scheduler = scheduler;
+    p->client.setScheduler(scheduler);
+}
+
+/* \brief Determines the name of the local socket a daemon for the given zBus URL listens on.
+ *
+ * \param <zBusUrl> URL of the zBus websocket.
+ *
+ * \returns Name of the local socket.
+ */
+QString ZDaemon::socketName(const QUrl &zBusUrl)
+{
+    return QString("zbus-cli-ent-%1").arg(qHash(zBusUrl.toString()), 0, 16);
+}
+
+/* \brief Sends events through the daemon for the given zBus URL, if one is running. Templates are
+ *        expanded here, and written as-is, so the daemon only forwards finished events. Line breaks
+ *        in the templates, which are whitespace in JSON, are replaced so each event is one line.
+ *
+ * \param <zBusUrl> URL of the zBus websocket.
+ * \param <events> List of JSON-formatted strings to be sent to zBus.
+ * \param <repeat> Number of times to send the list.
+ *
+ * \returns Whether the daemon acknowledged the events. Only if no daemon is running should the
+ *          events be sent directly; once they are written, they are never sent again.
+ */
+DaemonDelivery ZDaemon::send(const QUrl &zBusUrl, const QStringList &events, int repeat)
+{
+    QLocalSocket socket;
+    socket.connectToServer(socketName(zBusUrl));
+    if (!socket.waitForConnected(CONNECT_TIMEOUT_MS))
+    {
+        return DaemonDelivery::NoDaemon;
+    }
+
+    QVector<EventTemplate> templates;
+    foreach (QString event, events)
+    {
+        templates.append(EventTemplate(event.replace('\n', ' ').replace('\r', ' ')));
+    }
+
+    QByteArray batch;
+    for (int i = 0; i < repeat; i++)
+    {
+        for (int j = 0; j < templates.size(); j++)
+        {
+            batch.append(templates[j].expand()).append('\n');
+        }
+    }
+    batch.append('\n');
+
+    socket.write(batch);
+    while (!socket.canReadLine())
+    {
+        if (!socket.waitForReadyRead(REPLY_TIMEOUT_MS))
+        {
+            qWarning() << "The daemon did not acknowledge the events:" << socket.errorString();
+            return DaemonDelivery::Unacknowledged;
+        }
+    }
+
+    bool ok = false;
+    socket.readLine().trimmed().toInt(&ok);
+    socket.disconnectFromServer();
+    return ok ? DaemonDelivery::Acknowledged : DaemonDelivery::Unacknowledged;
+}
+
+/* \brief Accepts pending connections from `--send` invocations.
+ */
+void ZDaemon::acceptConnection()
+{
+    while (QLocalSocket *socket = p->server.nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::readyRead, [this, socket] { readEvents(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+/* \brief Sends each complete line received from a client to zBus as-is, and acknowledges the
+ *        batch when the empty line that ends it is received. Events are queued by ZWebSocket while
+ *        zBus is unreachable, and sent once the connection is re-established.
+ *
+ * \param <socket> Connection to the client.
+ */
+void ZDaemon::readEvents(QLocalSocket *socket)
+{
+    // number of events received on this connection since the last acknowledgement
+    int count = socket->property("count").toInt();
+
+    while (socket->canReadLine())
+    {
+        QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty())
+        {
+            socket->write(QByteArray::number(count) + '\n');
+            socket->flush();
+            count = 0;
+            continue;
+        }
+
+        p->client.sendZBusText(line);
+        count++;
+    }
+
+    socket->setProperty("count", count);
+}
+
+/* \brief Attempts to reconnect to zBus after a delay. This is connected to ZWebSocket's
+ *        disconnected signal.
+ */
+void ZDaemon::retryConnection()
+{
+    p->scheduler->schedule(RETRY_DELAY_MS, this, [this] { p->client.open(p->zBusUrl); });
+}
@@ -0,0 +1,64 @@
+#ifndef ZDAEMON_H
+#define ZDAEMON_H
+
+#include <QObject>
+#include <QStringList>
+#include <QUrl>
+
+class Outbox;
+class QLocalSocket;
+class Scheduler;
+class ShmRing;
+class ZDaemonPrivate;
+struct TlsOptions;
+
+/* The outcome of sending events through a daemon. Once the events are written to the daemon, they
+ * may have been sent to zBus whether or not the daemon acknowledged them, so they must not be sent
+ * again.
+ */
+enum class DaemonDelivery
+{
+    NoDaemon,        // no daemon is running, so nothing was written, and the events should be sent
+                     // directly
+    Acknowledged,    // the daemon acknowledged the events
+    Unacknowledged,  // the events were written, but the daemon did not acknowledge them
+};
+
+/* A background process that holds a single connection to zBus open, and sends events it receives
+ * from `--send` invocations over a local (UNIX domain) socket, so that each invocation costs one
+ * local round trip instead of process startup plus a websocket handshake.
+ *
+ * The local socket is named after the zBus URL, so one daemon can run per zBus server. The protocol
+ * is line-based: the client writes one compact JSON event per line, followed by an empty line, and
+ * the daemon replies with the number of events it sent (or queued, if zBus is unreachable) followed
+ * by a newline.
+ */
+class ZDaemon : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ZDaemon)
+
+public:
+    ZDaemon(QObject *parent = nullptr);
+    ~ZDaemon();
+
+    bool listen(const QUrl &zBusUrl);
+    void setShmRing(ShmRing *ring);
+    void setOutbox(Outbox *outbox);
+    void setTlsOptions(const TlsOptions &options);
+    void setScheduler(Scheduler *scheduler);
+
+    static QString socketName(const QUrl &zBusUrl);
+    static DaemonDelivery send(const QUrl &zBusUrl, const QStringList &events, int repeat = 1);
+
+private slots:
+    void acceptConnection();
+    void retryConnection();
+
+private:
+    void readEvents(QLocalSocket *socket);
+
+    ZDaemonPrivate *p;
+};
+
+#endif
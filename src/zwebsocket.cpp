@@ -1,18 +1,81 @@
 #include "zwebsocket.h"
 
+#include "decodepool.h"
+#include "duplicatefilter.h"
+#include "envelopescanner.h"
+#include "eventstats.h"
+#include "eventtemplate.h"
+#include "outbox.h"
+#include "scheduler.h"
+#include "shmring.h"
 #include "zbusevent.h"
+#include "zclock.h"
 
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QFutureInterface>
 #include <QJsonDocument>
 #include <QList>
+#include <QMetaMethod>
+#include <QPointer>
 #include <QQueue>
+#include <QSharedPointer>
+#include <QSslCertificate>
+#include <QSslConfiguration>
+#include <QSslKey>
+#include <QSslSocket>
 #include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+/* The future of a batch of events sent with `sendZBusEventsAsync`. A batch that is dropped before
+ * it is flushed, e.g. with its ZWebSocket, finishes as not flushed.
+ */
+struct SendBatch
+{
+    QFutureInterface<bool> future;
+    quint64 end = 0;  // number of events sent or queued by the socket, up to the batch's last one
+
+    SendBatch() { future.reportStarted(); }
+    ~SendBatch() { finish(false); }
+
+    void finish(bool flushed)
+    {
+        if (!future.isFinished())
+        {
+            future.reportResult(flushed);
+            future.reportFinished();
+        }
+    }
+};
 
 class ZWebSocketPrivate {
 public:
-    QQueue<ZBusEvent> eventQueue;
+    QQueue<OutboxEntry> eventQueue;
+    EventStats stats;
+    ShmRing *ring = nullptr;  // ring that received frames are published to, if any
+    DecodePool *decodePool = nullptr;  // workers that decode received frames (nullptr == inline)
+    Scheduler *scheduler = Scheduler::system();  // tells the time events cross the websocket
+    DuplicateFilter *duplicates = nullptr;  // drops frames another websocket received (if any)
+    int source = 0;  // which of the websockets sharing the duplicate filter this is
+    Outbox *outbox = nullptr;  // log that outbound events are written ahead to, if any
+    quint64 written = 0;  // sequence number, in the outbox, of the last event written to the socket
+    QSslConfiguration tls;  // TLS configuration of the next connection, and the last session ticket
+    QStringList pins;  // hashes of the public keys a wss:// server may have (empty == any)
+    QString tlsError;  // why the last connection was rejected, if it was rejected for its key
+    QPointer<QSslSocket> tlsSocket;  // TLS socket whose handshake is checked against the pins
+    qint64 opening = 0;  // time the current connection was opened, in ns (0 == not connecting)
+    qint64 handshakeTime = -1;  // time the last connection took to establish, in ns (-1 == none)
+    bool offeredSessionTicket = false;  // whether the last connection offered a TLS session ticket
+    quint64 accepted = 0;  // number of events sent or queued, ever
+    quint64 transmitted = 0;  // number of events written to the socket, ever
+    QList<QSharedPointer<SendBatch>> batches;  // batches sent asynchronously, not yet flushed
 };
 
+// Prefix of a public key pin, which is followed by the base64 of its SHA-256 hash.
+static const QString PIN_PREFIX = "sha256//";
+
 /* \brief Constructs ZWebSocket, and prepares to send any messages that were queued up before the
  *        connection to zBus was established.
  *
@@ -25,12 +88,96 @@ ZWebSocket::ZWebSocket(const QString &origin, QWebSocketProtocol::Version versio
     : QWebSocket(origin, version, parent)
 {
     p = new ZWebSocketPrivate();
+    setTlsOptions(TlsOptions());
 
     connect(this, &ZWebSocket::connected, this, &ZWebSocket::processEventQueue);
+    connect(this, &ZWebSocket::stateChanged,
+            [this] (QAbstractSocket::SocketState state)
+            {
+                // the state changes as soon as the websocket is opened, and again once the
+                // handshake is done, before `connected` is emitted
+                if (state == QAbstractSocket::ConnectingState)
+                {
+                    p->opening = p->scheduler->now();
+                    p->offeredSessionTicket = !p->tls.sessionTicket().isEmpty();
+                    p->tlsError.clear();
+                    checkPinOnHandshake();
+                }
+                else if (state == QAbstractSocket::ConnectedState && p->opening != 0)
+                {
+                    p->handshakeTime = p->scheduler->now() - p->opening;
+                    p->opening = 0;
+                    keepSessionTicket();
+                }
+            });
+    connect(this, &ZWebSocket::disconnected,
+            [this]
+            {
+                // a TLS 1.3 server sends its session tickets after the handshake
+                p->opening = 0;
+                keepSessionTicket();
+
+                // batches that were written, but not flushed, are lost with the connection; those
+                // still queued are sent on the next one
+                finishBatches(false);
+            });
+    connect(this, &ZWebSocket::bytesWritten,
+            [this]
+            {
+                // events are delivered, as far as the outbox is concerned, once the socket has
+                // handed every byte of them to the operating system
+                if (bytesToWrite() != 0)
+                {
+                    return;
+                }
+                if (p->outbox != nullptr)
+                {
+                    p->outbox->markDelivered(p->written);
+                }
+                finishBatches(true);
+            });
     connect(this, &ZWebSocket::textMessageReceived,
             [this] (const QString &text)
             {
-                emit zBusEventReceived(QJsonDocument::fromJson(text.toUtf8()).object());
+                // timestamp the event as it arrives, before it is parsed
+                qint64 timestamp = p->scheduler->now();
+                QByteArray utf8 = text.toUtf8();
+                if (p->duplicates != nullptr && !p->duplicates->accept(p->source, utf8, timestamp))
+                {
+                    return;
+                }
+                if (p->ring != nullptr)
+                {
+                    p->ring->publish(utf8, ZClock::toNSecsSinceEpoch(timestamp));
+                }
+
+                // count and route the frame by its envelope, and only build the full event for
+                // whoever needs its data
+                ZBusEnvelope envelope;
+                if (EnvelopeScanner::scan(utf8, envelope))
+                {
+                    p->stats.record(EnvelopeScanner::string(utf8, envelope.event), utf8.size(),
+                                    timestamp);
+                    emit zBusEnvelopeReceived(utf8, envelope, timestamp);
+                }
+                else
+                {
+                    envelope = ZBusEnvelope();
+                    p->stats.record(QString(), utf8.size(), timestamp);
+                }
+                if (!isSignalConnected(QMetaMethod::fromSignal(&ZWebSocket::zBusEventReceived)))
+                {
+                    return;
+                }
+
+                if (p->decodePool != nullptr)
+                {
+                    p->decodePool->submit(utf8, utf8.size(), timestamp);
+                    return;
+                }
+                ZBusEvent event(QJsonDocument::fromJson(utf8).object());
+                event.timestamp = timestamp;
+                receiveZBusEvent(event, utf8.size());
             });
 }
 
@@ -41,21 +188,182 @@ ZWebSocket::~ZWebSocket()
     delete p;
 }
 
+/* \returns Statistics of the events sent to, and received from, zBus, for each event name.
+ */
+const EventStats &ZWebSocket::stats() const
+{
+    return p->stats;
+}
+
+/* \brief Publishes the text of every message received from zBus, as it arrives, to the given
+ *        shared-memory ring, so local processes can consume the event stream too.
+ *
+ * \param <ring> Ring to publish to, which must outlive the ZWebSocket (nullptr == none).
+ */
+void ZWebSocket::setShmRing(ShmRing *ring)
+{
+    p->ring = ring;
+}
+
+/* \brief Decodes the frames received from zBus on the given number of worker threads, rather than
+ *        on the thread the ZWebSocket lives on. Events are still emitted in the order they arrived.
+ *        Must be called before the ZWebSocket is moved to another thread.
+ *
+ * \param <threads> Number of worker threads (0 == decode inline).
+ */
+void ZWebSocket::setDecodeThreads(int threads)
+{
+    delete p->decodePool;
+    p->decodePool = nullptr;
+    if (threads > 0)
+    {
+        p->decodePool = new DecodePool(threads, this);
+        connect(p->decodePool, &DecodePool::decoded, this, &ZWebSocket::receiveZBusEvent);
+    }
+}
+
+/* \brief Sets the scheduler that events, and the handshake, are timed on, e.g. a VirtualClock in
+ *        tests.
+ *
+ * \param <scheduler> Scheduler, which must outlive the ZWebSocket.
+ */
+void ZWebSocket::setScheduler(Scheduler *scheduler)
+{
+    p->scheduler = scheduler;
+}
+
+/* \brief Drops the frames received from zBus that another websocket, connected to the same server,
+ *        received first, before they are published, counted, or decoded.
+ *
+ * \param <filter> Filter shared with the other websocket, which must live on the same thread.
+ * \param <source> Which of the two websockets sharing the filter this is (0 or 1).
+ */
+void ZWebSocket::setDuplicateFilter(DuplicateFilter *filter, int source)
+{
+    p->duplicates = filter;
+    p->source = source;
+}
+
+/* \brief Writes every event sent to zBus ahead to the given outbox, and queues the events that it
+ *        holds from a previous run, to be sent, in order, before any other event.
+ *
+ * \param <outbox> Open outbox, which must outlive the ZWebSocket (nullptr == none).
+ */
+void ZWebSocket::setOutbox(Outbox *outbox)
+{
+    p->outbox = outbox;
+    if (outbox != nullptr)
+    {
+        for (const OutboxEntry &entry : outbox->pending())
+        {
+            p->eventQueue.enqueue(entry);
+            p->accepted++;
+        }
+    }
+}
+
+/* \brief Sets how the server of a wss:// URL is verified, from the next connection on. Session
+ *        tickets are always kept, and offered on reconnection.
+ *
+ * \param <options> CAs and public key pins to trust, which should have been checked with
+ *                  `checkTlsOptions`.
+ */
+void ZWebSocket::setTlsOptions(const TlsOptions &options)
+{
+    p->tls = QSslConfiguration::defaultConfiguration();
+    if (!options.caFile.isEmpty())
+    {
+        p->tls.setCaCertificates(QSslCertificate::fromPath(options.caFile));
+    }
+    p->tls.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    p->pins = options.pins;
+    setSslConfiguration(p->tls);
+}
+
+/* \returns Time from opening the last connection until it was established, including the TCP,
+ *          TLS, and websocket handshakes, in ns, or -1 if no connection was established yet.
+ */
+qint64 ZWebSocket::handshakeTime() const
+{
+    return p->handshakeTime;
+}
+
+/* \returns True if the last connection offered the server the session ticket of a previous one, to
+ *          resume its TLS session.
+ */
+bool ZWebSocket::offeredSessionTicket() const
+{
+    return p->offeredSessionTicket;
+}
+
+/* \returns Why the last connection was aborted because the server's public key is not pinned, or an
+ *          empty string if it was not.
+ */
+QString ZWebSocket::tlsError() const
+{
+    return p->tlsError;
+}
+
+/* \brief Checks that the CA file of the given options holds certificates, and that each pin is a
+ *        "sha256//" prefix followed by the base64 of a SHA-256 hash.
+ *
+ * \param <options> Options to be checked.
+ *
+ * \returns What is wrong with the options, or an empty string if nothing is.
+ */
+QString ZWebSocket::checkTlsOptions(const TlsOptions &options)
+{
+    if (!options.caFile.isEmpty() && QSslCertificate::fromPath(options.caFile).isEmpty())
+    {
+        return QString("no certificates found in %1").arg(options.caFile);
+    }
+
+    foreach (const QString &pin, options.pins)
+    {
+        if (!pin.startsWith(PIN_PREFIX) ||
+            QByteArray::fromBase64(pin.mid(PIN_PREFIX.size()).toLatin1()).size() != 32)
+        {
+            return QString("%1 is not a pin of the form sha256//<base64 of SHA-256>").arg(pin);
+        }
+    }
+
+    return QString();
+}
+
+/* \brief Emits a decoded event. The event was counted in the statistics when it arrived.
+ *
+ * \param <event> Event received from zBus, timestamped with when it arrived.
+ * \param <size> Size of the text of the event, in bytes.
+ */
+void ZWebSocket::receiveZBusEvent(const ZBusEvent &event, int size)
+{
+    emit zBusEventReceived(event, size);
+}
+
 /* \brief Sends events that were queued up while ZWebSocket was not connected to zBus and emits a
  *        signal when finished.
  */
 void ZWebSocket::processEventQueue()
 {
+    // nothing is sent to a server whose public key is not pinned; this is normally caught by
+    // `checkPinOnHandshake`, before the upgrade request, and is only checked again in case not
+    if (!isPinned(sslConfiguration().peerCertificate()))
+    {
+        p->tlsError = "the public key of the server is not pinned";
+        abort();
+        return;
+    }
+
     while (!p->eventQueue.isEmpty())
     {
-        sendZBusEvent(p->eventQueue.dequeue());
+        OutboxEntry entry = p->eventQueue.dequeue();
+        writeZBusText(entry.json, entry.sequence);
     }
 
     emit processedEventQueue();
 }
 
-/* \brief If ZWebSocket is connected to zBus, sends the given event to zBus. Otherwise, the event is
- *        queued up to be sent when the connection is established.
+/* \brief Sends, or queues, the given event, as compact JSON text. See `sendZBusText`.
  *
  * \param <event> Event to be sent to zBus.
  *
@@ -63,36 +371,154 @@ void ZWebSocket::processEventQueue()
  */
 qint64 ZWebSocket::sendZBusEvent(const ZBusEvent &event)
 {
+    return sendZBusText(event.toUtf8Json());
+}
+
+/* \brief If ZWebSocket is connected to zBus, sends the given JSON text of an event to zBus as-is,
+ *        without parsing it, and emits it, timestamped as it was written to the socket. Otherwise,
+ *        the text is queued up to be sent when the connection is established. Either way, the
+ *        event is written ahead to the outbox, if there is one. Text that is not a JSON object is
+ *        not sent.
+ *
+ * \param <json> JSON text of the event, in UTF-8.
+ *
+ * \returns Number of bytes transmitted.
+ */
+qint64 ZWebSocket::sendZBusText(const QByteArray &json)
+{
+    ZBusEnvelope envelope;
+    if (!EnvelopeScanner::scan(json, envelope))
+    {
+        qWarning() << "Not sending malformed event:" << json;
+        return 0;
+    }
+
+    quint64 sequence = p->outbox != nullptr ? p->outbox->append(json) : 0;
+    p->accepted++;
     if (isValid())
     {
-        return sendTextMessage(event.toJson());
+        return writeZBusText(json, sequence);
     }
     else
     {
-        p->eventQueue.enqueue(event);
+        p->eventQueue.enqueue({ sequence, json });
         return 0;
     }
 }
 
-/* \brief Constructs, then sends, or queues, multiple events.
+/* \brief Writes the JSON text of an event to the socket, and emits it, timestamped as it was
+ *        written.
  *
- *        A QString can be implicitly converted to a ZBusEvent, but a list of QStrings can not be
- *        implicitly converted to a list of ZBusEvents, so the list of QStrings is explicitly
- *        converted here.
+ * \param <json> JSON text of the event, in UTF-8, which is a JSON object.
+ * \param <sequence> Sequence number of the event in the outbox (0 == not logged).
  *
- * \param <events> List of JSON-formatted strings to be converted then sent to zBus.
+ * \returns Number of bytes transmitted.
+ */
+qint64 ZWebSocket::writeZBusText(const QByteArray &json, quint64 sequence)
+{
+    ZBusEnvelope envelope;
+    EnvelopeScanner::scan(json, envelope);
+    qint64 timestamp = p->scheduler->now();
+    p->stats.record(EnvelopeScanner::string(json, envelope.event), json.size(), timestamp);
+    qint64 bytesSent = sendTextMessage(QString::fromUtf8(json));
+    p->transmitted++;
+    if (sequence != 0)
+    {
+        p->written = sequence;
+    }
+    emit zBusEventSent(json, envelope, timestamp);
+    return bytesSent;
+}
+
+/* \param <certificate> Certificate the server presented for the current connection.
+ *
+ * \returns True if no public keys are pinned, or if the certificate's public key is one of them.
+ */
+bool ZWebSocket::isPinned(const QSslCertificate &certificate) const
+{
+    if (p->pins.isEmpty())
+    {
+        return true;
+    }
+
+    QByteArray key = certificate.publicKey().toDer();
+    QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha256);
+    return p->pins.contains(PIN_PREFIX + QString::fromLatin1(hash.toBase64()));
+}
+
+/* \brief Checks the public key of the server as soon as the TLS handshake of the connection being
+ *        opened is done, and aborts it if it is not pinned, so that not even the websocket upgrade
+ *        request is sent to the server.
+ *
+ * QWebSocket does not expose its QSslSocket, but creates it as its child when it is opened, before
+ * it changes to ConnectingState. The upgrade request is written once the socket is connected, and
+ * only leaves it encrypted, after `encrypted` is emitted.
+ */
+void ZWebSocket::checkPinOnHandshake()
+{
+    QList<QSslSocket *> sockets = findChildren<QSslSocket *>(QString(), Qt::FindDirectChildrenOnly);
+    if (p->pins.isEmpty() || sockets.isEmpty() || sockets.last() == p->tlsSocket)
+    {
+        return;
+    }
+
+    // the socket of the previous connection may not be deleted yet; the newest child is this one's
+    p->tlsSocket = sockets.last();
+    QSslSocket *socket = p->tlsSocket;
+    connect(socket, &QSslSocket::encrypted, this,
+            [this, socket]
+            {
+                if (!isPinned(socket->peerCertificate()))
+                {
+                    p->tlsError = "the public key of the server is not pinned";
+                    abort();
+                }
+            });
+}
+
+/* \brief Keeps the TLS session ticket the server issued for the current connection, if any, to be
+ *        offered on the next connection.
+ */
+void ZWebSocket::keepSessionTicket()
+{
+    QByteArray ticket = sslConfiguration().sessionTicket();
+    if (!ticket.isEmpty() && ticket != p->tls.sessionTicket())
+    {
+        p->tls.setSessionTicket(ticket);
+        setSslConfiguration(p->tls);
+    }
+}
+
+/* \brief Expands, then sends, or queues, multiple events.
+ *
+ *        Each string is compiled into an EventTemplate, so it may contain placeholders (e.g. a
+ *        `{{uuid}}` requestId) that are filled in anew each time it is sent. Each expansion is sent
+ *        as-is, without being parsed. The strings are sent in order, and the whole list is sent
+ *        `repeat` times.
+ *
+ * \param <events> List of JSON-formatted strings to be expanded then sent to zBus.
+ * \param <repeat> Number of times to send the list.
  *
  * \returns Number of bytes transmitted.
  */
-qint64 ZWebSocket::sendZBusEvents(const QStringList &events)
+qint64 ZWebSocket::sendZBusEvents(const QStringList &events, int repeat)
 {
-    QList<ZBusEvent> zBusEvents;
+    QVector<EventTemplate> templates;
     foreach(const QString &event, events)
     {
-        zBusEvents.append(QJsonDocument::fromJson(event.toUtf8()).object());
+        templates.append(EventTemplate(event));
+    }
+
+    qint64 bytesSent = 0;
+    for (int i = 0; i < repeat; i++)
+    {
+        for (int j = 0; j < templates.size(); j++)
+        {
+            bytesSent += sendZBusText(templates[j].expand());
+        }
     }
 
-    return sendZBusEvents(zBusEvents);
+    return bytesSent;
 }
 
 /* \brief Sends, or queues, multiple events.
@@ -112,3 +538,53 @@ qint64 ZWebSocket::sendZBusEvents(const QList<ZBusEvent> &events)
 
     return bytesSent;
 }
+
+/* \brief Sends, or queues, a batch of events, like `sendZBusEvents`, without waiting for them to
+ *        be written. May be called from any thread; the events are sent on the thread the
+ *        ZWebSocket lives on, after any sent before them.
+ *
+ * \param <events> List of events to be sent to zBus.
+ *
+ * \returns A future that finishes with true once every event of the batch has been handed to the
+ *          operating system, or with false if the connection is lost (or the ZWebSocket destroyed)
+ *          first. Events queued while disconnected are sent once the connection is established.
+ */
+QFuture<bool> ZWebSocket::sendZBusEventsAsync(const QList<ZBusEvent> &events)
+{
+    QSharedPointer<SendBatch> batch(new SendBatch());
+    QFuture<bool> future = batch->future.future();
+    auto send = [this, events, batch]
+    {
+        sendZBusEvents(events);
+        batch->end = p->accepted;
+        p->batches.append(batch);
+
+        // nothing is left to flush when the batch was empty, or already flushed
+        if (bytesToWrite() == 0)
+        {
+            finishBatches(true);
+        }
+    };
+
+    if (QThread::currentThread() == thread())
+    {
+        send();
+    }
+    else
+    {
+        QTimer::singleShot(0, this, send);
+    }
+    return future;
+}
+
+/* \brief Finishes the futures of the batches whose events have all been written to the socket.
+ *
+ * \param <flushed> Whether the written events were flushed, or lost with the connection.
+ */
+void ZWebSocket::finishBatches(bool flushed)
+{
+    while (!p->batches.isEmpty() && p->batches.first()->end <= p->transmitted)
+    {
+        p->batches.takeFirst()->finish(flushed);
+    }
+}
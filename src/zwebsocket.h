@@ -1,12 +1,33 @@
 #ifndef ZBUS_CLIENT_H
 #define ZBUS_CLIENT_H
 
+#include "envelopescanner.h"
+
+#include <QFuture>
+#include <QStringList>
 #include <QWebSocket>
 
+class DuplicateFilter;
+class EventStats;
+class Outbox;
+class Scheduler;
+class ShmRing;
 class ZBusEvent;
 class ZWebSocketPrivate;
 
+/* How ZWebSocket verifies the server of a wss:// URL, beyond the usual certificate checks.
+ */
+struct TlsOptions
+{
+    QString caFile;     // PEM file of the CAs to trust, instead of the system's (empty == system)
+    QStringList pins;   // "sha256//<base64>" hashes of the public keys to trust (empty == any)
+};
+
 /* A QWebSocket configured for connecting to, and communicating with, the zBus server.
+ *
+ * wss:// URLs are verified against the CAs and public key pins of the TlsOptions, and the TLS
+ * session ticket of each connection is kept, and offered on the next one, so that reconnecting
+ * resumes the TLS session rather than paying for a full handshake.
 */
 class ZWebSocket : public QWebSocket
 {
@@ -22,17 +43,43 @@ public:
     ~ZWebSocket();
 
     qint64 sendZBusEvent(const ZBusEvent &event);
-    qint64 sendZBusEvents(const QStringList &events);
+    qint64 sendZBusText(const QByteArray &json);
+    qint64 sendZBusEvents(const QStringList &events, int repeat = 1);
     qint64 sendZBusEvents(const QList<ZBusEvent> &events);
+    QFuture<bool> sendZBusEventsAsync(const QList<ZBusEvent> &events);
+
+    const EventStats &stats() const;
+    void setShmRing(ShmRing *ring);
+    void setDecodeThreads(int threads);
+    void setDuplicateFilter(DuplicateFilter *filter, int source);
+    void setScheduler(Scheduler *scheduler);
+    void setOutbox(Outbox *outbox);
+    void setTlsOptions(const TlsOptions &options);
+
+    qint64 handshakeTime() const;
+    bool offeredSessionTicket() const;
+    QString tlsError() const;
+
+    static QString checkTlsOptions(const TlsOptions &options);
 
 signals:
     void processedEventQueue();
-    void zBusEventReceived(const ZBusEvent &event);
+    void zBusEventSent(const QByteArray &text, const ZBusEnvelope &envelope, qint64 timestamp);
+    void zBusEventReceived(const ZBusEvent &event, int size);
+    void zBusEnvelopeReceived(const QByteArray &text, const ZBusEnvelope &envelope,
+                              qint64 timestamp);
 
 private slots:
     void processEventQueue();
+    void receiveZBusEvent(const ZBusEvent &event, int size);
 
 private:
+    qint64 writeZBusText(const QByteArray &json, quint64 sequence);
+    void finishBatches(bool flushed);
+    void checkPinOnHandshake();
+    bool isPinned(const QSslCertificate &certificate) const;
+    void keepSessionTicket();
+
     ZWebSocketPrivate *p;
 };
 
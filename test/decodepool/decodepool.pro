@@ -0,0 +1,6 @@
+QT += testlib
+CONFIG += testcase
+
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += decodepool.test.cpp
@@ -0,0 +1,65 @@
+#include "../../src/decodepool.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class DecodePoolTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // Large frames decoded by workers, and small frames decoded inline, are emitted in the order
+    // they were submitted, with their sizes and timestamps.
+    void order()
+    {
+        DecodePool pool(4);
+        QVector<ZBusEvent> events;
+        QVector<int> sizes;
+        connect(&pool, &DecodePool::decoded,
+                [&events, &sizes] (const ZBusEvent &event, int size)
+                {
+                    events.append(event);
+                    sizes.append(size);
+                });
+
+        for (int i = 0; i < 200; i++)
+        {
+            // every third frame is large enough to be handed to a worker
+            QByteArray padding(i % 3 == 0 ? 20000 : 10, 'x');
+            QByteArray text = "{\"event\":\"scanner.read\",\"data\":{\"padding\":\"" + padding
+                            + "\"},\"requestId\":\"" + QByteArray::number(i) + "\"}";
+            pool.submit(text, text.size(), i + 1);
+        }
+
+        QTRY_COMPARE(events.size(), 200);
+        for (int i = 0; i < 200; i++)
+        {
+            QCOMPARE(events.at(i).requestId, QString::number(i));
+            QCOMPARE(events.at(i).timestamp, qint64(i + 1));
+            QCOMPARE(events.at(i).name(), QString("scanner.read"));
+        }
+        QVERIFY(sizes.at(0) > 20000);
+        QVERIFY(sizes.at(1) < 100);
+    }
+
+    // A small frame behind a large one waits for it.
+    void smallWaitsForLarge()
+    {
+        DecodePool pool(2);
+        QStringList names;
+        connect(&pool, &DecodePool::decoded,
+                [&names] (const ZBusEvent &event, int) { names.append(event.name()); });
+
+        QByteArray large = "{\"event\":\"printer.print\",\"data\":\"" + QByteArray(100000, 'x')
+                         + "\"}";
+        QByteArray small = "{\"event\":\"scanner.read\",\"data\":{}}";
+        pool.submit(large, large.size(), 1);
+        pool.submit(small, small.size(), 2);
+
+        QTRY_COMPARE(names.size(), 2);
+        QCOMPARE(names, QStringList({ "printer.print", "scanner.read" }));
+    }
+};
+
+QTEST_GUILESS_MAIN(DecodePoolTest);
+#include "decodepool.test.moc"
@@ -0,0 +1,87 @@
+#include "../../src/duplicatefilter.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class DuplicateFilterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void firstReceived()
+    {
+        DuplicateFilter filter;
+        filter.setActive(0, true);
+        filter.setActive(1, true);
+
+        // whichever websocket receives a frame first lets it through
+        QVERIFY(filter.accept(0, "a", 1));
+        QVERIFY(filter.accept(1, "b", 2));
+        QVERIFY(!filter.accept(1, "a", 3));
+        QVERIFY(!filter.accept(0, "b", 4));
+        QCOMPARE(filter.duplicates(), qint64(2));
+    }
+
+    void repeated()
+    {
+        DuplicateFilter filter;
+        filter.setActive(0, true);
+        filter.setActive(1, true);
+
+        // an event broadcast twice is let through twice
+        QVERIFY(filter.accept(0, "a", 1));
+        QVERIFY(filter.accept(0, "a", 2));
+        QVERIFY(!filter.accept(1, "a", 3));
+        QVERIFY(!filter.accept(1, "a", 4));
+        QVERIFY(filter.accept(1, "a", 5));
+        QCOMPARE(filter.duplicates(), qint64(2));
+    }
+
+    void missed()
+    {
+        DuplicateFilter filter;
+        filter.setActive(0, true);
+        filter.setActive(1, true);
+
+        // the frames the other websocket let through before this one was connected are skipped
+        QVERIFY(filter.accept(0, "a", 1));
+        QVERIFY(filter.accept(0, "b", 2));
+        QVERIFY(filter.accept(0, "c", 3));
+        QVERIFY(!filter.accept(1, "c", 4));
+        QVERIFY(filter.accept(1, "a", 5));
+    }
+
+    void inactive()
+    {
+        DuplicateFilter filter;
+        filter.setActive(0, true);
+
+        // the frames let through while the other websocket is not connected are not queued
+        QVERIFY(filter.accept(0, "a", 1));
+        filter.setActive(1, true);
+        QVERIFY(filter.accept(1, "a", 2));
+
+        // nor are those waiting for a websocket that disconnects
+        QVERIFY(filter.accept(1, "b", 3));
+        filter.setActive(0, false);
+        filter.setActive(0, true);
+        QVERIFY(filter.accept(0, "b", 4));
+        QCOMPARE(filter.duplicates(), qint64(0));
+    }
+
+    void expired()
+    {
+        DuplicateFilter filter;
+        filter.setActive(0, true);
+        filter.setActive(1, true);
+
+        // a frame only waits a second for the other websocket to receive it too
+        QVERIFY(filter.accept(0, "a", 1));
+        QVERIFY(filter.accept(0, "b", 2000000000));
+        QVERIFY(filter.accept(1, "a", 2000000001));
+        QVERIFY(!filter.accept(1, "b", 2000000002));
+    }
+};
+
+QTEST_GUILESS_MAIN(DuplicateFilterTest);
+#include "duplicatefilter.test.moc"
@@ -0,0 +1,152 @@
+#include "../../src/envelopescanner.h"
+#include "../../src/zbusevent.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QObject>
+#include <QtTest/QtTest>
+
+class EnvelopeScannerTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Text of the field, exactly as it appears in the JSON text.
+    static QByteArray raw(const QByteArray &text, const ZBusEnvelope::Field &field)
+    {
+        return text.mid(field.offset, field.size);
+    }
+
+    // Events as ZBusEvent serializes them (compact, with sorted keys), and as devices send them
+    // (the envelope first), plus one with a large payload.
+    static void payloads()
+    {
+        QTest::addColumn<QByteArray>("text");
+
+        QTest::newRow("device order")
+            << QByteArray("{\"event\": \"pinpad.paymentAccepted\", \"requestId\": \"request\", "
+                          "\"data\": {\"authAttemptId\": \"attempt\"}}");
+
+        QTest::newRow("pinpad.cardInfo")
+            << ZBusEvent(Mock::PinpadCardInfo, "request", "attempt").toUtf8Json();
+        QTest::newRow("pinpad.paymentAccepted")
+            << ZBusEvent(Mock::PinpadPaymentAccepted, "request", "attempt").toUtf8Json();
+        QTest::newRow("scanner.read") << ZBusEvent(Mock::ScannerRead, "request").toUtf8Json();
+        QTest::newRow("printer.drawerOpened")
+            << ZBusEvent(Mock::PrinterDrawerOpened).toUtf8Json();
+
+        QJsonArray items;
+        for (int i = 0; i < 1000; i++)
+        {
+            items.append(QJsonObject{{"sku", QString::number(i)}, {"name", "item \"" +
+                                     QString::number(i) + "\""}, {"price", i * 0.25}});
+        }
+        QTest::newRow("large")
+            << ZBusEvent("pinpad.displayItems", QJsonObject{{"items", items}}, "request")
+                   .toUtf8Json();
+    }
+
+private slots:
+    void fields()
+    {
+        QByteArray text = ZBusEvent(Mock::PinpadCardInfo, "request", "attempt").toUtf8Json();
+        ZBusEnvelope envelope;
+
+        QVERIFY(EnvelopeScanner::scan(text, envelope));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.event), QString("pinpad.cardInfo"));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.requestId), QString("request"));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.authAttemptId), QString("attempt"));
+        QCOMPARE(QJsonDocument::fromJson("[" + raw(text, envelope.data) + "]").array().at(0),
+                 QJsonDocument::fromJson(text).object().value("data"));
+    }
+
+    // Keys may come in any order, with any whitespace, next to values of any type.
+    void layout()
+    {
+        QByteArray text = " {\n\t\"requestId\" : \"r\" ,\"n\":-1.5e3, \"data\" : { \"list\" : [1, "
+                          "{\"authAttemptId\":\"nested\"}, \"]}\"], \"authAttemptId\":\"a\", "
+                          "\"ok\": true}, \"x\": null, \"event\":\"scanner.read\"}\r\n";
+        ZBusEnvelope envelope;
+
+        QVERIFY(EnvelopeScanner::scan(text, envelope));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.event), QString("scanner.read"));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.requestId), QString("r"));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.authAttemptId), QString("a"));
+        QVERIFY(raw(text, envelope.data).startsWith("{ \"list\""));
+        QVERIFY(raw(text, envelope.data).endsWith("true}"));
+    }
+
+    // Fields that are missing, or are not strings, are not present.
+    void missing()
+    {
+        QByteArray text = "{\"event\":1,\"data\":[\"authAttemptId\",\"a\"]}";
+        ZBusEnvelope envelope;
+
+        QVERIFY(EnvelopeScanner::scan(text, envelope));
+        QVERIFY(!envelope.event.isPresent());
+        QVERIFY(!envelope.requestId.isPresent());
+        QVERIFY(!envelope.authAttemptId.isPresent());
+        QCOMPARE(raw(text, envelope.data), QByteArray("[\"authAttemptId\",\"a\"]"));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.event), QString());
+    }
+
+    // Strings with escape sequences are decoded by the full parser.
+    void escaped()
+    {
+        QByteArray text = "{\"event\":\"a\\\"b\\u00e9\\\\\",\"requestId\":\"caf\xc3\xa9\"}";
+        ZBusEnvelope envelope;
+
+        QVERIFY(EnvelopeScanner::scan(text, envelope));
+        QVERIFY(envelope.event.escaped);
+        QVERIFY(!envelope.requestId.escaped);
+        QCOMPARE(EnvelopeScanner::string(text, envelope.event),
+                 QString::fromUtf8("a\"b\xc3\xa9\\"));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.requestId),
+                 QString::fromUtf8("caf\xc3\xa9"));
+    }
+
+    // Text with a broken structure is rejected, wherever the break is.
+    void invalid_data()
+    {
+        QTest::addColumn<QByteArray>("text");
+
+        QTest::newRow("empty") << QByteArray();
+        QTest::newRow("array") << QByteArray("[]");
+        QTest::newRow("unterminated string") << QByteArray("{\"event\":\"a}");
+        QTest::newRow("escaped quote") << QByteArray("{\"event\":\"a\\\"}");
+        QTest::newRow("unbalanced data") << QByteArray("{\"data\":{\"a\":[1,2}");
+        QTest::newRow("missing colon") << QByteArray("{\"event\" \"a\"}");
+        QTest::newRow("missing value") << QByteArray("{\"event\":}");
+        QTest::newRow("trailing text") << QByteArray("{} {}");
+    }
+
+    void invalid()
+    {
+        QFETCH(QByteArray, text);
+        ZBusEnvelope envelope;
+
+        QVERIFY(!EnvelopeScanner::scan(text, envelope));
+    }
+
+    // Every field found by the scanner is the one the full parser finds.
+    void parity_data()
+    {
+        payloads();
+    }
+
+    void parity()
+    {
+        QFETCH(QByteArray, text);
+        ZBusEnvelope envelope;
+        ZBusEvent event(QJsonDocument::fromJson(text).object());
+
+        QVERIFY(EnvelopeScanner::scan(text, envelope));
+        QCOMPARE(EnvelopeScanner::string(text, envelope.event), event.name());
+        QCOMPARE(EnvelopeScanner::string(text, envelope.requestId), event.requestId);
+        QCOMPARE(EnvelopeScanner::string(text, envelope.authAttemptId),
+                 event.data.toObject().value("authAttemptId").toString());
+    }
+};
+
+QTEST_GUILESS_MAIN(EnvelopeScannerTest);
+#include "envelopescanner.test.moc"
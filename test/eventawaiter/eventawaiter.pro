@@ -0,0 +1,7 @@
+QT += testlib websockets
+CONFIG += testcase
+
+LIBS += ../../eventawaiter.o
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += eventawaiter.test.cpp
@@ -0,0 +1,100 @@
+#include "../../src/broadcastserver.h"
+#include "../../src/envelopescanner.h"
+#include "../../src/eventawaiter.h"
+#include "../../src/zbusevent.h"
+#include "../../src/zwebsocket.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class EventAwaiterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void pattern()
+    {
+        EventAwaiter awaiter("pinpad.card*", 0);
+        QVERIFY(awaiter.isValid());
+        QVERIFY(awaiter.matches(ZBusEvent("pinpad.cardInserted")));
+        QVERIFY(awaiter.matches(ZBusEvent("pinpad.cardRemoved", QJsonValue(), "1234")));
+        QVERIFY(!awaiter.matches(ZBusEvent("pinpad.paymentAccepted")));
+        QVERIFY(!awaiter.matches(ZBusEvent("scanner.pinpad.cardInserted")));
+    }
+
+    void requestId()
+    {
+        EventAwaiter awaiter("pinpad.*", 0);
+        awaiter.recordSent(ZBusEvent("pinpad.preparePaymentRequest", QJsonValue(), "1234"), 0);
+        QVERIFY(awaiter.matches(ZBusEvent("pinpad.cardInfo", QJsonValue(), "1234")));
+        QVERIFY(!awaiter.matches(ZBusEvent("pinpad.cardInfo", QJsonValue(), "5678")));
+        QVERIFY(!awaiter.matches(ZBusEvent("pinpad.cardInfo")));
+    }
+
+    // The first copy received of each sent event is its echo, not a match; later copies match.
+    void echo()
+    {
+        EventAwaiter awaiter("pinpad.*", 0);
+        awaiter.recordSent(ZBusEvent("pinpad.cardInfo", QJsonValue(), "1234"), 0);
+        awaiter.recordSent(ZBusEvent("pinpad.cardInfo", QJsonValue(), "1234"), 0);
+        QVERIFY(!awaiter.matches(ZBusEvent("pinpad.cardInfo", QJsonValue(), "1234")));
+        QVERIFY(!awaiter.matches(ZBusEvent("pinpad.cardInfo", QJsonValue(), "1234")));
+        QVERIFY(awaiter.matches(ZBusEvent("pinpad.cardInfo", QJsonValue(), "1234")));
+    }
+
+    // An event sent through a server that broadcasts it back to its sender, like zBus, is not
+    // mistaken for the awaited event, but the response to it is.
+    void broadcastEcho()
+    {
+        BroadcastServer server;
+        QVERIFY(server.listen());
+
+        EventAwaiter awaiter("pinpad.*", 0);
+        QStringList matched;
+        ZWebSocket socket;
+        connect(&socket, &ZWebSocket::zBusEventSent,
+                [&] (const QByteArray &text, const ZBusEnvelope &envelope, qint64 timestamp)
+                {
+                    awaiter.recordSent(EnvelopeScanner::string(text, envelope.event),
+                                       EnvelopeScanner::string(text, envelope.requestId),
+                                       timestamp);
+                });
+        connect(&socket, &ZWebSocket::zBusEnvelopeReceived,
+                [&] (const QByteArray &text, const ZBusEnvelope &envelope, qint64)
+                {
+                    QString name = EnvelopeScanner::string(text, envelope.event);
+                    if (awaiter.matches(name, EnvelopeScanner::string(text, envelope.requestId)))
+                    {
+                        matched.append(name);
+                    }
+                });
+        QSignalSpy connected(&socket, &ZWebSocket::connected);
+        socket.open(server.url());
+        QVERIFY(connected.wait(5000));
+
+        ZWebSocket pinpad;
+        QSignalSpy pinpadConnected(&pinpad, &ZWebSocket::connected);
+        pinpad.open(server.url());
+        QVERIFY(pinpadConnected.wait(5000));
+
+        QSignalSpy received(&socket, &ZWebSocket::zBusEnvelopeReceived);
+        socket.sendZBusEvent(ZBusEvent("pinpad.preparePaymentRequest", QJsonValue(), "1234"));
+        QVERIFY(received.wait(5000));
+        QVERIFY(matched.isEmpty());
+
+        pinpad.sendZBusEvent(ZBusEvent("pinpad.paymentAccepted", QJsonValue(), "1234"));
+        QTRY_COMPARE(matched, QStringList({ "pinpad.paymentAccepted" }));
+    }
+
+    void latency()
+    {
+        EventAwaiter awaiter("scanner.read", 100);
+        QCOMPARE(awaiter.latency(250), qint64(150));
+
+        awaiter.recordSent(ZBusEvent("scanner.read"), 1000);
+        QCOMPARE(awaiter.latency(1250), qint64(250));
+    }
+};
+
+QTEST_GUILESS_MAIN(EventAwaiterTest);
+#include "eventawaiter.test.moc"
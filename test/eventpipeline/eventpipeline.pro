@@ -0,0 +1,7 @@
+QT += testlib
+CONFIG += testcase
+
+LIBS += ../../eventpipeline.o
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += eventpipeline.test.cpp
@@ -0,0 +1,136 @@
+#include "../../src/eventpipeline.h"
+
+#include <QJsonDocument>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+class EventPipelineTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // Stages run in order, and see the changes made by earlier stages.
+    void order()
+    {
+        QStringList seen;
+        EventPipeline pipeline;
+        pipeline.append("enricher", new EventSink([] (InboundEvent &inbound)
+        {
+            inbound.source = 2;
+        }));
+        pipeline.append("sink", new EventSink([&seen] (InboundEvent &inbound)
+        {
+            seen.append(inbound.name() + ":" + QString::number(inbound.source));
+        }));
+
+        QVector<InboundEvent> events = batch({ "scanner.read", "printer.stateUpdate" });
+        pipeline.process(events);
+
+        QCOMPARE(seen, QStringList({ "scanner.read:2", "printer.stateUpdate:2" }));
+    }
+
+    // Filters remove events from the batch, in place, keeping the order of the rest.
+    void filter()
+    {
+        QStringList seen;
+        EventPipeline pipeline;
+        pipeline.append("filter", new EventFilter([] (const InboundEvent &inbound)
+        {
+            return inbound.domain() != "scanner";
+        }));
+        pipeline.append("sink", new EventSink([&seen] (InboundEvent &inbound)
+        {
+            seen.append(inbound.name());
+        }));
+
+        QVector<InboundEvent> events = batch({ "scanner.read", "printer.stateUpdate",
+                                               "scanner.read", "pinpad.cardInfo" });
+        pipeline.process(events);
+
+        QCOMPARE(seen, QStringList({ "printer.stateUpdate", "pinpad.cardInfo" }));
+        QCOMPARE(events.size(), 2);
+    }
+
+    // Stages are counted per event and per batch; stages after an emptied batch are skipped.
+    void rows()
+    {
+        EventPipeline pipeline;
+        pipeline.append("filter", new EventFilter([] (const InboundEvent &inbound)
+        {
+            return inbound.domain() == "printer";
+        }));
+        pipeline.append("sink", new EventSink([] (InboundEvent &) {}));
+        pipeline.insert(0, "first", new EventSink([] (InboundEvent &) {}));
+
+        QVector<InboundEvent> events = batch({ "scanner.read", "printer.stateUpdate" });
+        pipeline.process(events);
+        events = batch({ "scanner.read" });
+        pipeline.process(events);
+
+        QVector<EventPipeline::Row> rows = pipeline.rows();
+        QCOMPARE(rows.size(), 3);
+        QCOMPARE(rows.at(0).name, QString("first"));
+        QCOMPARE(rows.at(0).events, qint64(3));
+        QCOMPARE(rows.at(0).batches, qint64(2));
+        QCOMPARE(rows.at(2).name, QString("sink"));
+        QCOMPARE(rows.at(2).events, qint64(1));
+        QCOMPARE(rows.at(2).batches, qint64(1));
+        QVERIFY(rows.at(2).max_batch_us >= 0);
+    }
+
+    // The recorder appends one line of compact JSON per event.
+    void recorder()
+    {
+        QTemporaryDir dir;
+        QString fileName = dir.filePath("events.jsonl");
+
+        EventPipeline pipeline;
+        pipeline.append("recorder", new RecorderSink(fileName));
+        QVector<InboundEvent> events = batch({ "scanner.read", "printer.stateUpdate" });
+        pipeline.process(events);
+
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QList<QByteArray> lines = file.readAll().split('\n');
+        QCOMPARE(lines.size(), 3);
+        QCOMPARE(ZBusEvent(QJsonDocument::fromJson(lines.at(1)).object()).name(),
+                 QString("printer.stateUpdate"));
+    }
+
+    // The envelope is read from the text as received, and the full event parsed only on request.
+    void envelope()
+    {
+        InboundEvent inbound = { 0, "{\"event\":\"pinpad.cardInfo\",\"requestId\":\"r\","
+                                    "\"data\":{\"authAttemptId\":\"a\",\"amount\":\"1.00\"}}",
+                                 ZBusEnvelope(), 42 };
+        QVERIFY(EnvelopeScanner::scan(inbound.text, inbound.envelope));
+        QCOMPARE(inbound.name(), QString("pinpad.cardInfo"));
+        QCOMPARE(inbound.domain(), QString("pinpad"));
+        QCOMPARE(inbound.requestId(), QString("r"));
+        QCOMPARE(inbound.authAttemptId(), QString("a"));
+
+        ZBusEvent event = inbound.event();
+        QCOMPARE(event.name(), QString("pinpad.cardInfo"));
+        QCOMPARE(event.data.toObject().value("amount").toString(), QString("1.00"));
+        QCOMPARE(event.timestamp, qint64(42));
+    }
+
+private:
+    QVector<InboundEvent> batch(const QStringList &names)
+    {
+        QVector<InboundEvent> events;
+        for (const QString &name : names)
+        {
+            InboundEvent inbound = { 0, ZBusEvent(name, QJsonObject()).toUtf8Json(),
+                                     ZBusEnvelope(), 10 };
+            EnvelopeScanner::scan(inbound.text, inbound.envelope);
+            events.append(inbound);
+        }
+
+        return events;
+    }
+};
+
+QTEST_GUILESS_MAIN(EventPipelineTest);
+#include "eventpipeline.test.moc"
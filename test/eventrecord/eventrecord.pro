@@ -0,0 +1,7 @@
+QT += testlib
+CONFIG += testcase
+
+LIBS += ../../eventrecord.o
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += eventrecord.test.cpp
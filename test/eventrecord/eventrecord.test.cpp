@@ -0,0 +1,104 @@
+#include "../../src/envelopescanner.h"
+#include "../../src/eventrecord.h"
+#include "../../src/zbusevent.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class EventRecordTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fields()
+    {
+        EventArena arena;
+        ZBusEvent event("scanner.read", QJsonObject{{"barcode", "12345"}}, "request");
+        QByteArray json = event.toUtf8Json();
+        EventRecord record = arena.create(1, 2, event.name(), 7, 42, json);
+
+        QCOMPARE(record.direction(), 1);
+        QCOMPARE(record.source(), 2);
+        QCOMPARE(record.name(), QString("scanner.read"));
+        QCOMPARE(record.hash(), uint(7));
+        QCOMPARE(record.timestamp(), qint64(42));
+        QCOMPARE(record.json(), json);
+        QCOMPARE(record.text(), event.toJson());
+        QCOMPARE(record.text(8), event.toJson().left(8));
+        QCOMPARE(record.data(), event.data);
+    }
+
+    // The key holds the name and data of the event, but not its requestId.
+    void key()
+    {
+        EventArena arena;
+        QByteArray first = ZBusEvent("scanner.read", QJsonObject{{"a", 1}}, "one").toUtf8Json();
+        QByteArray second = ZBusEvent("scanner.read", QJsonObject{{"a", 1}}, "two").toUtf8Json();
+        QByteArray third = ZBusEvent("scanner.read", QJsonObject{{"a", 2}}, "one").toUtf8Json();
+
+        EventRecord record = arena.create(0, 0, "scanner.read", 0, 0, first);
+        QCOMPARE(record.key(), second.left(EventRecord::keySize(second)));
+        QVERIFY(record.key() != third.left(EventRecord::keySize(third)));
+    }
+
+    // A received event is laid out from its envelope as ZBusEvent::toJson would lay it out, with
+    // its data as received.
+    void envelopeJson()
+    {
+        ZBusEvent event("pinpad.cardInfo", QJsonObject{{"amount", "1.00"}}, "request");
+        QByteArray text = "{\"requestId\":\"request\",\n \"event\":\"pinpad.cardInfo\","
+                          "\"data\":{\"amount\":\"1.00\"}}";
+        ZBusEnvelope envelope;
+        QVERIFY(EnvelopeScanner::scan(text, envelope));
+        QByteArray json = EventRecord::envelopeJson(text, envelope);
+        QCOMPARE(json, event.toUtf8Json());
+        QCOMPARE(json.left(EventRecord::keySize(json)),
+                 event.toUtf8Json().left(EventRecord::keySize(event.toUtf8Json())));
+
+        // string data keeps its quotes, and a missing requestId is empty, as in toJson
+        text = "{\"event\":\"scanner.read\",\"data\":\"0123\\n\"}";
+        QVERIFY(EnvelopeScanner::scan(text, envelope));
+        event = ZBusEvent(QJsonObject{{"event", "scanner.read"}, {"data", "0123\n"}});
+        QCOMPARE(EventRecord::envelopeJson(text, envelope), event.toUtf8Json());
+    }
+
+    // Lengths are counted in UTF-16 characters, as displayed.
+    void length()
+    {
+        EventArena arena;
+        QString text = QString::fromUtf8("{\"data\":\"caf\xc3\xa9 \xf0\x9f\x98\x80\"}");
+        EventRecord record = arena.create(0, 0, "", 0, 0, text.toUtf8());
+
+        QCOMPARE(record.length(), text.size());
+        QCOMPARE(record.text(), text);
+    }
+
+    // Records are shared by copying, and their slabs are freed with the last record in them.
+    void slabs()
+    {
+        int slabs = EventArena::slabs();
+        QByteArray json(200, 'x');
+        EventRecord kept;
+        {
+            EventArena arena(1024);
+            QVector<EventRecord> records;
+            for (int i = 0; i < 100; i++)
+            {
+                records.append(arena.create(0, 0, "scanner.read", 0, i, json));
+            }
+            QVERIFY(EventArena::slabs() - slabs > 10);
+
+            kept = records.at(50);
+        }
+
+        QCOMPARE(EventArena::slabs() - slabs, 1);
+        QCOMPARE(kept.timestamp(), qint64(50));
+
+        kept = EventRecord();
+        QVERIFY(kept.isNull());
+        QCOMPARE(EventArena::slabs(), slabs);
+    }
+};
+
+QTEST_GUILESS_MAIN(EventRecordTest);
+#include "eventrecord.test.moc"
@@ -0,0 +1,76 @@
+#include "../../src/eventstats.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+// nanoseconds per millisecond and second
+static const qint64 MS = 1000000;
+static const qint64 S = 1000 * MS;
+
+class EventStatsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rates()
+    {
+        EventStats stats;
+        for (int i = 0; i < 20; i++)
+        {
+            stats.record("scanner.read", 100, 10 * S + i * 100 * MS);
+        }
+        stats.record("printer.stateUpdate", 300, 11 * S);
+
+        QVector<EventStats::Row> rows = stats.rows(12 * S);
+        QCOMPARE(rows.size(), 2);
+        QCOMPARE(rows.at(0).name, QString("scanner.read"));
+        QCOMPARE(rows.at(0).rate_1s, 10.0);
+        QCOMPARE(rows.at(0).rate_10s, 2.0);
+        QCOMPARE(rows.at(0).count, qint64(20));
+        QCOMPARE(rows.at(1).max_size, 300);
+    }
+
+    // Events at a steady interval have no jitter, and the gap is the interval.
+    void steady()
+    {
+        EventStats stats;
+        for (int i = 0; i < 10; i++)
+        {
+            stats.record("scanner.read", 100, S + i * 50 * MS);
+        }
+
+        EventStats::Row row = stats.rows(2 * S).at(0);
+        QCOMPARE(row.gap_ms, 50.0);
+        QCOMPARE(row.jitter_ms, 0.0);
+    }
+
+    // Alternating gaps produce jitter that converges towards the difference between the gaps.
+    void jitter()
+    {
+        EventStats stats;
+        qint64 now = S;
+        for (int i = 0; i < 200; i++)
+        {
+            now += (i % 2 == 0) ? 40 * MS : 60 * MS;
+            stats.record("scanner.read", 100, now);
+        }
+
+        EventStats::Row row = stats.rows(now).at(0);
+        QVERIFY(qAbs(row.gap_ms - 50.0) < 0.2);
+        QVERIFY(qAbs(row.jitter_ms - 20.0) < 0.1);
+    }
+
+    // Only the gaps since the first event are measured.
+    void single()
+    {
+        EventStats stats;
+        stats.record("scanner.read", 100, S);
+
+        EventStats::Row row = stats.rows(2 * S).at(0);
+        QCOMPARE(row.gap_ms, 0.0);
+        QCOMPARE(row.jitter_ms, 0.0);
+    }
+};
+
+QTEST_GUILESS_MAIN(EventStatsTest);
+#include "eventstats.test.moc"
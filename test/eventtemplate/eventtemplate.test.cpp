@@ -0,0 +1,93 @@
+#include "../../src/eventtemplate.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QRegExp>
+#include <QtTest/QtTest>
+
+class EventTemplateTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void literal()
+    {
+        EventTemplate text("{\"event\":\"scanner.read\",\"data\":\"{{unknown}} {{seq:1}}\"}");
+        QVERIFY(text.isStatic());
+        QCOMPARE(text.expand(),
+                 QByteArray("{\"event\":\"scanner.read\",\"data\":\"{{unknown}} {{seq:1}}\"}"));
+    }
+
+    void sequence()
+    {
+        EventTemplate text("#{{seq}}#");
+        QVERIFY(!text.isStatic());
+        QCOMPARE(text.expand(), QByteArray("#1#"));
+        QCOMPARE(text.expand(), QByteArray("#2#"));
+        QCOMPARE(text.expand(), QByteArray("#3#"));
+    }
+
+    void amount()
+    {
+        EventTemplate text("{{amount:5-5.5}}");
+        QRegExp format("\\d+\\.\\d\\d");
+        for (int i = 0; i < 100; i++)
+        {
+            QString amount = QString::fromUtf8(text.expand());
+            QVERIFY(format.exactMatch(amount));
+            QVERIFY(amount.toDouble() >= 5 && amount.toDouble() <= 5.5);
+        }
+    }
+
+    void digits()
+    {
+        EventTemplate text("374245XXXXX{{digits:4}}");
+        QVERIFY(QRegExp("374245XXXXX\\d{4}").exactMatch(QString::fromUtf8(text.expand())));
+    }
+
+    void uuid()
+    {
+        EventTemplate text("{{uuid}}");
+        QRegExp format("[0-9a-f]{8}-[0-9a-f]{4}-4[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}");
+        QString first = QString::fromUtf8(text.expand());
+        QVERIFY(format.exactMatch(first));
+        QVERIFY(first != QString::fromUtf8(text.expand()));
+    }
+
+    // Templates built back to back, as temporaries in a loop, are not seeded alike.
+    void uuidPerTemplate()
+    {
+        QList<EventTemplate> templates;
+        for (int i = 0; i < 2; i++)
+        {
+            templates.append(EventTemplate("{{uuid}}"));
+        }
+        QVERIFY(templates[0].expand() != templates[1].expand());
+    }
+
+    void variable()
+    {
+        EventTemplate::setVariable("STORE_NUMBER", "0042");
+        EventTemplate text("900100{{var:STORE_NUMBER}}{{var:KPCOUNTER_ID}}");
+        QVERIFY(text.isStatic());
+        QCOMPARE(text.expand(), QByteArray("900100" "0042" "<KPCOUNTER_ID>"));
+    }
+
+    // Values are escaped, so a quote in a value does not end the string it is substituted into.
+    void escapedVariable()
+    {
+        EventTemplate::setVariable("NAME", "12\" Sub\\\n");
+        EventTemplate text("{\"event\":\"scanner.read\",\"data\":\"{{var:NAME}}\"}");
+        QByteArray json = text.expand();
+        QCOMPARE(json, QByteArray("{\"event\":\"scanner.read\",\"data\":\"12\\\" Sub\\\\\\n\"}"));
+
+        QJsonParseError error;
+        QJsonDocument document = QJsonDocument::fromJson(json, &error);
+        QCOMPARE(error.error, QJsonParseError::NoError);
+        QCOMPARE(document.object().value("data").toString(), QString("12\" Sub\\\n"));
+    }
+};
+
+QTEST_GUILESS_MAIN(EventTemplateTest);
+#include "eventtemplate.test.moc"
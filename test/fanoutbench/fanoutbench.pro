@@ -0,0 +1,8 @@
+QT += testlib websockets
+CONFIG += testcase
+
+LIBS += ../../fanoutbench.o
+LIBS += ../../moc_fanoutbench.o
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += fanoutbench.test.cpp
@@ -0,0 +1,86 @@
+#include "../../src/broadcastserver.h"
+#include "../../src/fanoutbench.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class FanoutBenchTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // Every probe reaches every subscriber of the stand-in, at each step.
+    void standIn()
+    {
+        BroadcastServer server;
+        QVERIFY(server.listen());
+        QCOMPARE(server.url().host(), QString("127.0.0.1"));
+
+        FanoutBench bench(server.url(), 2);
+        QSignalSpy finished(&bench, &FanoutBench::finished);
+        bench.start({ 3, 1 }, { 50 }, 200);
+
+        QVERIFY(finished.wait(15000));
+        QCOMPARE(finished.first().first().toBool(), true);
+
+        QVector<FanoutResult> results = bench.results();
+        QCOMPARE(results.size(), 2);
+        QCOMPARE(results.at(0).clients, 1);
+        QCOMPARE(results.at(1).clients, 3);
+        foreach (const FanoutResult &result, results)
+        {
+            QCOMPARE(result.rate, 50);
+            QCOMPARE(result.sent, qint64(10));
+            QCOMPARE(result.received, result.sent * result.clients);
+            QCOMPARE(result.loss, 0.0);
+            QVERIFY(result.p50 > 0);
+            QVERIFY(result.p50 <= result.p99 && result.p99 <= result.max);
+        }
+
+        // the publisher and the subscribers are all clients of the stand-in
+        QCOMPARE(server.clientCount(), 4);
+    }
+
+    // A benchmark against a server that is not there gives up once the subscribers fail to connect.
+    void refused()
+    {
+        QUrl url;
+        {
+            BroadcastServer server;
+            QVERIFY(server.listen());
+            url = server.url();
+        }
+
+        FanoutBench bench(url, 1);
+        QSignalSpy finished(&bench, &FanoutBench::finished);
+        bench.setConnectTimeout(200);
+        bench.start({ 1 }, { 10 }, 100);
+
+        QVERIFY(finished.wait(5000));
+        QCOMPARE(finished.first().first().toBool(), false);
+        QVERIFY(bench.results().isEmpty());
+    }
+
+    void format()
+    {
+        FanoutResult result;
+        result.clients = 10;
+        result.rate = 100;
+        result.connected = 9;
+        result.sent = 500;
+        result.received = 4500;
+        result.loss = 0.1;
+        result.worstLoss = 1;
+        result.p50 = 412000;
+        result.p99 = 1301000;
+        result.max = 3020000;
+        result.worstP99 = 1870000;
+        QCOMPARE(FanoutBench::format(result),
+                 QString("clients 10, rate 100/s: sent 500, received 4500 (loss 10.00%, worst "
+                         "100.00%), latency p50 0.412 ms, p99 1.301 ms, max 3.020 ms, worst p99 "
+                         "1.870 ms, 1 disconnected"));
+    }
+};
+
+QTEST_GUILESS_MAIN(FanoutBenchTest);
+#include "fanoutbench.test.moc"
@@ -0,0 +1,6 @@
+QT += testlib
+CONFIG += testcase
+
+LIBS += ../../heightindex.o
+
+SOURCES += heightindex.test.cpp
@@ -0,0 +1,136 @@
+#include "../../src/heightindex.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class HeightIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void height()
+    {
+        HeightIndex index(10);
+        index.append(1);
+        index.append(10);
+        index.append(11);
+        index.append(25);
+        QCOMPARE(index.height(0), 1);
+        QCOMPARE(index.height(1), 1);
+        QCOMPARE(index.height(2), 2);
+        QCOMPARE(index.height(3), 3);
+    }
+
+    void rowsBefore()
+    {
+        HeightIndex index(10);
+        for (int length : lengths)
+        {
+            index.append(length);
+        }
+
+        qint64 rows = 0;
+        for (int i = 0; i < lengths.size(); i++)
+        {
+            QCOMPARE(index.rowsBefore(i), rows);
+            rows += index.height(i);
+        }
+        QCOMPARE(index.rowsBefore(lengths.size()), rows);
+    }
+
+    void indexAtRow()
+    {
+        HeightIndex index(10);
+        for (int length : lengths)
+        {
+            index.append(length);
+        }
+
+        qint64 row = 0;
+        for (int i = 0; i < lengths.size(); i++)
+        {
+            for (int j = 0; j < index.height(i); j++)
+            {
+                QCOMPARE(index.indexAtRow(row++), i);
+            }
+        }
+        QCOMPARE(index.indexAtRow(row), lengths.size());
+        QCOMPARE(index.indexAtRow(-1), 0);
+    }
+
+    void update()
+    {
+        HeightIndex index(10);
+        for (int length : lengths)
+        {
+            index.append(length);
+        }
+
+        index.update(3, 95);
+        QCOMPARE(index.height(3), 10);
+        QCOMPARE(index.rowsBefore(4), index.rowsBefore(3) + 10);
+        QCOMPARE(index.indexAtRow(index.rowsBefore(3) + 9), 3);
+    }
+
+    // After the width changes, the index must answer queries correctly before, during, and after
+    // the tree is rebuilt.
+    void rebuild()
+    {
+        HeightIndex expected(7);
+        HeightIndex index(10);
+        for (int length : lengths)
+        {
+            expected.append(length);
+            index.append(length);
+        }
+
+        index.setColumns(7);
+        QVERIFY(index.isRebuilding());
+        compare(index, expected);
+        while (!index.rebuild(3))
+        {
+            compare(index, expected);
+        }
+        QVERIFY(!index.isRebuilding());
+        compare(index, expected);
+    }
+
+    // Padding is added to the printed length of every event.
+    void padding()
+    {
+        HeightIndex index(10);
+        for (int length : lengths)
+        {
+            index.append(length);
+        }
+
+        index.setPadding(5);
+        index.rebuild(lengths.size());
+        QCOMPARE(index.height(0), 1);
+        QCOMPARE(index.height(1), 3);
+        QCOMPARE(index.height(4), 2);
+        QCOMPARE(index.height(5), 2);
+
+        HeightIndex expected(10);
+        for (int length : lengths)
+        {
+            expected.append(length + 5);
+        }
+        compare(index, expected);
+    }
+
+    private:
+    void compare(const HeightIndex &index, const HeightIndex &expected)
+    {
+        for (int i = 0; i <= lengths.size(); i++)
+        {
+            QCOMPARE(index.rowsBefore(i), expected.rowsBefore(i));
+            QCOMPARE(index.indexAtRow(expected.rowsBefore(i)), i);
+        }
+    }
+
+    const QVector<int> lengths{ 3, 17, 1, 40, 9, 10, 11, 120, 5, 33, 64, 2, 80, 7, 19, 21, 100 };
+};
+
+QTEST_GUILESS_MAIN(HeightIndexTest);
+#include "heightindex.test.moc"
@@ -0,0 +1,6 @@
+QT += testlib
+CONFIG += testcase
+
+LIBS += ../../jsontree.o
+
+SOURCES += jsontree.test.cpp
@@ -0,0 +1,159 @@
+#include "../../src/jsontree.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QtTest/QtTest>
+
+class JsonTreeTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    // {"a": 1, "b": {"c": "x", "d": [true, null]}, "e": 2.5}, whose keys are displayed sorted.
+    static QJsonValue value()
+    {
+        return QJsonObject{ { "e", 2.5 }, { "a", 1 },
+                            { "b", QJsonObject{ { "c", "x" },
+                                                { "d", QJsonArray{ true, QJsonValue() } } } } };
+    }
+
+    // Text of every line of the tree.
+    static QStringList lines(JsonTree &tree)
+    {
+        QStringList lines;
+        for (int i = 0; i < tree.lineCount(); i++)
+        {
+            lines.append(tree.line(i));
+        }
+        return lines;
+    }
+
+private slots:
+    // Only the first level of the root is displayed at first.
+    void root()
+    {
+        JsonTree tree(value());
+        QCOMPARE(lines(tree), QStringList({ "- data: {} 3 keys",
+                                            "    a: 1",
+                                            "  + b: {} 2 keys",
+                                            "    e: 2.5" }));
+
+        JsonTree scalar(QJsonValue("x"));
+        scalar.expand(0);
+        QCOMPARE(lines(scalar), QStringList({ "  data: \"x\"" }));
+    }
+
+    void expand()
+    {
+        JsonTree tree(value());
+        tree.expand(2);
+        tree.expand(4);
+        QCOMPARE(lines(tree), QStringList({ "- data: {} 3 keys",
+                                            "    a: 1",
+                                            "  - b: {} 2 keys",
+                                            "      c: \"x\"",
+                                            "    - d: [] 2 items",
+                                            "        [0]: true",
+                                            "        [1]: null",
+                                            "    e: 2.5" }));
+
+        // expanding a value that is not an object or an array, or is expanded already, does nothing
+        tree.expand(1);
+        tree.expand(2);
+        QCOMPARE(tree.lineCount(), 8);
+    }
+
+    // Collapsing a node hides its descendants, and re-expanding it displays them as they were.
+    void collapse()
+    {
+        JsonTree tree(value());
+        tree.expand(2);
+        tree.expand(4);
+
+        tree.collapse(2);
+        QCOMPARE(lines(tree), QStringList({ "- data: {} 3 keys",
+                                            "    a: 1",
+                                            "  + b: {} 2 keys",
+                                            "    e: 2.5" }));
+
+        tree.toggle(2);
+        QCOMPARE(tree.lineCount(), 8);
+        QCOMPARE(tree.line(2), QString("  - b: {} 2 keys"));
+        QCOMPARE(tree.line(4), QString("    - d: [] 2 items"));
+        QCOMPARE(tree.line(6), QString("        [1]: null"));
+
+        tree.toggle(0);
+        QCOMPARE(lines(tree), QStringList({ "+ data: {} 3 keys" }));
+    }
+
+    // The cursor stops at the first and last lines.
+    void moveCursor()
+    {
+        JsonTree tree(value());
+        QCOMPARE(tree.cursor(), 0);
+        tree.moveCursor(2);
+        QCOMPARE(tree.cursor(), 2);
+        tree.moveCursor(100);
+        QCOMPARE(tree.cursor(), 3);
+        tree.moveCursor(-100);
+        QCOMPARE(tree.cursor(), 0);
+    }
+
+    // A cursor below a collapsed node stays on its line, and a cursor inside it moves to the node.
+    void cursorAcrossCollapse()
+    {
+        JsonTree tree(value());
+        tree.expand(2);
+        tree.expand(4);
+
+        tree.moveCursor(7);
+        tree.collapse(2);
+        QCOMPARE(tree.cursor(), 3);
+        QCOMPARE(tree.line(tree.cursor()), QString("    e: 2.5"));
+
+        tree.expand(2);
+        tree.moveCursor(2);
+        QCOMPARE(tree.line(tree.cursor()), QString("        [0]: true"));
+        tree.collapse(2);
+        QCOMPARE(tree.cursor(), 2);
+
+        // the cursor above a collapsed node does not move
+        tree.expand(2);
+        tree.moveCursor(-1);
+        tree.collapse(2);
+        QCOMPARE(tree.cursor(), 1);
+    }
+
+    // The tree scrolls as little as possible to keep the cursor in the pane.
+    void scrollTo()
+    {
+        JsonTree tree(value());
+        tree.expand(2);
+        tree.expand(4);
+        QCOMPARE(tree.scrollTo(3), 0);
+
+        tree.moveCursor(2);
+        QCOMPARE(tree.scrollTo(3), 0);
+        tree.moveCursor(3);
+        QCOMPARE(tree.scrollTo(3), 3);
+        tree.moveCursor(100);
+        QCOMPARE(tree.scrollTo(3), 5);
+        tree.moveCursor(-2);
+        QCOMPARE(tree.scrollTo(3), 5);
+        tree.moveCursor(-3);
+        QCOMPARE(tree.scrollTo(3), 2);
+
+        // a pane with no rows does not scroll, and a collapse above the top scrolls back to it
+        tree.moveCursor(7);
+        QCOMPARE(tree.scrollTo(3), 5);
+        QCOMPARE(tree.scrollTo(0), 5);
+        tree.moveCursor(-2);
+        tree.collapse(2);
+        QCOMPARE(tree.cursor(), 2);
+        QCOMPARE(tree.scrollTo(3), 2);
+    }
+};
+
+QTEST_GUILESS_MAIN(JsonTreeTest);
+#include "jsontree.test.moc"
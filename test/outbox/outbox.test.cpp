@@ -0,0 +1,126 @@
+#include "../../src/outbox.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+class OutboxTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    static ZBusEvent event(int i)
+    {
+        return ZBusEvent("scanner.read", QJsonObject{{"barcode", i}}, QString::number(i));
+    }
+
+private slots:
+    // Events that were not delivered are loaded again, in order, with their sequence numbers.
+    void replay()
+    {
+        QTemporaryDir directory;
+        QString path = directory.filePath("outbox");
+        {
+            Outbox outbox;
+            QVERIFY(outbox.open(path));
+            for (int i = 1; i <= 5; i++)
+            {
+                QCOMPARE(outbox.append(event(i)), quint64(i));
+            }
+            outbox.markDelivered(2);
+        }
+
+        Outbox outbox;
+        QVERIFY(outbox.open(path));
+        QVector<OutboxEntry> pending = outbox.pending();
+        QCOMPARE(pending.size(), 3);
+        for (int i = 0; i < pending.size(); i++)
+        {
+            QCOMPARE(pending[i].sequence, quint64(i + 3));
+            QCOMPARE(pending[i].json, event(i + 3).toUtf8Json());
+        }
+
+        // new events follow the ones that were loaded
+        QCOMPARE(outbox.append(event(6)), quint64(6));
+    }
+
+    // The log is truncated once every event in it is delivered.
+    void emptied()
+    {
+        QTemporaryDir directory;
+        QString path = directory.filePath("outbox");
+        Outbox outbox;
+        QVERIFY(outbox.open(path));
+        QSignalSpy spy(&outbox, &Outbox::emptied);
+
+        outbox.append(event(1));
+        outbox.append(event(2));
+        outbox.markDelivered(1);
+        QCOMPARE(spy.count(), 0);
+        QVERIFY(QFileInfo(path).size() > 0);
+
+        outbox.markDelivered(2);
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(outbox.pendingCount(), 0);
+        QCOMPARE(QFileInfo(path).size(), qint64(0));
+    }
+
+    // A record torn by a crash mid-write, and everything after it, is discarded.
+    void torn()
+    {
+        QTemporaryDir directory;
+        QString path = directory.filePath("outbox");
+        {
+            Outbox outbox;
+            QVERIFY(outbox.open(path));
+            outbox.append(event(1));
+            outbox.append(event(2));
+        }
+
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::Append));
+        file.write("+3 {\"data\":");
+        file.close();
+
+        Outbox outbox;
+        QVERIFY(outbox.open(path));
+        QCOMPARE(outbox.pendingCount(), 2);
+        QCOMPARE(outbox.append(event(3)), quint64(3));
+        outbox.close();
+
+        QVERIFY(outbox.open(path));
+        QVector<OutboxEntry> pending = outbox.pending();
+        QCOMPARE(pending.size(), 3);
+        QCOMPARE(pending.last().json, event(3).toUtf8Json());
+    }
+
+    // A log that grows large while events are pending is rewritten with just the pending ones.
+    void compaction()
+    {
+        QTemporaryDir directory;
+        QString path = directory.filePath("outbox");
+        Outbox outbox;
+        QVERIFY(outbox.open(path));
+
+        QByteArray padding(1000, 'x');
+        outbox.append(ZBusEvent("scanner.read", QJsonObject{{"padding", QString(padding)}}));
+        for (int i = 2; i <= 2000; i++)
+        {
+            outbox.append(ZBusEvent("scanner.read", QJsonObject{{"padding", QString(padding)}}));
+            outbox.markDelivered(i - 1);
+        }
+
+        QVERIFY(QFileInfo(path).size() < 1 << 20);
+        QCOMPARE(outbox.pendingCount(), 1);
+        outbox.close();
+
+        QVERIFY(outbox.open(path));
+        QCOMPARE(outbox.pendingCount(), 1);
+        QCOMPARE(outbox.pending().first().sequence, quint64(2000));
+    }
+};
+
+QTEST_GUILESS_MAIN(OutboxTest);
+#include "outbox.test.moc"
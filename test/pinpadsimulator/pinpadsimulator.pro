@@ -0,0 +1,8 @@
+QT += testlib
+CONFIG += testcase
+
+LIBS += ../../moc_pinpadsimulator.o
+LIBS += ../../pinpadsimulator.o
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += pinpadsimulator.test.cpp
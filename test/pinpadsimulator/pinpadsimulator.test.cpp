@@ -0,0 +1,126 @@
+#include "../../src/pinpadsimulator.h"
+#include "../../src/virtualclock.h"
+#include "../../src/zbusevent.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+/* A response of the simulator, with the virtual time it was sent at, in ms.
+ */
+struct Response
+{
+    qint64 time;
+    int source;
+    Mock mock;
+
+    bool operator==(const Response &other) const
+    {
+        return time == other.time && source == other.source && mock == other.mock;
+    }
+};
+
+class PinpadSimulatorTest : public QObject
+{
+    Q_OBJECT
+
+    VirtualClock *clock = nullptr;
+    PinpadSimulator *simulator = nullptr;
+    QVector<Response> responses;
+
+    /* \brief Runs a full payment flow on the given zBus server: POS connects, then prepares,
+     *        authorizes, and finishes a payment, each request sent as soon as the responses to the
+     *        one before it are.
+     */
+    void runPaymentFlow(int source)
+    {
+        simulator->handle(ZBusEvent("pos.connected"), source);
+        clock->advance(100);
+        simulator->handle(ZBusEvent("pinpad.preparePaymentRequest"), source);
+        clock->advance(5000);
+        simulator->handle(ZBusEvent("pinpad.authorizePaymentRequest"), source);
+        clock->advance(100);
+        simulator->handle(ZBusEvent("pinpad.finishPaymentRequest"), source);
+        clock->advance(100);
+    }
+
+private slots:
+    void init()
+    {
+        clock = new VirtualClock(0);
+        simulator = new PinpadSimulator();
+        simulator->setScheduler(clock);
+        responses.clear();
+        connect(simulator, &PinpadSimulator::responded,
+                [this] (int source, Mock mock)
+                {
+                    responses.append({ clock->now() / 1000000, source, mock });
+                });
+    }
+
+    void cleanup()
+    {
+        delete simulator;
+        delete clock;
+    }
+
+    // Every response of a payment flow is sent, in order, once its delay has passed.
+    void paymentFlow()
+    {
+        runPaymentFlow(1);
+
+        QVector<Response> expected = {
+            { 100, 1, Mock::PinpadDisplayItemSuccess },
+            { 5100, 1, Mock::PinpadCardInserted },
+            { 5100, 1, Mock::PinpadCardInfo },
+            { 5200, 1, Mock::PinpadPaymentAccepted },
+            { 5200, 1, Mock::PinpadCardRemoved },
+            { 5300, 1, Mock::PinpadFinishPaymentRequest }
+        };
+        QCOMPARE(responses, expected);
+        QCOMPARE(clock->pendingCount(), 0);
+    }
+
+    // POS is not sent the card until it has had 5 seconds to prepare for it.
+    void cardDelay()
+    {
+        simulator->handle(ZBusEvent("pinpad.preparePaymentRequest"), 0);
+        clock->advance(4999);
+        QVERIFY(responses.isEmpty());
+        clock->advance(1);
+        QCOMPARE(responses.size(), 2);
+    }
+
+    // Events that are not requests to the pinpad are not responded to.
+    void ignored()
+    {
+        simulator->handle(ZBusEvent("scanner.read"), 0);
+        simulator->handle(ZBusEvent("pinpad.cardInserted"), 0);
+        QCOMPARE(clock->pendingCount(), 0);
+    }
+
+    // Responses that are not due yet are dropped with the simulator.
+    void destroyed()
+    {
+        simulator->handle(ZBusEvent("pinpad.preparePaymentRequest"), 0);
+        delete simulator;
+        simulator = nullptr;
+        clock->advance(5000);
+        QVERIFY(responses.isEmpty());
+    }
+
+    // Hours of payment flows, interleaved across two servers, run without waiting on real time.
+    void manyFlows()
+    {
+        for (int flow = 0; flow < 1000; flow++)
+        {
+            runPaymentFlow(flow % 2);
+        }
+
+        QCOMPARE(responses.size(), 6000);
+        QCOMPARE(responses.last().time, qint64(1000 * 5300));
+        QCOMPARE(responses.last().source, 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(PinpadSimulatorTest);
+#include "pinpadsimulator.test.moc"
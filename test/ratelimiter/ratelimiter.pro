@@ -0,0 +1,6 @@
+QT += testlib
+CONFIG += testcase
+
+LIBS += ../../ratelimiter.o
+
+SOURCES += ratelimiter.test.cpp
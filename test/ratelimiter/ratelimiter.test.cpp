@@ -0,0 +1,98 @@
+#include "../../src/ratelimiter.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class RateLimiterTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Number of the given events with the key that are allowed through, all at the given time.
+    static int allowed(RateLimiter &limiter, const QString &key, int events, qint64 now)
+    {
+        int allowed = 0;
+        for (int i = 0; i < events; i++)
+        {
+            allowed += limiter.allow(key, now) ? 1 : 0;
+        }
+        return allowed;
+    }
+
+private slots:
+    // Without a rate, every event is allowed through.
+    void disabled()
+    {
+        RateLimiter limiter;
+        QVERIFY(!limiter.isEnabled());
+        QCOMPARE(allowed(limiter, "scanner.read", 1000, 0), 1000);
+        QCOMPARE(limiter.suppressed(), qint64(0));
+        QCOMPARE(limiter.summary(), QString());
+    }
+
+    // A burst is allowed through at once, and the events after it are suppressed.
+    void burst()
+    {
+        RateLimiter limiter(2, 5);
+        QVERIFY(limiter.isEnabled());
+        QCOMPARE(allowed(limiter, "scanner.read", 8, 0), 5);
+        QCOMPARE(limiter.suppressed(), qint64(3));
+
+        // without a burst, one second's worth of events, and at least one, is allowed at once
+        RateLimiter second(3);
+        QCOMPARE(allowed(second, "scanner.read", 8, 0), 3);
+        RateLimiter slow(0.5);
+        QCOMPARE(allowed(slow, "scanner.read", 8, 0), 1);
+    }
+
+    // The bucket refills at the rate, over time, up to the burst.
+    void refill()
+    {
+        RateLimiter limiter(2, 5);
+        QCOMPARE(allowed(limiter, "scanner.read", 5, 0), 5);
+
+        QCOMPARE(allowed(limiter, "scanner.read", 3, 250), 0);
+        QCOMPARE(allowed(limiter, "scanner.read", 3, 500), 1);
+        QCOMPARE(allowed(limiter, "scanner.read", 3, 1500), 2);
+        QCOMPARE(allowed(limiter, "scanner.read", 10, 60000), 5);
+
+        // a lower limit applies as the bucket is next refilled
+        limiter.setRate(1, 2);
+        QCOMPARE(allowed(limiter, "scanner.read", 10, 120000), 2);
+    }
+
+    // Each key has a bucket of its own: with event names as keys, a flood of one event does not
+    // suppress another, while with domains as keys, events of a domain share their bucket.
+    void keys()
+    {
+        RateLimiter names(1, 1);
+        QCOMPARE(allowed(names, "scanner.read", 3, 0), 1);
+        QCOMPARE(allowed(names, "scanner.error", 3, 0), 1);
+        QCOMPARE(allowed(names, "printer.stateUpdate", 3, 0), 1);
+        QCOMPARE(names.suppressed(), qint64(6));
+
+        RateLimiter domains(1, 1);
+        QCOMPARE(allowed(domains, "scanner", 3, 0), 1);
+        QCOMPARE(allowed(domains, "scanner", 3, 0), 0);
+        QCOMPARE(allowed(domains, "printer", 3, 0), 1);
+        QCOMPARE(domains.suppressed(), qint64(7));
+        QCOMPARE(domains.summary(), QString("scanner: 5 suppressed, printer: 2 suppressed"));
+    }
+
+    // Keys are summarized from the most suppressed to the least, with grouped counts, and keys
+    // that were never suppressed are left out.
+    void summary()
+    {
+        RateLimiter limiter(1, 1);
+        allowed(limiter, "printer.stateUpdate", 13, 0);
+        allowed(limiter, "scanner.read", 4813, 0);
+        allowed(limiter, "pinpad.cardInfo", 1, 0);
+
+        QCOMPARE(limiter.suppressed(), qint64(4824));
+        QCOMPARE(limiter.summary(),
+                 QString("scanner.read: 4,812 suppressed, printer.stateUpdate: 12 suppressed"));
+    }
+};
+
+QTEST_GUILESS_MAIN(RateLimiterTest);
+#include "ratelimiter.test.moc"
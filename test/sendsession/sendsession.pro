@@ -0,0 +1,8 @@
+QT += testlib websockets
+CONFIG += testcase
+
+LIBS += ../../moc_sendsession.o
+LIBS += ../../sendsession.o
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += sendsession.test.cpp
@@ -0,0 +1,70 @@
+#include "../../src/sendsession.h"
+#include "../../src/zbusevent.h"
+#include "../../src/zclock.h"
+#include "../../src/zwebsocket.h"
+
+#include <QObject>
+#include <QWebSocketServer>
+#include <QtTest/QtTest>
+
+class SendSessionTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // Every queued event reaches the server before the session finishes, and every phase is timed.
+    void delivered()
+    {
+        QWebSocketServer server("zbus", QWebSocketServer::NonSecureMode);
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        QStringList received;
+        connect(&server, &QWebSocketServer::newConnection,
+                [&server, &received]
+                {
+                    QWebSocket *client = server.nextPendingConnection();
+                    connect(client, &QWebSocket::textMessageReceived,
+                            [&received] (const QString &message) { received.append(message); });
+                    connect(client, &QWebSocket::disconnected, client, &QObject::deleteLater);
+                });
+
+        ZWebSocket socket;
+        SendSession session(&socket);
+        QSignalSpy finished(&session, &SendSession::finished);
+        for (int i = 0; i < 100; i++)
+        {
+            socket.sendZBusEvent(ZBusEvent("scanner.read", QJsonObject{{"barcode", i}}));
+        }
+        session.start(server.serverUrl(), ZClock::now());
+
+        QVERIFY(finished.wait(5000));
+        QCOMPARE(finished.first().first().toBool(), true);
+        QTRY_COMPARE(received.size(), 100);
+        QCOMPARE(received.last(), ZBusEvent("scanner.read", QJsonObject{{"barcode", 99}}).toJson());
+        for (int phase = 0; phase < SendSession::PhaseCount; phase++)
+        {
+            QVERIFY(session.duration(SendSession::Phase(phase)) >= 0);
+        }
+    }
+
+    // A session that cannot connect finishes at once, without delivering its events.
+    void refused()
+    {
+        QWebSocketServer server("zbus", QWebSocketServer::NonSecureMode);
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        QUrl url = server.serverUrl();
+        server.close();
+
+        ZWebSocket socket;
+        SendSession session(&socket);
+        QSignalSpy finished(&session, &SendSession::finished);
+        socket.sendZBusEvent(ZBusEvent("scanner.read"));
+        session.start(url, ZClock::now());
+
+        QVERIFY(finished.wait(5000));
+        QCOMPARE(finished.first().first().toBool(), false);
+        QCOMPARE(session.duration(SendSession::Send), qint64(-1));
+    }
+};
+
+QTEST_GUILESS_MAIN(SendSessionTest);
+#include "sendsession.test.moc"
@@ -0,0 +1,134 @@
+#include "../../src/shmring.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class ShmRingTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init()
+    {
+        name = QString("zbus-cli-ent-test-%1").arg(getpid());
+        QVERIFY(ring.open(name, 4096));
+        QVERIFY(reader.open(name));
+    }
+
+    void cleanup()
+    {
+        reader.close();
+        ring.close();
+    }
+
+    // Frames are read in place, in order, with their sequence numbers and timestamps.
+    void roundTrip()
+    {
+        ShmRingReader::Frame frame;
+        QVERIFY(!reader.next(frame));
+
+        ring.publish("{\"event\":\"scanner.read\"}", 1000);
+        ring.publish("{\"event\":\"printer.stateUpdate\"}", 2000);
+
+        QVERIFY(reader.next(frame));
+        QCOMPARE(QByteArray(frame.data, frame.length), QByteArray("{\"event\":\"scanner.read\"}"));
+        QCOMPARE(frame.sequence, quint64(1));
+        QCOMPARE(frame.timestamp, qint64(1000));
+        QVERIFY(reader.isIntact(frame));
+
+        QVERIFY(reader.next(frame));
+        QCOMPARE(frame.sequence, quint64(2));
+        QVERIFY(!reader.next(frame));
+    }
+
+    // Frames of varying lengths wrap around the end of the ring without being split.
+    void wrap()
+    {
+        ShmRingReader::Frame frame;
+        quint64 expected = 1;
+        for (int i = 0; i < 1000; i++)
+        {
+            ring.publish(QByteArray(1 + (i * 37) % 300, 'a' + i % 26), i);
+            while (reader.next(frame))
+            {
+                QCOMPARE(frame.sequence, expected++);
+                QCOMPARE(frame.length, 1 + int(frame.timestamp * 37) % 300);
+                QCOMPARE(frame.data[frame.length - 1], char('a' + frame.timestamp % 26));
+            }
+        }
+
+        QCOMPARE(expected, quint64(1001));
+        QCOMPARE(reader.overruns(), quint64(0));
+    }
+
+    // A reader lapped by the writer skips ahead, and a frame it held is no longer intact.
+    void overrun()
+    {
+        ShmRingReader::Frame frame;
+        ring.publish("held", 0);
+        QVERIFY(reader.next(frame));
+
+        for (int i = 0; i < 100; i++)
+        {
+            ring.publish(QByteArray(200, 'x'), i);
+        }
+
+        QVERIFY(!reader.isIntact(frame));
+        QVERIFY(!reader.next(frame));
+        QCOMPARE(reader.overruns(), quint64(1));
+
+        ring.publish("after", 0);
+        QVERIFY(reader.next(frame));
+        QCOMPARE(frame.sequence, quint64(102));
+    }
+
+    // Frames larger than half the ring are dropped.
+    void oversized()
+    {
+        ShmRingReader::Frame frame;
+        ring.publish(QByteArray(3000, 'x'), 0);
+        QCOMPARE(ring.dropped(), quint64(1));
+        QVERIFY(!reader.next(frame));
+    }
+
+    // The ring is only accessible to its owner, even if it takes over an object left readable to
+    // others, e.g. by an older version.
+    void ownerOnly()
+    {
+        struct stat status;
+        int fd = shm_open(("/" + name).toUtf8().constData(), O_RDONLY, 0);
+        QVERIFY(fd != -1);
+        QCOMPARE(fstat(fd, &status), 0);
+        QCOMPARE(status.st_mode & 0777, mode_t(0600));
+        close(fd);
+
+        QByteArray stale = ("/" + name + "-stale").toUtf8();
+        fd = shm_open(stale.constData(), O_CREAT | O_RDWR, 0644);
+        QVERIFY(fd != -1);
+        QCOMPARE(fchmod(fd, 0644), 0);
+        ShmRing other;
+        QVERIFY(other.open(name + "-stale", 4096));
+        QCOMPARE(fstat(fd, &status), 0);
+        QCOMPARE(status.st_mode & 0777, mode_t(0600));
+        close(fd);
+    }
+
+    void notARing()
+    {
+        ShmRingReader other;
+        QVERIFY(!other.open(name + "-missing"));
+        QVERIFY(!other.errorString().isEmpty());
+    }
+
+private:
+    QString name;
+    ShmRing ring;
+    ShmRingReader reader;
+};
+
+QTEST_GUILESS_MAIN(ShmRingTest);
+#include "shmring.test.moc"
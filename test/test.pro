@@ -1,6 +1,23 @@
-QT += testlib
-CONFIG += testcase
+TEMPLATE = subdirs
 
-LIBS += ../zbusevent.o
-
-SOURCES += zbusevent.test.cpp
+SUBDIRS += decodepool
+SUBDIRS += duplicatefilter
+SUBDIRS += envelopescanner
+SUBDIRS += eventawaiter
+SUBDIRS += eventpipeline
+SUBDIRS += eventrecord
+SUBDIRS += eventstats
+SUBDIRS += eventtemplate
+SUBDIRS += fanoutbench
+SUBDIRS += heightindex
+SUBDIRS += jsontree
+SUBDIRS += outbox
+SUBDIRS += pinpadsimulator
+SUBDIRS += ratelimiter
+SUBDIRS += sendsession
+SUBDIRS += shmring
+SUBDIRS += virtualclock
+SUBDIRS += zbusevent
+SUBDIRS += zconnection
+SUBDIRS += zdaemon
+SUBDIRS += zwebsocket
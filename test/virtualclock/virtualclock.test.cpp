@@ -0,0 +1,72 @@
+#include "../../src/virtualclock.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class VirtualClockTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // Tasks run when they fall due, in order, with the time set to when each was due.
+    void advance()
+    {
+        VirtualClock clock;
+        QObject context;
+        QVector<QPair<QString, qint64>> runs;
+        clock.schedule(500, &context, [&] { runs.append({ "b", clock.now() }); });
+        clock.schedule(100, &context, [&] { runs.append({ "a", clock.now() }); });
+        clock.schedule(500, &context, [&] { runs.append({ "c", clock.now() }); });
+        QCOMPARE(clock.pendingCount(), 3);
+
+        clock.advance(99);
+        QVERIFY(runs.isEmpty());
+        clock.advance(1);
+        QCOMPARE(runs.size(), 1);
+        QCOMPARE(runs.at(0), qMakePair(QString("a"), qint64(1 + 100000000)));
+
+        // tasks due at the same time run in the order they were scheduled
+        clock.advance(1000);
+        QCOMPARE(runs.size(), 3);
+        QCOMPARE(runs.at(1), qMakePair(QString("b"), qint64(1 + 500000000)));
+        QCOMPARE(runs.at(2), qMakePair(QString("c"), qint64(1 + 500000000)));
+        QCOMPARE(clock.now(), qint64(1 + 1100000000));
+        QCOMPARE(clock.pendingCount(), 0);
+    }
+
+    // A task that reschedules itself runs once for every period that is advanced over.
+    void chained()
+    {
+        VirtualClock clock;
+        QObject context;
+        int runs = 0;
+        std::function<void ()> task = [&]
+        {
+            runs++;
+            clock.schedule(500, &context, task);
+        };
+        clock.schedule(500, &context, task);
+
+        clock.advance(60000);
+        QCOMPARE(runs, 120);
+        QCOMPARE(clock.pendingCount(), 1);
+    }
+
+    // A task does not run once its context is destroyed.
+    void destroyed()
+    {
+        VirtualClock clock;
+        bool ran = false;
+        {
+            QObject context;
+            clock.schedule(100, &context, [&] { ran = true; });
+        }
+
+        clock.advance(100);
+        QVERIFY(!ran);
+        QCOMPARE(clock.pendingCount(), 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(VirtualClockTest);
+#include "virtualclock.test.moc"
@@ -1,4 +1,4 @@
-#include "../src/zbusevent.h"
+#include "../../src/zbusevent.h"
 
 #include <QObject>
 #include <QtTest/QtTest>
@@ -0,0 +1,8 @@
+QT += testlib websockets
+CONFIG += testcase
+
+LIBS += ../../zconnection.o
+LIBS += ../../moc_zconnection.o
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += zconnection.test.cpp
@@ -0,0 +1,55 @@
+#include "../../src/broadcastserver.h"
+#include "../../src/virtualclock.h"
+#include "../../src/zconnection.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+// The connection runs its websockets on its own I/O thread, while the stand-in for zBus, and the
+// virtual clock its retries are scheduled on, are run by the test.
+class ZConnectionTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // A failed connection is retried once RETRY_DELAY_MS have passed on the connection's
+    // scheduler, and not before.
+    void retry()
+    {
+        QUrl url;
+        {
+            BroadcastServer server;
+            QVERIFY(server.listen());
+            url = server.url();
+        }
+
+        VirtualClock clock;
+        ZConnection connection(url);
+        connection.setScheduler(&clock);
+        connection.open();
+
+        // the first attempt is refused, and the retry is scheduled on the virtual clock
+        QTRY_COMPARE(clock.pendingCount(), 1);
+        QTRY_VERIFY(!connection.errorString().isEmpty());
+        QVERIFY(!connection.isConnected());
+
+        BroadcastServer server;
+        QVERIFY(server.listen(url.port()));
+
+        clock.advance(499);
+        QTest::qWait(200);
+        QCOMPARE(server.clientCount(), 0);
+        QVERIFY(!connection.isConnected());
+
+        clock.advance(1);
+        QTRY_VERIFY(connection.isConnected());
+        QTRY_COMPARE(server.clientCount(), 1);
+        QCOMPARE(clock.pendingCount(), 0);
+
+        // the websockets are timed on the virtual clock, which stood still during the handshake
+        QCOMPARE(connection.handshakeTime(), qint64(0));
+    }
+};
+
+QTEST_GUILESS_MAIN(ZConnectionTest);
+#include "zconnection.test.moc"
@@ -0,0 +1,8 @@
+QT += testlib websockets
+CONFIG += testcase
+
+LIBS += ../../moc_zdaemon.o
+LIBS += ../../zdaemon.o
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += zdaemon.test.cpp
@@ -0,0 +1,122 @@
+#include "../../src/zdaemon.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QtTest/QtTest>
+
+// ZDaemon::send blocks until the daemon replies, so it is run on a thread of its own, while a
+// QLocalServer standing in for the daemon runs on the test's event loop.
+class ZDaemonTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    const QUrl url = QUrl("ws://localhost:1/zdaemon-test");
+
+    // Sends the given events through the daemon on another thread, and waits for the outcome.
+    static DaemonDelivery send(const QUrl &url, const QStringList &events)
+    {
+        QThread thread;
+        QObject sender;
+        sender.moveToThread(&thread);
+        thread.start();
+
+        DaemonDelivery delivery = DaemonDelivery::NoDaemon;
+        QSemaphore sent;
+        QTimer::singleShot(0, &sender, [&]
+                           {
+                               delivery = ZDaemon::send(url, events);
+                               sent.release();
+                           });
+        while (!sent.tryAcquire())
+        {
+            QTest::qWait(10);
+        }
+        thread.quit();
+        thread.wait();
+        return delivery;
+    }
+
+    // Listens as the daemon for the test URL. Each line received is appended to `lines`, and the
+    // batch is answered with `reply`, or, if it is empty, by closing the connection unanswered.
+    void serve(QLocalServer &server, QByteArrayList &lines, const QByteArray &reply)
+    {
+        QLocalServer::removeServer(ZDaemon::socketName(url));
+        QVERIFY(server.listen(ZDaemon::socketName(url)));
+        connect(&server, &QLocalServer::newConnection,
+                [&server, &lines, reply]
+                {
+                    QLocalSocket *client = server.nextPendingConnection();
+                    connect(client, &QLocalSocket::readyRead,
+                            [client, &lines, reply]
+                            {
+                                while (client->canReadLine())
+                                {
+                                    QByteArray line = client->readLine().trimmed();
+                                    if (!line.isEmpty())
+                                    {
+                                        lines.append(line);
+                                    }
+                                    else if (!reply.isEmpty())
+                                    {
+                                        client->write(reply);
+                                    }
+                                    else
+                                    {
+                                        client->close();
+                                        return;
+                                    }
+                                }
+                            });
+                    connect(client, &QLocalSocket::disconnected, client, &QObject::deleteLater);
+                });
+    }
+
+private slots:
+    // With no daemon running, nothing is written, so the caller sends the events itself.
+    void noDaemon()
+    {
+        QLocalServer::removeServer(ZDaemon::socketName(url));
+        QCOMPARE(send(url, { "{\"event\":\"scanner.read\"}" }), DaemonDelivery::NoDaemon);
+    }
+
+    // The expanded events are written as-is, one per line, and acknowledged with their count.
+    void acknowledged()
+    {
+        QLocalServer server;
+        QByteArrayList lines;
+        serve(server, lines, "2\n");
+
+        QStringList events = { "{\"event\": \"scanner.read\",\n \"data\": {}}",
+                               "{\"event\":\"pinpad.cardInfo\",\"data\":{\"seq\":{{seq}}}}" };
+        QCOMPARE(send(url, events), DaemonDelivery::Acknowledged);
+        QCOMPARE(lines, QByteArrayList({ "{\"event\": \"scanner.read\",  \"data\": {}}",
+                                         "{\"event\":\"pinpad.cardInfo\",\"data\":{\"seq\":1}}" }));
+    }
+
+    // Events the daemon received but did not acknowledge are reported as such, not as no daemon,
+    // so that they are not sent a second time.
+    void unacknowledged()
+    {
+        QLocalServer server;
+        QByteArrayList lines;
+        serve(server, lines, QByteArray());
+
+        QCOMPARE(send(url, { "{\"event\":\"scanner.read\"}" }), DaemonDelivery::Unacknowledged);
+        QCOMPARE(lines.size(), 1);
+    }
+
+    // A reply that is not a count is not an acknowledgement.
+    void malformedReply()
+    {
+        QLocalServer server;
+        QByteArrayList lines;
+        serve(server, lines, "ok\n");
+
+        QCOMPARE(send(url, { "{\"event\":\"scanner.read\"}" }), DaemonDelivery::Unacknowledged);
+    }
+};
+
+QTEST_GUILESS_MAIN(ZDaemonTest);
+#include "zdaemon.test.moc"
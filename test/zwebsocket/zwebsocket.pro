@@ -0,0 +1,6 @@
+QT += testlib websockets
+CONFIG += testcase
+
+LIBS += ../../libzbusclient.a -lrt
+
+SOURCES += zwebsocket.test.cpp
@@ -0,0 +1,304 @@
+#include "../../src/envelopescanner.h"
+#include "../../src/zbusevent.h"
+#include "../../src/zwebsocket.h"
+
+#include <QCryptographicHash>
+#include <QObject>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QSslSocket>
+#include <QTcpServer>
+#include <QWebSocketServer>
+#include <QtTest/QtTest>
+
+// TLS server with the test certificate that does not speak websocket, and keeps every byte it is
+// sent after the handshake, to tell whether a client got as far as its upgrade request.
+class TlsServer : public QTcpServer
+{
+public:
+    QSslConfiguration configuration;
+    QByteArray received;
+
+protected:
+    void incomingConnection(qintptr descriptor) override
+    {
+        QSslSocket *socket = new QSslSocket(this);
+        socket->setSocketDescriptor(descriptor);
+        socket->setSslConfiguration(configuration);
+        connect(socket, &QSslSocket::readyRead, [this, socket] { received += socket->readAll(); });
+        connect(socket, &QSslSocket::disconnected, socket, &QObject::deleteLater);
+        socket->startServerEncryption();
+    }
+};
+
+// The server's certificate is self-signed for localhost, and is its own CA. It echoes every
+// message it receives back to its sender.
+class ZWebSocketTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    static QSslCertificate certificate()
+    {
+        return QSslCertificate::fromPath(QFINDTESTDATA("localhost.crt")).value(0);
+    }
+
+    static TlsOptions options()
+    {
+        TlsOptions options;
+        options.caFile = QFINDTESTDATA("localhost.crt");
+        return options;
+    }
+
+    // Pin of the given certificate's public key, as `openssl ... | base64` computes it.
+    static QString pin(const QSslCertificate &certificate)
+    {
+        QByteArray key = certificate.publicKey().toDer();
+        return "sha256//" + QCryptographicHash::hash(key, QCryptographicHash::Sha256).toBase64();
+    }
+
+    static QSslConfiguration serverConfiguration()
+    {
+        QFile key(QFINDTESTDATA("localhost.key"));
+        key.open(QIODevice::ReadOnly);
+        QSslConfiguration configuration = QSslConfiguration::defaultConfiguration();
+        configuration.setLocalCertificate(certificate());
+        configuration.setPrivateKey(QSslKey(&key, QSsl::Rsa, QSsl::Pem));
+        configuration.setPeerVerifyMode(QSslSocket::VerifyNone);
+        return configuration;
+    }
+
+    QWebSocketServer *server = nullptr;
+    QUrl url;
+    QStringList received;
+
+private slots:
+    void init()
+    {
+        QVERIFY(!serverConfiguration().privateKey().isNull());
+        server = new QWebSocketServer("zbus", QWebSocketServer::SecureMode, this);
+        server->setSslConfiguration(serverConfiguration());
+        QVERIFY(server->listen(QHostAddress::LocalHost));
+        url = QUrl(QString("wss://localhost:%1").arg(server->serverPort()));
+
+        connect(server, &QWebSocketServer::newConnection,
+                [this]
+                {
+                    QWebSocket *client = server->nextPendingConnection();
+                    connect(client, &QWebSocket::textMessageReceived,
+                            [this, client] (const QString &message)
+                            {
+                                received.append(message);
+                                client->sendTextMessage(message);
+                            });
+                    connect(client, &QWebSocket::disconnected, client, &QObject::deleteLater);
+                });
+    }
+
+    void cleanup()
+    {
+        delete server;
+        received.clear();
+    }
+
+    // Events are sent over wss:// to a server signed by a trusted CA, and the handshake is timed.
+    void secure()
+    {
+        ZWebSocket socket;
+        socket.setTlsOptions(options());
+        socket.sendZBusEvent(ZBusEvent("scanner.read"));
+        socket.open(url);
+
+        QTRY_COMPARE(received.size(), 1);
+        QCOMPARE(received.first(), ZBusEvent("scanner.read").toJson());
+        QVERIFY(socket.handshakeTime() > 0);
+        QVERIFY(!socket.offeredSessionTicket());
+    }
+
+    // A server signed by a CA that is not trusted is never sent events.
+    void untrusted()
+    {
+        ZWebSocket socket;
+        QSignalSpy disconnected(&socket, &QWebSocket::disconnected);
+        socket.sendZBusEvent(ZBusEvent("scanner.read"));
+        socket.open(url);
+
+        QTRY_VERIFY(disconnected.count() > 0);
+        QCOMPARE(received.size(), 0);
+        QCOMPARE(socket.handshakeTime(), qint64(-1));
+    }
+
+    // With pins, a server is only sent events if its public key is pinned.
+    void pinned()
+    {
+        TlsOptions pinned = options();
+        QString other = "sha256//" + QByteArray(32, 'x').toBase64();
+        pinned.pins = QStringList{ other, pin(certificate()) };
+        QVERIFY(ZWebSocket::checkTlsOptions(pinned).isEmpty());
+
+        ZWebSocket socket;
+        socket.setTlsOptions(pinned);
+        socket.sendZBusEvent(ZBusEvent("scanner.read"));
+        socket.open(url);
+
+        QTRY_COMPARE(received.size(), 1);
+        QVERIFY(socket.tlsError().isEmpty());
+    }
+
+    void unpinned()
+    {
+        TlsOptions unpinned = options();
+        unpinned.pins = QStringList{ "sha256//" + QByteArray(32, 'x').toBase64() };
+
+        ZWebSocket socket;
+        QSignalSpy disconnected(&socket, &QWebSocket::disconnected);
+        socket.setTlsOptions(unpinned);
+        socket.sendZBusEvent(ZBusEvent("scanner.read"));
+        socket.open(url);
+
+        QTRY_VERIFY(disconnected.count() > 0);
+        QVERIFY(!socket.tlsError().isEmpty());
+        QTest::qWait(100);
+        QCOMPARE(received.size(), 0);
+    }
+
+    // The key is checked as soon as the TLS handshake is done, so a server that is not pinned is
+    // not even sent the upgrade request, and the websocket never reports being connected.
+    void unpinnedBeforeUpgrade()
+    {
+        TlsServer tls;
+        tls.configuration = serverConfiguration();
+        QVERIFY(tls.listen(QHostAddress::LocalHost));
+
+        TlsOptions unpinned = options();
+        unpinned.pins = QStringList{ "sha256//" + QByteArray(32, 'x').toBase64() };
+
+        ZWebSocket socket;
+        QSignalSpy connected(&socket, &QWebSocket::connected);
+        QSignalSpy disconnected(&socket, &QWebSocket::disconnected);
+        socket.setTlsOptions(unpinned);
+        socket.open(QUrl(QString("wss://localhost:%1").arg(tls.serverPort())));
+
+        QTRY_VERIFY(disconnected.count() > 0);
+        QVERIFY(!socket.tlsError().isEmpty());
+        QTest::qWait(100);
+        QVERIFY(tls.received.isEmpty());
+        QCOMPARE(connected.count(), 0);
+    }
+
+    void checkTlsOptions()
+    {
+        TlsOptions missing;
+        missing.caFile = "missing.crt";
+        QVERIFY(!ZWebSocket::checkTlsOptions(missing).isEmpty());
+
+        TlsOptions malformed;
+        malformed.pins = QStringList{ "sha256//abc" };
+        QVERIFY(!ZWebSocket::checkTlsOptions(malformed).isEmpty());
+
+        QVERIFY(ZWebSocket::checkTlsOptions(options()).isEmpty());
+    }
+
+    // The session ticket the server issued on one connection is offered on the next one.
+    void resumption()
+    {
+        ZWebSocket socket;
+        QSignalSpy connected(&socket, &QWebSocket::connected);
+        QSignalSpy disconnected(&socket, &QWebSocket::disconnected);
+        socket.setTlsOptions(options());
+
+        socket.open(url);
+        QTRY_COMPARE(connected.count(), 1);
+        socket.close();
+        QTRY_COMPARE(disconnected.count(), 1);
+
+        socket.open(url);
+        QTRY_COMPARE(connected.count(), 2);
+        QVERIFY(socket.offeredSessionTicket());
+    }
+
+    // A batch sent asynchronously finishes once it is flushed, including one queued before the
+    // connection was established.
+    void sendAsync()
+    {
+        ZWebSocket socket;
+        socket.setTlsOptions(options());
+        QFuture<bool> queued = socket.sendZBusEventsAsync({ ZBusEvent("scanner.read"),
+                                                            ZBusEvent("printer.status") });
+        QVERIFY(!queued.isFinished());
+        socket.open(url);
+
+        QTRY_VERIFY(queued.isFinished());
+        QVERIFY(queued.result());
+        QFuture<bool> sent = socket.sendZBusEventsAsync({ ZBusEvent("pinpad.cardInfo") });
+        QTRY_VERIFY(sent.isFinished());
+        QVERIFY(sent.result());
+        QTRY_COMPARE(received.size(), 3);
+        QCOMPARE(received.last(), ZBusEvent("pinpad.cardInfo").toJson());
+    }
+
+    // A batch sent from another thread is sent on the websocket's thread.
+    void sendAsyncFromThread()
+    {
+        ZWebSocket socket;
+        socket.setTlsOptions(options());
+        socket.open(url);
+
+        QThread thread;
+        QObject sender;
+        sender.moveToThread(&thread);
+        thread.start();
+
+        QFuture<bool> future;
+        QSemaphore sent;
+        QTimer::singleShot(0, &sender, [&]
+                           {
+                               future = socket.sendZBusEventsAsync({ ZBusEvent("scanner.read") });
+                               sent.release();
+                           });
+        QVERIFY(sent.tryAcquire(1, 5000));
+        thread.quit();
+        thread.wait();
+
+        QTRY_VERIFY(future.isFinished());
+        QVERIFY(future.result());
+        QTRY_COMPARE(received.size(), 1);
+    }
+
+    // A batch that is never flushed finishes as not flushed once its websocket is destroyed.
+    void sendAsyncDropped()
+    {
+        QFuture<bool> future;
+        {
+            ZWebSocket socket;
+            future = socket.sendZBusEventsAsync({ ZBusEvent("scanner.read") });
+        }
+
+        QVERIFY(future.isFinished());
+        QVERIFY(!future.result());
+    }
+
+    // Each event received is signalled as it arrives, with its envelope, without being parsed.
+    void envelopeReceived()
+    {
+        QByteArrayList frames;
+        QStringList names;
+        ZWebSocket socket;
+        socket.setTlsOptions(options());
+        connect(&socket, &ZWebSocket::zBusEnvelopeReceived,
+                [&] (const QByteArray &text, const ZBusEnvelope &envelope, qint64)
+                {
+                    frames.append(text);
+                    names.append(EnvelopeScanner::string(text, envelope.event));
+                });
+        socket.sendZBusEvent(ZBusEvent("scanner.read"));
+        socket.open(url);
+
+        QTRY_COMPARE(frames.size(), 1);
+        QCOMPARE(frames.first(), ZBusEvent("scanner.read").toJson().toUtf8());
+        QCOMPARE(names.first(), QString("scanner.read"));
+    }
+};
+
+QTEST_GUILESS_MAIN(ZWebSocketTest);
+#include "zwebsocket.test.moc"
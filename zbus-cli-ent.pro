@@ -1,20 +1,8 @@
-TEMPLATE = app
-CONFIG += warn_all console
-QT += core websockets
-QT -= gui
-LIBS += -lform -lncurses
+TEMPLATE = subdirs
 
-TARGET = zbus-cli-ent.x
+SUBDIRS += zbusclient
+SUBDIRS += cli
 
-HEADERS += src/mockdata.h
-HEADERS += src/zbuscli.h
-HEADERS += src/zbusevent.h
-HEADERS += src/zwebsocket.h
-
-SOURCES += src/main.cpp
-SOURCES += src/zbuscli.cpp
-SOURCES += src/zbusevent.cpp
-SOURCES += src/zwebsocket.cpp
-
-target.path = .
-INSTALLS += target
+zbusclient.file = zbusclient.pro
+cli.file = cli.pro
+cli.depends = zbusclient
@@ -0,0 +1,52 @@
+TEMPLATE = lib
+CONFIG += staticlib warn_all
+QT += core network websockets
+QT -= gui
+LIBS += -lrt
+
+TARGET = zbusclient
+
+HEADERS += src/broadcastserver.h
+HEADERS += src/decodepool.h
+HEADERS += src/duplicatefilter.h
+HEADERS += src/envelopescanner.h
+HEADERS += src/eventstats.h
+HEADERS += src/eventtemplate.h
+HEADERS += src/mockdata.h
+HEADERS += src/outbox.h
+HEADERS += src/scheduler.h
+HEADERS += src/shmring.h
+HEADERS += src/virtualclock.h
+HEADERS += src/zbusevent.h
+HEADERS += src/zclock.h
+HEADERS += src/zwebsocket.h
+
+SOURCES += src/broadcastserver.cpp
+SOURCES += src/decodepool.cpp
+SOURCES += src/duplicatefilter.cpp
+SOURCES += src/envelopescanner.cpp
+SOURCES += src/eventstats.cpp
+SOURCES += src/eventtemplate.cpp
+SOURCES += src/outbox.cpp
+SOURCES += src/scheduler.cpp
+SOURCES += src/shmring.cpp
+SOURCES += src/virtualclock.cpp
+SOURCES += src/zbusevent.cpp
+SOURCES += src/zclock.cpp
+SOURCES += src/zwebsocket.cpp
+
+isEmpty(PREFIX): PREFIX = /usr/local
+# only the headers of the public API, and the headers they include, are installed
+headers.files += src/broadcastserver.h
+headers.files += src/duplicatefilter.h
+headers.files += src/envelopescanner.h
+headers.files += src/eventstats.h
+headers.files += src/outbox.h
+headers.files += src/scheduler.h
+headers.files += src/shmring.h
+headers.files += src/virtualclock.h
+headers.files += src/zbusevent.h
+headers.files += src/zwebsocket.h
+headers.path = $$PREFIX/include/zbusclient
+target.path = $$PREFIX/lib
+INSTALLS += headers target